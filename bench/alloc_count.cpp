@@ -0,0 +1,240 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+/*
+  LD_PRELOAD library counting heap allocations. On SIGUSR2 the number
+  of allocations and bytes requested since the previous SIGUSR2 are
+  written to the file named by MERGERFS_ALLOC_COUNT as
+
+    allocs=N bytes=N op_allocs=N op_bytes=N scoped=0|1
+
+  op_* are those made inside mergerfs' operation callbacks, which
+  mergerfs marks by calling mergerfs_alloc_count_op() when it's
+  defined. The rest were made by libfuse or by threads outside of any
+  request. scoped is 0 if the binary never called it, which is the
+  case for builds predating the hook, and op_* are then meaningless.
+
+  Used by bench/alloc-count to measure allocations per request of a
+  mounted mergerfs.
+*/
+
+#include <atomic>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+extern "C"
+{
+  void *__libc_malloc(size_t);
+  void *__libc_calloc(size_t,size_t);
+  void *__libc_realloc(void*,size_t);
+  void *__libc_memalign(size_t,size_t);
+  void  __libc_free(void*);
+}
+
+namespace l
+{
+  static std::atomic<uint64_t> g_allocs(0);
+  static std::atomic<uint64_t> g_bytes(0);
+  static std::atomic<uint64_t> g_op_allocs(0);
+  static std::atomic<uint64_t> g_op_bytes(0);
+  static std::atomic<bool>     g_scoped(false);
+  static const char *g_path = NULL;
+
+  // initial-exec so reading it never calls into the allocator
+  static __thread int t_op __attribute__((tls_model("initial-exec"))) = 0;
+
+  static
+  inline
+  void
+  count(const size_t size_)
+  {
+    g_allocs.fetch_add(1,std::memory_order_relaxed);
+    g_bytes.fetch_add(size_,std::memory_order_relaxed);
+    if(t_op == 0)
+      return;
+
+    g_op_allocs.fetch_add(1,std::memory_order_relaxed);
+    g_op_bytes.fetch_add(size_,std::memory_order_relaxed);
+  }
+
+  static
+  char*
+  utoa(char     *p_,
+       uint64_t  v_)
+  {
+    char tmp[24];
+    int  i;
+
+    i = 0;
+    do
+      {
+        tmp[i++] = ('0' + (v_ % 10));
+        v_ /= 10;
+      }
+    while(v_);
+
+    while(i)
+      *p_++ = tmp[--i];
+
+    return p_;
+  }
+
+  /*
+    Only async signal safe calls.
+  */
+  static
+  void
+  dump(int signal_)
+  {
+    int fd;
+    char buf[160];
+    char *p;
+    int saved_errno;
+
+    saved_errno = errno;
+
+    p = buf;
+    memcpy(p,"allocs=",7);
+    p = l::utoa(p + 7,l::g_allocs.exchange(0));
+    memcpy(p," bytes=",7);
+    p = l::utoa(p + 7,l::g_bytes.exchange(0));
+    memcpy(p," op_allocs=",11);
+    p = l::utoa(p + 11,l::g_op_allocs.exchange(0));
+    memcpy(p," op_bytes=",10);
+    p = l::utoa(p + 10,l::g_op_bytes.exchange(0));
+    memcpy(p," scoped=",8);
+    p = l::utoa(p + 8,l::g_scoped.load());
+    *p++ = '\n';
+
+    fd = ::open(l::g_path,O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if(fd >= 0)
+      {
+        ::write(fd,buf,(p - buf));
+        ::close(fd);
+      }
+
+    errno = saved_errno;
+  }
+
+  __attribute__((constructor))
+  static
+  void
+  init(void)
+  {
+    struct sigaction sa;
+
+    l::g_path = getenv("MERGERFS_ALLOC_COUNT");
+    if(l::g_path == NULL)
+      return;
+
+    memset(&sa,0,sizeof(sa));
+    sa.sa_handler = l::dump;
+    sa.sa_flags   = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR2,&sa,NULL);
+  }
+}
+
+extern "C"
+{
+  // called by mergerfs on entering (1) and leaving (0) an operation
+  void
+  mergerfs_alloc_count_op(const int inside_)
+  {
+    l::t_op = inside_;
+    if(!l::g_scoped.load(std::memory_order_relaxed))
+      l::g_scoped.store(true,std::memory_order_relaxed);
+  }
+
+  void*
+  malloc(size_t size_)
+  {
+    l::count(size_);
+    return __libc_malloc(size_);
+  }
+
+  void*
+  calloc(size_t nmemb_,
+         size_t size_)
+  {
+    l::count(nmemb_ * size_);
+    return __libc_calloc(nmemb_,size_);
+  }
+
+  void*
+  realloc(void   *ptr_,
+          size_t  size_)
+  {
+    l::count(size_);
+    return __libc_realloc(ptr_,size_);
+  }
+
+  void*
+  memalign(size_t alignment_,
+           size_t size_)
+  {
+    l::count(size_);
+    return __libc_memalign(alignment_,size_);
+  }
+
+  void*
+  aligned_alloc(size_t alignment_,
+                size_t size_)
+  {
+    l::count(size_);
+    return __libc_memalign(alignment_,size_);
+  }
+
+  int
+  posix_memalign(void   **ptr_,
+                 size_t   alignment_,
+                 size_t   size_)
+  {
+    void *p;
+
+    l::count(size_);
+    p = __libc_memalign(alignment_,size_);
+    if(p == NULL)
+      return ENOMEM;
+
+    *ptr_ = p;
+
+    return 0;
+  }
+
+  void*
+  valloc(size_t size_)
+  {
+    l::count(size_);
+    return __libc_memalign(sysconf(_SC_PAGESIZE),size_);
+  }
+
+  void
+  free(void *ptr_)
+  {
+    __libc_free(ptr_);
+  }
+}
@@ -0,0 +1,164 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <ftw.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+  Bits shared by the benchmarks which call into mergerfs directly
+  rather than through a mount.
+*/
+namespace bench
+{
+  static
+  inline
+  uint64_t
+  now(void)
+  {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+
+    return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+  }
+
+  struct Latency
+  {
+    uint64_t count;
+    double   p50;
+    double   p90;
+    double   p99;
+    double   p999;
+  };
+
+  /*
+    Sorts in place. Results are in microseconds.
+  */
+  static
+  inline
+  Latency
+  latency(std::vector<uint32_t> &nsecs_)
+  {
+    Latency l = Latency();
+
+    std::sort(nsecs_.begin(),nsecs_.end());
+
+    l.count = nsecs_.size();
+    if(l.count == 0)
+      return l;
+
+    l.p50  = nsecs_[std::min(l.count - 1,(l.count * 500)  / 1000)] / 1000.0;
+    l.p90  = nsecs_[std::min(l.count - 1,(l.count * 900)  / 1000)] / 1000.0;
+    l.p99  = nsecs_[std::min(l.count - 1,(l.count * 990)  / 1000)] / 1000.0;
+    l.p999 = nsecs_[std::min(l.count - 1,(l.count * 999)  / 1000)] / 1000.0;
+
+    return l;
+  }
+
+  static
+  inline
+  std::string
+  mkdtemp(const std::string &tmpdir_)
+  {
+    std::string tmpl;
+
+    tmpl = tmpdir_ + "/mergerfs-bench.XXXXXX";
+    if(::mkdtemp(&tmpl[0]) == NULL)
+      {
+        perror("mkdtemp");
+        exit(1);
+      }
+
+    return tmpl;
+  }
+
+  static
+  inline
+  int
+  rm_entry(const char        *fpath_,
+           const struct stat *sb_,
+           int                typeflag_,
+           struct FTW        *ftwbuf_)
+  {
+    return ::remove(fpath_);
+  }
+
+  static
+  inline
+  void
+  rm_rf(const std::string &path_)
+  {
+    ::nftw(path_.c_str(),bench::rm_entry,64,FTW_DEPTH|FTW_PHYS);
+  }
+
+  static
+  inline
+  void
+  touch(const std::string &path_,
+        const off_t        size_)
+  {
+    FILE *f;
+
+    f = ::fopen(path_.c_str(),"w");
+    if(f == NULL)
+      {
+        perror(path_.c_str());
+        exit(1);
+      }
+    if(size_ > 0)
+      ::ftruncate(::fileno(f),size_);
+    ::fclose(f);
+  }
+
+  /*
+    "a,b,c" -> [a,b,c]
+  */
+  static
+  inline
+  std::vector<std::string>
+  split(const std::string &s_,
+        const char         c_)
+  {
+    size_t pos;
+    size_t start;
+    std::vector<std::string> rv;
+
+    start = 0;
+    while((pos = s_.find(c_,start)) != std::string::npos)
+      {
+        rv.push_back(s_.substr(start,pos - start));
+        start = pos + 1;
+      }
+    rv.push_back(s_.substr(start));
+
+    return rv;
+  }
+}
@@ -0,0 +1,805 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+/*
+  Drives FUSE:: operations directly, without the kernel or a mount,
+  from N threads over branches in a temporary directory. Reports
+  ops/sec and latency percentiles per workload for each combination of
+  the options given.
+
+    mergerfs-bench [-b branches] [-t threads] [-s seconds] [-d dirs]
+                   [-f files] [-w workload,...] [-o key=val,val ...]
+                   [-r size] [-H hugepages] [-T tmpdir]
+*/
+
+#include "bench.hpp"
+
+#include "config.hpp"
+#include "fuse_create.hpp"
+#include "fuse_getattr.hpp"
+#include "fuse_mkdir.hpp"
+#include "fuse_open.hpp"
+#include "fuse_opendir.hpp"
+#include "fuse_read.hpp"
+#include "fuse_readdir.hpp"
+#include "fuse_release.hpp"
+#include "fuse_releasedir.hpp"
+#include "fuse_rmdir.hpp"
+#include "fuse_statfs.hpp"
+#include "fuse_unlink.hpp"
+#include "fuse_write.hpp"
+#include "ugid.hpp"
+
+#include "fuse.h"
+#include "fuse_dirents.h"
+
+extern "C"
+{
+#include "../libfuse/lib/fuse_msgbuf.h"
+}
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+using std::pair;
+
+namespace l
+{
+  struct Args
+  {
+    uint64_t branches;
+    uint64_t threads;
+    uint64_t seconds;
+    uint64_t dirs;
+    uint64_t files;
+    uint64_t readsize;
+    int      hugepages;
+    string   tmpdir;
+    vector<string> workloads;
+    vector<pair<string,vector<string> > > options;
+  };
+
+  struct Thread;
+
+  typedef int (*OpFunc)(Thread*,const uint64_t);
+
+  struct Workload
+  {
+    const char *name;
+    OpFunc      op;
+    void      (*setup)(Thread*);
+    void      (*teardown)(Thread*);
+  };
+
+  struct Thread
+  {
+    pthread_t        thread;
+    uint64_t         id;
+    uint64_t         seed;
+    uint64_t         end;
+    uint64_t         errors;
+    const Args      *args;
+    const Workload  *workload;
+    fuse_file_info_t ffi;
+    fuse_dirents_t   dirents;
+    char             buf[4096];
+    char             path[PATH_MAX];
+    char            *seqbuf;
+    off_t            seqoff;
+    uint64_t         created;
+    vector<uint32_t> nsecs;
+  };
+
+  static
+  uint64_t
+  rnd(Thread *t_)
+  {
+    t_->seed ^= (t_->seed << 13);
+    t_->seed ^= (t_->seed >> 7);
+    t_->seed ^= (t_->seed << 17);
+
+    return t_->seed;
+  }
+
+  static
+  const char*
+  file_path(Thread *t_)
+  {
+    uint64_t d = (l::rnd(t_) % t_->args->dirs);
+    uint64_t f = (l::rnd(t_) % t_->args->files);
+
+    snprintf(t_->path,sizeof(t_->path),"/d%03llu/f%04llu",
+             (unsigned long long)d,
+             (unsigned long long)f);
+
+    return t_->path;
+  }
+
+  static
+  int
+  op_getattr(Thread         *t_,
+             const uint64_t  i_)
+  {
+    struct stat st;
+    fuse_timeouts_t timeouts;
+
+    return FUSE::getattr(l::file_path(t_),&st,&timeouts);
+  }
+
+  static
+  int
+  op_getattr_miss(Thread         *t_,
+                  const uint64_t  i_)
+  {
+    struct stat st;
+    fuse_timeouts_t timeouts;
+
+    snprintf(t_->path,sizeof(t_->path),"/d000/missing%llu",
+             (unsigned long long)i_);
+
+    return FUSE::getattr(t_->path,&st,&timeouts);
+  }
+
+  static
+  int
+  op_open(Thread         *t_,
+          const uint64_t  i_)
+  {
+    int rv;
+
+    t_->ffi       = fuse_file_info_t();
+    t_->ffi.flags = O_RDONLY;
+
+    rv = FUSE::open(l::file_path(t_),&t_->ffi);
+    if(rv < 0)
+      return rv;
+
+    return FUSE::release(&t_->ffi);
+  }
+
+  static
+  int
+  op_create(Thread         *t_,
+            const uint64_t  i_)
+  {
+    int rv;
+
+    snprintf(t_->path,sizeof(t_->path),"/t%llu/c%llu",
+             (unsigned long long)t_->id,
+             (unsigned long long)i_);
+
+    t_->ffi       = fuse_file_info_t();
+    t_->ffi.flags = (O_CREAT|O_WRONLY|O_TRUNC);
+
+    rv = FUSE::create(t_->path,0644,&t_->ffi);
+    if(rv < 0)
+      return rv;
+
+    t_->created = (i_ + 1);
+
+    return FUSE::release(&t_->ffi);
+  }
+
+  static
+  void
+  create_teardown(Thread *t_)
+  {
+    for(uint64_t i = 0; i < t_->created; i++)
+      {
+        snprintf(t_->path,sizeof(t_->path),"/t%llu/c%llu",
+                 (unsigned long long)t_->id,
+                 (unsigned long long)i);
+        FUSE::unlink(t_->path);
+      }
+  }
+
+  static
+  int
+  op_mkdir(Thread         *t_,
+           const uint64_t  i_)
+  {
+    int rv;
+
+    snprintf(t_->path,sizeof(t_->path),"/t%llu/m%llu",
+             (unsigned long long)t_->id,
+             (unsigned long long)i_);
+
+    rv = FUSE::mkdir(t_->path,0755);
+    if(rv < 0)
+      return rv;
+
+    return FUSE::rmdir(t_->path);
+  }
+
+  static
+  void
+  readdir_setup(Thread *t_)
+  {
+    fuse_dirents_init(&t_->dirents);
+  }
+
+  static
+  void
+  readdir_teardown(Thread *t_)
+  {
+    fuse_dirents_free(&t_->dirents);
+  }
+
+  static
+  int
+  op_readdir(Thread         *t_,
+             const uint64_t  i_)
+  {
+    int rv;
+
+    snprintf(t_->path,sizeof(t_->path),"/d%03llu",
+             (unsigned long long)(l::rnd(t_) % t_->args->dirs));
+
+    t_->ffi = fuse_file_info_t();
+
+    rv = FUSE::opendir(t_->path,&t_->ffi);
+    if(rv < 0)
+      return rv;
+
+    fuse_dirents_reset(&t_->dirents);
+    rv = FUSE::readdir(&t_->ffi,&t_->dirents);
+
+    FUSE::releasedir(&t_->ffi);
+
+    return rv;
+  }
+
+  static
+  int
+  op_statfs(Thread         *t_,
+            const uint64_t  i_)
+  {
+    struct statvfs st;
+
+    return FUSE::statfs("/",&st);
+  }
+
+  /*
+    read and write use a 1MiB file per thread opened once.
+  */
+  static
+  void
+  data_setup(Thread *t_)
+  {
+    int rv;
+
+    snprintf(t_->path,sizeof(t_->path),"/data%llu",
+             (unsigned long long)t_->id);
+
+    t_->ffi       = fuse_file_info_t();
+    t_->ffi.flags = O_RDWR;
+
+    rv = FUSE::open(t_->path,&t_->ffi);
+    if(rv < 0)
+      {
+        fprintf(stderr,"open %s: %s\n",t_->path,strerror(-rv));
+        exit(1);
+      }
+  }
+
+  static
+  void
+  data_teardown(Thread *t_)
+  {
+    FUSE::release(&t_->ffi);
+  }
+
+  /*
+    seqread reads the thread's data file front to back, readsize at a
+    time, into a buffer from the same allocator as libfuse's message
+    buffers so -H has the effect it has on a mount.
+  */
+  static
+  void
+  seqread_setup(Thread *t_)
+  {
+    l::data_setup(t_);
+    t_->seqbuf = (char*)msgbuf_alloc(t_->args->readsize);
+    t_->seqoff = 0;
+    if(t_->seqbuf == NULL)
+      {
+        fprintf(stderr,"unable to allocate %llu byte buffer\n",
+                (unsigned long long)t_->args->readsize);
+        exit(1);
+      }
+  }
+
+  static
+  void
+  seqread_teardown(Thread *t_)
+  {
+    msgbuf_free(t_->seqbuf,t_->args->readsize);
+    l::data_teardown(t_);
+  }
+
+  static
+  int
+  op_seqread(Thread         *t_,
+             const uint64_t  i_)
+  {
+    int rv;
+
+    rv = FUSE::read(&t_->ffi,t_->seqbuf,t_->args->readsize,t_->seqoff);
+    if(rv <= 0)
+      {
+        t_->seqoff = 0;
+        return rv;
+      }
+
+    t_->seqoff += rv;
+
+    return rv;
+  }
+
+  static
+  int
+  op_read(Thread         *t_,
+          const uint64_t  i_)
+  {
+    off_t off = ((l::rnd(t_) % 256) * sizeof(t_->buf));
+
+    return FUSE::read(&t_->ffi,t_->buf,sizeof(t_->buf),off);
+  }
+
+  static
+  int
+  op_write(Thread         *t_,
+           const uint64_t  i_)
+  {
+    off_t off = ((l::rnd(t_) % 256) * sizeof(t_->buf));
+
+    return FUSE::write(&t_->ffi,t_->buf,sizeof(t_->buf),off);
+  }
+
+  static const Workload WORKLOADS[] =
+    {
+      {"getattr",      l::op_getattr,      NULL,              NULL},
+      {"getattr_miss", l::op_getattr_miss, NULL,              NULL},
+      {"open",         l::op_open,         NULL,              NULL},
+      {"create",       l::op_create,       NULL,              l::create_teardown},
+      {"mkdir",        l::op_mkdir,        NULL,              NULL},
+      {"readdir",      l::op_readdir,      l::readdir_setup,  l::readdir_teardown},
+      {"statfs",       l::op_statfs,       NULL,              NULL},
+      {"read",         l::op_read,         l::data_setup,     l::data_teardown},
+      {"write",        l::op_write,        l::data_setup,     l::data_teardown},
+      {"seqread",      l::op_seqread,      l::seqread_setup,  l::seqread_teardown},
+      {NULL,           NULL,               NULL,              NULL}
+    };
+
+  static
+  void*
+  run(void *arg_)
+  {
+    uint64_t i;
+    uint64_t t0;
+    uint64_t t1;
+    Thread *t = (Thread*)arg_;
+    fuse_context *fc;
+
+    fc = fuse_get_context();
+    fc->uid   = ::getuid();
+    fc->gid   = ::getgid();
+    fc->pid   = ::getpid();
+    fc->umask = 022;
+
+    if(t->workload->setup)
+      t->workload->setup(t);
+
+    t1 = bench::now();
+    for(i = 0; t1 < t->end; i++)
+      {
+        t0 = t1;
+        if(t->workload->op(t,i) < 0)
+          t->errors++;
+        t1 = bench::now();
+        t->nsecs.push_back(t1 - t0);
+      }
+
+    if(t->workload->teardown)
+      t->workload->teardown(t);
+
+    return NULL;
+  }
+
+  static
+  void
+  run_workload(const Args     &args_,
+               const Workload &workload_)
+  {
+    uint64_t start;
+    uint64_t errors;
+    double secs;
+    vector<Thread> threads(args_.threads);
+    vector<uint32_t> nsecs;
+    bench::Latency lat;
+
+    start = bench::now();
+    for(uint64_t i = 0; i < threads.size(); i++)
+      {
+        Thread &t = threads[i];
+
+        t.id       = i;
+        t.seed     = (0x9E3779B97F4A7C15ULL * (i + 1));
+        t.end      = (start + (args_.seconds * 1000000000ULL));
+        t.errors   = 0;
+        t.args     = &args_;
+        t.workload = &workload_;
+        t.created  = 0;
+        memset(t.buf,'x',sizeof(t.buf));
+        t.nsecs.reserve(1024 * 1024);
+
+        pthread_create(&t.thread,NULL,l::run,&t);
+      }
+
+    errors = 0;
+    for(uint64_t i = 0; i < threads.size(); i++)
+      {
+        pthread_join(threads[i].thread,NULL);
+        nsecs.insert(nsecs.end(),
+                     threads[i].nsecs.begin(),
+                     threads[i].nsecs.end());
+        errors += threads[i].errors;
+      }
+
+    secs = ((bench::now() - start) / 1e9);
+    lat  = bench::latency(nsecs);
+
+    printf("%-14s %12.0f %10.2f %10.2f %10.2f %10.2f %8llu\n",
+           workload_.name,
+           (lat.count / secs),
+           lat.p50,
+           lat.p90,
+           lat.p99,
+           lat.p999,
+           (unsigned long long)errors);
+    fflush(stdout);
+  }
+
+  /*
+    Large enough that seqread isn't mostly rewinding.
+  */
+  static
+  off_t
+  data_size(const Args &args_)
+  {
+    return std::max((off_t)(1024 * 1024),(off_t)(args_.readsize * 64));
+  }
+
+  /*
+    Directories exist on every branch. Files are spread round robin.
+  */
+  static
+  void
+  populate(const Args           &args_,
+           const vector<string> &branches_)
+  {
+    char path[PATH_MAX];
+
+    for(uint64_t b = 0; b < branches_.size(); b++)
+      {
+        for(uint64_t d = 0; d < args_.dirs; d++)
+          {
+            snprintf(path,sizeof(path),"%s/d%03llu",
+                     branches_[b].c_str(),(unsigned long long)d);
+            ::mkdir(path,0755);
+          }
+        for(uint64_t t = 0; t < args_.threads; t++)
+          {
+            snprintf(path,sizeof(path),"%s/t%llu",
+                     branches_[b].c_str(),(unsigned long long)t);
+            ::mkdir(path,0755);
+          }
+      }
+
+    for(uint64_t d = 0, n = 0; d < args_.dirs; d++)
+      {
+        for(uint64_t f = 0; f < args_.files; f++, n++)
+          {
+            snprintf(path,sizeof(path),"%s/d%03llu/f%04llu",
+                     branches_[n % branches_.size()].c_str(),
+                     (unsigned long long)d,
+                     (unsigned long long)f);
+            bench::touch(path,0);
+          }
+      }
+
+    for(uint64_t t = 0; t < args_.threads; t++)
+      {
+        snprintf(path,sizeof(path),"%s/data%llu",
+                 branches_[t % branches_.size()].c_str(),
+                 (unsigned long long)t);
+        bench::touch(path,l::data_size(args_));
+      }
+  }
+
+  static
+  void
+  run_case(const Args                          &args_,
+           const vector<pair<string,string> >  &opts_)
+  {
+    int rv;
+    string desc;
+
+    {
+      Config::Write cfg;
+
+      for(uint64_t i = 0; i < opts_.size(); i++)
+        {
+          rv = cfg->set(opts_[i].first,opts_[i].second);
+          if(rv < 0)
+            {
+              fprintf(stderr,"unable to set %s=%s: %s\n",
+                      opts_[i].first.c_str(),
+                      opts_[i].second.c_str(),
+                      strerror(-rv));
+              exit(1);
+            }
+          desc += (desc.empty() ? "" : " ");
+          desc += opts_[i].first + "=" + opts_[i].second;
+        }
+    }
+
+    printf("\n# %s\n",(desc.empty() ? "defaults" : desc.c_str()));
+    printf("%-14s %12s %10s %10s %10s %10s %8s\n",
+           "workload","ops/s","p50 us","p90 us","p99 us","p99.9 us","errors");
+
+    for(uint64_t w = 0; w < args_.workloads.size(); w++)
+      {
+        for(const Workload *wl = WORKLOADS; wl->name; wl++)
+          {
+            if(args_.workloads[w] == wl->name)
+              l::run_workload(args_,*wl);
+          }
+      }
+  }
+
+  /*
+    Every combination of the values given for each option.
+  */
+  static
+  void
+  run_cases(const Args                    &args_,
+            const uint64_t                 idx_,
+            vector<pair<string,string> >  *opts_)
+  {
+    if(idx_ == args_.options.size())
+      {
+        l::run_case(args_,*opts_);
+        return;
+      }
+
+    const pair<string,vector<string> > &o = args_.options[idx_];
+    for(uint64_t i = 0; i < o.second.size(); i++)
+      {
+        opts_->push_back(std::make_pair(o.first,o.second[i]));
+        l::run_cases(args_,idx_ + 1,opts_);
+        opts_->pop_back();
+      }
+  }
+
+  static
+  void
+  usage(void)
+  {
+    fprintf(stderr,
+            "usage: mergerfs-bench [options]\n"
+            "\n"
+            "  -b INT          number of branches (default: 4)\n"
+            "  -t INT          number of threads (default: 1)\n"
+            "  -s INT          seconds per workload (default: 2)\n"
+            "  -d INT          directories (default: 16)\n"
+            "  -f INT          files per directory (default: 64)\n"
+            "  -w LIST         workloads, comma separated (default: all)\n"
+            "                  getattr,getattr_miss,open,create,mkdir,\n"
+            "                  readdir,statfs,read,write,seqread\n"
+            "  -o KEY=VAL,...  option to set. Each value is run in turn\n"
+            "                  and every combination of multiple -o\n"
+            "  -r SIZE         seqread size. Understands K and M\n"
+            "                  (default: 1M, the largest FUSE message)\n"
+            "  -H off|transparent|explicit\n"
+            "                  hugepages for the seqread buffer (default: off)\n"
+            "  -T PATH         where to create branches (default: $TMPDIR or /tmp)\n");
+    exit(1);
+  }
+
+  static
+  uint64_t
+  size(const char *s_)
+  {
+    char *end;
+    uint64_t v;
+
+    v = strtoull(s_,&end,10);
+    switch(*end)
+      {
+      case 'k':
+      case 'K':
+        return (v * 1024);
+      case 'm':
+      case 'M':
+        return (v * 1024 * 1024);
+      default:
+        return v;
+      }
+  }
+
+  static
+  void
+  parse(int    argc_,
+        char **argv_,
+        Args  *args_)
+  {
+    int opt;
+    size_t eq;
+    string s;
+    const char *tmpdir;
+
+    tmpdir = getenv("TMPDIR");
+
+    args_->branches = 4;
+    args_->threads  = 1;
+    args_->seconds  = 2;
+    args_->dirs     = 16;
+    args_->files    = 64;
+    args_->readsize = (1024 * 1024);
+    args_->hugepages = FUSE_HUGEPAGES_OFF;
+    args_->tmpdir   = ((tmpdir && *tmpdir) ? tmpdir : "/tmp");
+
+    while((opt = getopt(argc_,argv_,"b:t:s:d:f:w:o:r:H:T:h")) != -1)
+      {
+        switch(opt)
+          {
+          case 'b':
+            args_->branches = strtoull(optarg,NULL,10);
+            break;
+          case 't':
+            args_->threads = strtoull(optarg,NULL,10);
+            break;
+          case 's':
+            args_->seconds = strtoull(optarg,NULL,10);
+            break;
+          case 'd':
+            args_->dirs = strtoull(optarg,NULL,10);
+            break;
+          case 'f':
+            args_->files = strtoull(optarg,NULL,10);
+            break;
+          case 'w':
+            args_->workloads = bench::split(optarg,',');
+            break;
+          case 'o':
+            s  = optarg;
+            eq = s.find('=');
+            if(eq == string::npos)
+              l::usage();
+            args_->options.push_back(std::make_pair(s.substr(0,eq),
+                                                    bench::split(s.substr(eq + 1),',')));
+            break;
+          case 'r':
+            args_->readsize = l::size(optarg);
+            break;
+          case 'H':
+            s = optarg;
+            if(s == "off")
+              args_->hugepages = FUSE_HUGEPAGES_OFF;
+            else if(s == "transparent")
+              args_->hugepages = FUSE_HUGEPAGES_TRANSPARENT;
+            else if(s == "explicit")
+              args_->hugepages = FUSE_HUGEPAGES_EXPLICIT;
+            else
+              l::usage();
+            break;
+          case 'T':
+            args_->tmpdir = optarg;
+            break;
+          default:
+            l::usage();
+          }
+      }
+
+    if(!args_->branches || !args_->threads || !args_->dirs ||
+       !args_->files || !args_->readsize)
+      l::usage();
+
+    if(args_->workloads.empty())
+      {
+        for(const Workload *wl = WORKLOADS; wl->name; wl++)
+          args_->workloads.push_back(wl->name);
+      }
+  }
+}
+
+int
+main(int    argc_,
+     char **argv_)
+{
+  int rv;
+  l::Args args;
+  string root;
+  string branchesstr;
+  vector<string> branches;
+  vector<pair<string,string> > opts;
+  Config config;
+
+  l::parse(argc_,argv_,&args);
+
+  root = bench::mkdtemp(args.tmpdir);
+  for(uint64_t i = 0; i < args.branches; i++)
+    {
+      branches.push_back(root + "/b" + std::to_string(i));
+      ::mkdir(branches.back().c_str(),0755);
+      branchesstr += (i ? ":" : "") + branches.back();
+    }
+
+  l::populate(args,branches);
+
+  msgbuf_set_hugepages(args.hugepages);
+
+  if(fuse_context_standalone() == -1)
+    return 1;
+
+  ::umask(0);
+  ugid::init(true);
+
+  {
+    Config::Write cfg;
+
+    rv = cfg->set_raw("branches",branchesstr);
+    if(rv >= 0)
+      rv = cfg->set_raw("minfreespace","0");
+    if(rv < 0)
+      {
+        fprintf(stderr,"unable to configure branches: %s\n",strerror(-rv));
+        return 1;
+      }
+  }
+
+  printf("# branches=%llu threads=%llu seconds=%llu dirs=%llu files=%llu readsize=%llu\n",
+         (unsigned long long)args.branches,
+         (unsigned long long)args.threads,
+         (unsigned long long)args.seconds,
+         (unsigned long long)args.dirs,
+         (unsigned long long)args.files,
+         (unsigned long long)args.readsize);
+
+  l::run_cases(args,0,&opts);
+
+  bench::rm_rf(root);
+
+  return 0;
+}
@@ -0,0 +1,370 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+/*
+  Cost of every policy, in each category, as the number of branches
+  grows. Reports ns/op and syscalls/op so scaling can be tracked.
+
+    mergerfs-bench-policy [-b counts] [-s scenarios] [-m msecs]
+                          [-c statfs_cache_secs] [-T tmpdir]
+
+  Scenarios:
+    rw      every branch RW with the path present on all of them
+    mixed   1/4 RO, 1/4 NC, 1/4 below their minfreespace, the path
+            on every other branch
+    sparse  every branch RW with the path only on the last one
+
+  Syscalls are counted by wrapping the libc calls the policies make
+  (see the link flags for this target in the Makefile).
+*/
+
+#include "bench.hpp"
+
+#include "branch.hpp"
+#include "category.hpp"
+#include "fs_statvfs_cache.hpp"
+#include "policy.hpp"
+
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+
+static __thread uint64_t t_syscalls = 0;
+
+extern "C"
+{
+  int __real_lstat64(const char*,struct stat64*);
+  int __real_stat64(const char*,struct stat64*);
+  int __real_statvfs64(const char*,struct statvfs64*);
+
+  int
+  __wrap_lstat64(const char     *path_,
+                 struct stat64  *st_)
+  {
+    t_syscalls++;
+    return __real_lstat64(path_,st_);
+  }
+
+  int
+  __wrap_stat64(const char     *path_,
+                struct stat64  *st_)
+  {
+    t_syscalls++;
+    return __real_stat64(path_,st_);
+  }
+
+  int
+  __wrap_statvfs64(const char       *path_,
+                   struct statvfs64 *st_)
+  {
+    t_syscalls++;
+    return __real_statvfs64(path_,st_);
+  }
+}
+
+namespace l
+{
+  enum Scenario
+    {
+      RW,
+      MIXED,
+      SPARSE
+    };
+
+  static const char *SCENARIOS[] = {"rw","mixed","sparse"};
+  static const char  DIR[]       = "/dir";
+  static const char  FILE[]      = "/dir/file";
+
+  struct Args
+  {
+    vector<uint64_t> counts;
+    vector<Scenario> scenarios;
+    uint64_t         msecs;
+    uint64_t         cache;
+    string           tmpdir;
+  };
+
+  /*
+    Returns the branches string for the scenario. A full branch is
+    one given a minfreespace larger than any filesystem.
+  */
+  static
+  string
+  setup(const string   &root_,
+        const uint64_t  count_,
+        const Scenario  scenario_)
+  {
+    bool present;
+    string s;
+    string path;
+
+    for(uint64_t i = 0; i < count_; i++)
+      {
+        path = root_ + "/" + SCENARIOS[scenario_] + std::to_string(count_) + "." + std::to_string(i);
+        ::mkdir(path.c_str(),0755);
+
+        switch(scenario_)
+          {
+          case RW:
+            present = true;
+            break;
+          case MIXED:
+            present = ((i % 2) == 1);
+            break;
+          case SPARSE:
+          default:
+            present = (i == (count_ - 1));
+            break;
+          }
+
+        if(present)
+          {
+            ::mkdir((path + DIR).c_str(),0755);
+            bench::touch(path + FILE,0);
+          }
+
+        s += (i ? ":" : "");
+        s += path;
+        if(scenario_ != MIXED)
+          continue;
+
+        switch(i % 4)
+          {
+          case 0:
+            s += "=RO";
+            break;
+          case 1:
+            s += "=NC";
+            break;
+          case 2:
+            s += "=RW,1024T";
+            break;
+          default:
+            s += "=RW";
+            break;
+          }
+      }
+
+    return s;
+  }
+
+  static
+  void
+  run(const Args     &args_,
+      const Branches &branches_,
+      const Policy   &policy_,
+      const Category  category_,
+      const char     *fusepath_,
+      double         *nsecs_,
+      double         *syscalls_,
+      int            *error_)
+  {
+    int rv;
+    uint64_t n;
+    uint64_t t0;
+    uint64_t t1;
+    uint64_t end;
+    uint64_t syscalls;
+    vector<string> paths;
+    Policy::Func::Ptr func = policy_;
+
+    // warm up and find the result
+    rv = func(category_,branches_,fusepath_,&paths);
+    *error_ = ((rv == -1) ? errno : 0);
+
+    n        = 0;
+    syscalls = t_syscalls;
+    t0       = bench::now();
+    end      = (t0 + (args_.msecs * 1000000ULL));
+    do
+      {
+        for(int i = 0; i < 64; i++)
+          {
+            paths.clear();
+            func(category_,branches_,fusepath_,&paths);
+          }
+        n += 64;
+        t1 = bench::now();
+      }
+    while(t1 < end);
+
+    *nsecs_    = ((double)(t1 - t0) / n);
+    *syscalls_ = ((double)(t_syscalls - syscalls) / n);
+  }
+
+  static
+  void
+  usage(void)
+  {
+    fprintf(stderr,
+            "usage: mergerfs-bench-policy [options]\n"
+            "\n"
+            "  -b LIST   branch counts (default: 4,8,16,32,64,128)\n"
+            "  -s LIST   scenarios: rw,mixed,sparse (default: all)\n"
+            "  -m INT    milliseconds per measurement (default: 100)\n"
+            "  -c INT    statfs cache timeout in seconds (default: 0)\n"
+            "  -T PATH   where to create branches (default: $TMPDIR or /tmp)\n");
+    exit(1);
+  }
+
+  static
+  void
+  parse(int    argc_,
+        char **argv_,
+        Args  *args_)
+  {
+    int opt;
+    vector<string> v;
+    const char *tmpdir;
+
+    tmpdir = getenv("TMPDIR");
+
+    args_->msecs  = 100;
+    args_->cache  = 0;
+    args_->tmpdir = ((tmpdir && *tmpdir) ? tmpdir : "/tmp");
+
+    while((opt = getopt(argc_,argv_,"b:s:m:c:T:h")) != -1)
+      {
+        switch(opt)
+          {
+          case 'b':
+            v = bench::split(optarg,',');
+            for(size_t i = 0; i < v.size(); i++)
+              args_->counts.push_back(strtoull(v[i].c_str(),NULL,10));
+            break;
+          case 's':
+            v = bench::split(optarg,',');
+            for(size_t i = 0; i < v.size(); i++)
+              {
+                if(v[i] == "rw")
+                  args_->scenarios.push_back(RW);
+                else if(v[i] == "mixed")
+                  args_->scenarios.push_back(MIXED);
+                else if(v[i] == "sparse")
+                  args_->scenarios.push_back(SPARSE);
+                else
+                  l::usage();
+              }
+            break;
+          case 'm':
+            args_->msecs = strtoull(optarg,NULL,10);
+            break;
+          case 'c':
+            args_->cache = strtoull(optarg,NULL,10);
+            break;
+          case 'T':
+            args_->tmpdir = optarg;
+            break;
+          default:
+            l::usage();
+          }
+      }
+
+    if(args_->counts.empty())
+      {
+        const uint64_t counts[] = {4,8,16,32,64,128};
+        args_->counts.assign(counts,counts + 6);
+      }
+    if(args_->scenarios.empty())
+      {
+        args_->scenarios.push_back(RW);
+        args_->scenarios.push_back(MIXED);
+        args_->scenarios.push_back(SPARSE);
+      }
+  }
+}
+
+int
+main(int    argc_,
+     char **argv_)
+{
+  int rv;
+  int error;
+  double nsecs;
+  double syscalls;
+  string root;
+  l::Args args;
+  const uint64_t minfreespace = 0;
+  const struct { Category cat; const char *name; const char *path; } cats[] =
+    {
+      {Category::CREATE,"create",l::DIR},
+      {Category::SEARCH,"search",l::FILE},
+      {Category::ACTION,"action",l::FILE}
+    };
+
+  l::parse(argc_,argv_,&args);
+
+  fs::statvfs_cache_timeout(args.cache);
+
+  root = bench::mkdtemp(args.tmpdir);
+
+  printf("%-8s %-8s %9s %-8s %12s %12s %8s\n",
+         "policy","category","branches","scenario","ns/op","syscalls/op","result");
+
+  for(size_t s = 0; s < args.scenarios.size(); s++)
+    {
+      for(size_t c = 0; c < args.counts.size(); c++)
+        {
+          Branches branches(minfreespace);
+
+          rv = branches.from_string(l::setup(root,args.counts[c],args.scenarios[s]));
+          if(rv < 0)
+            {
+              fprintf(stderr,"unable to set branches: %s\n",strerror(-rv));
+              return 1;
+            }
+
+          for(size_t p = Policy::Enum::begin(); p < Policy::Enum::end(); p++)
+            {
+              const Policy &policy = Policy::find((Policy::Enum::Type)p);
+
+              for(size_t k = 0; k < (sizeof(cats) / sizeof(cats[0])); k++)
+                {
+                  l::run(args,branches,policy,cats[k].cat,cats[k].path,
+                         &nsecs,&syscalls,&error);
+
+                  printf("%-8s %-8s %9llu %-8s %12.1f %12.2f %8s\n",
+                         policy.to_string().c_str(),
+                         cats[k].name,
+                         (unsigned long long)args.counts[c],
+                         l::SCENARIOS[args.scenarios[s]],
+                         nsecs,
+                         syscalls,
+                         (error ? strerrorname_np(error) : "ok"));
+                }
+            }
+          fflush(stdout);
+        }
+    }
+
+  bench::rm_rf(root);
+
+  return 0;
+}
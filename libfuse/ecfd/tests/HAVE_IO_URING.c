@@ -0,0 +1,15 @@
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+int
+main(int   argc,
+     char *argv[])
+{
+  (void)__NR_io_uring_setup;
+  (void)__NR_io_uring_enter;
+  (void)IORING_OP_READV;
+  (void)IORING_OP_WRITEV;
+  (void)IORING_FEAT_SINGLE_MMAP;
+
+  return 0;
+}
@@ -0,0 +1,12 @@
+#define _GNU_SOURCE
+#include <sys/mman.h>
+
+int
+main(int   argc,
+     char *argv[])
+{
+  (void)madvise;
+  (void)MADV_HUGEPAGE;
+
+  return 0;
+}
@@ -0,0 +1,11 @@
+#define _GNU_SOURCE
+#include <sys/mman.h>
+
+int
+main(int   argc,
+     char *argv[])
+{
+  (void)MAP_HUGETLB;
+
+  return 0;
+}
@@ -521,10 +521,12 @@ struct fuse_operations
    * file descriptor may simply be stored in the buffer for
    * later data transfer.
    *
-   * The buffer must be allocated dynamically and stored at the
-   * location pointed to by bufp.  If the buffer contains memory
-   * regions, they too must be allocated using malloc().  The
-   * allocated memory will be freed by the caller.
+   * On entry bufp points to a per thread buffer vector owned by
+   * the library which may be filled in place. Alternatively a
+   * dynamically allocated buffer may be stored at the location
+   * pointed to by bufp. If the buffer contains memory regions,
+   * they must be allocated using malloc(). The allocated memory
+   * will be freed by the caller.
    *
    * Introduced in version 2.9
    */
@@ -707,6 +709,66 @@ int fuse_loop_mt(struct fuse *f);
  */
 struct fuse_context *fuse_get_context(void);
 
+/**
+ * Allow fuse_get_context() to be used without a fuse instance
+ *
+ * For calling a filesystem's operations directly, as a benchmark
+ * might, rather than from a session's loop.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int fuse_context_standalone(void);
+
+typedef struct fuse_memstats_s fuse_memstats_t;
+struct fuse_memstats_s
+{
+  uint64_t nodes;
+  uint64_t node_bytes;
+  uint64_t table_slots;
+  uint64_t table_bytes;
+  uint64_t names;
+  uint64_t name_bytes;
+};
+
+/**
+ * Memory used by the node table: the nodes, the two hash tables
+ * indexing them and names too long to be stored in the node.
+ */
+void fuse_memstats(struct fuse *f, fuse_memstats_t *ms);
+
+/**
+ * Ask the kernel to forget entries for files, not directories, which
+ * aren't open until there are no more than max nodes. Nodes are freed
+ * once the kernel sends the matching forgets so the count drops some
+ * time later.
+ *
+ * @return the number of entries invalidated
+ */
+uint64_t fuse_trim_nodes(struct fuse *f, uint64_t max);
+
+/**
+ * Register / unregister a passthrough backing file for the current
+ * request. See fuse_passthrough_open() in fuse_lowlevel.h.
+ *
+ * @return backing id (or zero for close) on success, -errno on failure
+ */
+int fuse_backing_open(const int fd);
+int fuse_backing_close(const int backing_id);
+
+/**
+ * Hand the current write request off to the async I/O engine
+ * (io_uring, enabled with -o async_io=DEPTH). The data is copied out
+ * of buf and the reply is sent once the write completes. Only valid
+ * from within the write_buf operation.
+ *
+ * @return 0 if the request was taken over, in which case the value
+ *   returned from write_buf is ignored. Once the data has been copied
+ *   the request is always taken over, falling back to writing it
+ *   synchronously if it can't be queued. Otherwise -errno, nothing
+ *   was consumed from buf and the write should be done synchronously
+ */
+int fuse_write_buf_async(const int fd, struct fuse_bufvec *buf, const off_t off);
+
 /**
  * Check if the current request has already been interrupted
  *
@@ -84,6 +84,15 @@ struct fuse_file_info_t
 
   uint32_t auto_cache : 1;
 
+  /** Can be filled in by open or create, along with backing_id, to
+      have the kernel do reads and writes directly against the
+      backing file. */
+  uint32_t passthrough : 1;
+
+  /** Backing id returned by fuse_passthrough_open(). Only used when
+      passthrough is set. */
+  int32_t backing_id;
+
   /** File handle.  May be filled in by filesystem in open().
       Available in all other file operations */
   uint64_t fh;
@@ -106,6 +115,7 @@ struct fuse_file_info_t
  * FUSE_CAP_SPLICE_READ: ability to use splice() to read from the fuse device
  * FUSE_CAP_IOCTL_DIR: ioctl support on directories
  * FUSE_CAP_CACHE_SYMLINKS: cache READLINK responses
+ * FUSE_CAP_PASSTHROUGH: kernel can do read/write io on backing files
  */
 #define FUSE_CAP_ASYNC_READ        (1 << 0)
 #define FUSE_CAP_POSIX_LOCKS       (1 << 1)
@@ -126,6 +136,7 @@ struct fuse_file_info_t
 #define FUSE_CAP_POSIX_ACL         (1 << 19)
 #define FUSE_CAP_CACHE_SYMLINKS    (1 << 20)
 #define FUSE_CAP_MAX_PAGES         (1 << 21)
+#define FUSE_CAP_PASSTHROUGH       (1 << 22)
 
 /**
  * Ioctl flags
@@ -0,0 +1,74 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "extern_c.h"
+
+EXTERN_C_BEGIN
+
+#include <pthread.h>
+#include <stdint.h>
+
+/*
+  Optional contention counters for named mutexes. While disabled
+  taking a lock costs one extra relaxed load. While enabled a lock is
+  first tried and, only if that fails, the wait timed. Counters are
+  updated while holding the lock they describe so need no atomics of
+  their own. Locks are listed the first time they're taken while
+  enabled.
+*/
+
+typedef struct fuse_lockstat_s fuse_lockstat_t;
+struct fuse_lockstat_s
+{
+  const char      *name;
+  uint64_t         acquired;
+  uint64_t         contended;
+  uint64_t         wait_nsecs;
+  int              listed;
+  fuse_lockstat_t *next;
+};
+
+#define FUSE_LOCKSTAT_INIT(NAME) {(NAME),0,0,0,0,NULL}
+
+extern int fuse_lockstat_enabled_g;
+
+void fuse_lockstat_enable(int enabled);
+int  fuse_lockstat_enabled(void);
+void fuse_lockstat_reset(void);
+void fuse_lockstat_foreach(void (*func)(const fuse_lockstat_t *ls, void *data),
+                           void *data);
+
+int  fuse_lockstat_mutex_lock_slow(pthread_mutex_t *mutex,
+                                   fuse_lockstat_t *ls);
+
+static
+inline
+int
+fuse_lockstat_mutex_lock(pthread_mutex_t *mutex_,
+                         fuse_lockstat_t *ls_)
+{
+  if(!__atomic_load_n(&fuse_lockstat_enabled_g,__ATOMIC_RELAXED))
+    return pthread_mutex_lock(mutex_);
+
+  return fuse_lockstat_mutex_lock_slow(mutex_,ls_);
+}
+
+EXTERN_C_END
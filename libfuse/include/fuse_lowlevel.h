@@ -1157,7 +1157,7 @@ int fuse_reply_readlink(fuse_req_t req, const char *link);
  * Reply with open parameters
  *
  * currently the following members of 'fi' are used:
- *   fh, direct_io, keep_cache
+ *   fh, direct_io, keep_cache, passthrough, backing_id
  *
  * Possible requests:
  *   open, opendir
@@ -1168,6 +1168,29 @@ int fuse_reply_readlink(fuse_req_t req, const char *link);
  */
 int fuse_reply_open(fuse_req_t req, const fuse_file_info_t *fi);
 
+/**
+ * Register a file descriptor with the kernel as a passthrough backing
+ * file. The returned id can be placed in fi->backing_id along with
+ * setting fi->passthrough when replying to open or create. The id
+ * must stay registered until the file is released.
+ *
+ * Requires FUSE_CAP_PASSTHROUGH and CAP_SYS_ADMIN.
+ *
+ * @param req request handle
+ * @param fd file descriptor of the backing file
+ * @return positive backing id on success, -errno on failure
+ */
+int fuse_passthrough_open(fuse_req_t req, int fd);
+
+/**
+ * Unregister a backing id returned by fuse_passthrough_open()
+ *
+ * @param req request handle
+ * @param backing_id the id to release
+ * @return zero for success, -errno on failure
+ */
+int fuse_passthrough_close(fuse_req_t req, int backing_id);
+
 /**
  * Reply with number of bytes written
  *
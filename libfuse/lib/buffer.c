@@ -155,6 +155,26 @@ static ssize_t fuse_buf_fd_to_fd(const struct fuse_buf *dst, size_t dst_off,
 }
 
 #ifdef HAVE_SPLICE
+/*
+  Errors which mean splice can't be used between this pair of fds
+  rather than the transfer itself failing. The data is still in the
+  source so a regular read/write copy can be done instead.
+*/
+static int splice_unsupported(int err)
+{
+  switch (err) {
+  case EINVAL:
+  case ENOSYS:
+  case EOPNOTSUPP:
+#if defined(ENOTSUP) && (ENOTSUP != EOPNOTSUPP)
+  case ENOTSUP:
+#endif
+    return 1;
+  default:
+    return 0;
+  }
+}
+
 static ssize_t fuse_buf_splice(const struct fuse_buf *dst, size_t dst_off,
 			       const struct fuse_buf *src, size_t src_off,
 			       size_t len, enum fuse_buf_copy_flags flags)
@@ -188,7 +208,7 @@ static ssize_t fuse_buf_splice(const struct fuse_buf *dst, size_t dst_off,
       if (copied)
         break;
 
-      if (errno != EINVAL || (flags & FUSE_BUF_FORCE_SPLICE))
+      if (!splice_unsupported(errno) || (flags & FUSE_BUF_FORCE_SPLICE))
         return -errno;
 
       /* Maybe splice is not supported for this combination */
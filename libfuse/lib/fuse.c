@@ -16,6 +16,8 @@
 #include "fuse_misc.h"
 #include "fuse_kernel.h"
 #include "fuse_dirents.h"
+#include "fuse_lockstat.h"
+#include "fuse_uring.h"
 
 #include <assert.h>
 #include <dlfcn.h>
@@ -62,6 +64,7 @@ struct fuse_config
   int set_gid;
   int help;
   int threads;
+  unsigned int async_io;
 };
 
 struct fuse_fs
@@ -135,6 +138,11 @@ struct fuse
   struct list_head partial_slabs;
   struct list_head full_slabs;
   pthread_t prune_thread;
+  struct fuse_uring *uring;
+  size_t slabs;
+  size_t names;
+  size_t name_bytes;
+  size_t trim_pos;
 };
 
 struct lock
@@ -161,6 +169,7 @@ struct node
   struct lock *locks;
   uint64_t hidden_fh;
   char is_hidden;
+  char is_dir;
   int treelock;
   ino_t ino;
   off_t size;
@@ -186,16 +195,38 @@ struct fuse_dh
   fuse_dirents_t  d;
 };
 
+#define PATHBUF_SIZE      256
+#define PATHBUF_CACHE_MAX 16
+#define DH_CACHE_MAX      4
+#define DH_CACHE_BUFMAX   (256 * 1024)
+
+/*
+  The context is per thread and lives for the life of the thread so
+  it doubles as a cache for the buffers which would otherwise be
+  allocated and freed on every request.
+*/
 struct fuse_context_i
 {
   struct fuse_context ctx;
   fuse_req_t req;
+  int async;
+  char *pathbufs[PATHBUF_CACHE_MAX];
+  unsigned int pathbufs_size;
+  struct fuse_dh *dhs[DH_CACHE_MAX];
+  unsigned int dhs_size;
+  struct fuse_bufvec bufvec;
+  void *readbuf;
+  size_t readbufsize;
 };
 
+static fuse_lockstat_t fuse_lockstat = FUSE_LOCKSTAT_INIT("fuse");
+
 static pthread_key_t fuse_context_key;
 static pthread_mutex_t fuse_context_lock = PTHREAD_MUTEX_INITIALIZER;
 static int fuse_context_ref;
 
+static struct fuse_context_i *fuse_get_context_internal(void);
+
 static
 void
 init_list_head(struct list_head *list)
@@ -326,6 +357,7 @@ alloc_slab(struct fuse *f)
       list_add_tail(n,&slab->freelist);
     }
   list_add_tail(&slab->list,&f->partial_slabs);
+  f->slabs++;
 
   return 0;
 }
@@ -368,6 +400,7 @@ free_slab(struct fuse      *f,
   res = munmap(slab,f->pagesize);
   if(res == -1)
     fprintf(stderr,"fuse warning: munmap(%p) failed\n",slab);
+  f->slabs--;
 }
 
 static
@@ -482,13 +515,25 @@ set_forget_time(struct fuse *f,
   curr_time(&lnode->forget_time);
 }
 
+static
+void
+free_name(struct fuse *f_,
+          struct node *node_)
+{
+  if((node_->name == NULL) || (node_->name == node_->inline_name))
+    return;
+
+  f_->names--;
+  f_->name_bytes -= (strlen(node_->name) + 1);
+  free(node_->name);
+}
+
 static
 void
 free_node(struct fuse *f_,
           struct node *node_)
 {
-  if(node_->name != node_->inline_name)
-    free(node_->name);
+  free_name(f_,node_);
 
   if(node_->is_hidden)
     fuse_fs_free_hide(f_->fs,node_->hidden_fh);
@@ -704,8 +749,7 @@ unhash_name(struct fuse *f,
             *nodep = node->name_next;
             node->name_next = NULL;
             unref_node(f,node->parent);
-            if(node->name != node->inline_name)
-              free(node->name);
+            free_name(f,node);
             node->name = NULL;
             node->parent = NULL;
             f->name_table.use--;
@@ -778,6 +822,8 @@ hash_name(struct fuse *f,
       node->name = strdup(name);
       if(node->name == NULL)
         return -1;
+      f->names++;
+      f->name_bytes += (strlen(name) + 1);
     }
 
   parent->refctr ++;
@@ -882,7 +928,7 @@ find_node(struct fuse *f,
 {
   struct node *node;
 
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
   if(!name)
     node = get_node(f,parent);
   else
@@ -921,6 +967,38 @@ find_node(struct fuse *f,
   return node;
 }
 
+/*
+  Path buffers start at PATHBUF_SIZE and only ever grow (via
+  add_name) so any buffer in the cache is at least that size.
+*/
+static
+char*
+alloc_pathbuf(void)
+{
+  struct fuse_context_i *c = fuse_get_context_internal();
+
+  if(c->pathbufs_size)
+    return c->pathbufs[--c->pathbufs_size];
+
+  return malloc(PATHBUF_SIZE);
+}
+
+static
+void
+free_pathbuf(char *buf)
+{
+  struct fuse_context_i *c;
+
+  if(buf == NULL)
+    return;
+
+  c = fuse_get_context_internal();
+  if(c->pathbufs_size < PATHBUF_CACHE_MAX)
+    c->pathbufs[c->pathbufs_size++] = buf;
+  else
+    free(buf);
+}
+
 static
 char*
 add_name(char       **buf,
@@ -996,7 +1074,7 @@ try_get_path(struct fuse  *f,
              struct node **wnodep,
              bool          need_lock)
 {
-  unsigned bufsize = 256;
+  unsigned bufsize = PATHBUF_SIZE;
   char *buf;
   char *s;
   struct node *node;
@@ -1006,7 +1084,7 @@ try_get_path(struct fuse  *f,
   *path = NULL;
 
   err = -ENOMEM;
-  buf = malloc(bufsize);
+  buf = alloc_pathbuf();
   if(buf == NULL)
     goto out_err;
 
@@ -1074,7 +1152,7 @@ try_get_path(struct fuse  *f,
   if(need_lock)
     unlock_path(f,nodeid,wnode,node);
  out_free:
-  free(buf);
+  free_pathbuf(buf);
 
  out_err:
   return err;
@@ -1251,7 +1329,7 @@ get_path_common(struct fuse  *f,
 {
   int err;
 
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
   err = try_get_path(f,nodeid,name,path,wnode,true);
   if(err == -EAGAIN)
     {
@@ -1325,7 +1403,7 @@ try_get_path2(struct fuse  *f,
           struct node *wn1 = wnode1 ? *wnode1 : NULL;
 
           unlock_path(f,nodeid1,wn1,NULL);
-          free(*path1);
+          free_pathbuf(*path1);
         }
     }
 
@@ -1346,7 +1424,7 @@ get_path2(struct fuse  *f,
 {
   int err;
 
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
   err = try_get_path2(f,nodeid1,name1,nodeid2,name2,
                       path1,path2,wnode1,wnode2);
   if(err == -EAGAIN)
@@ -1380,12 +1458,12 @@ free_path_wrlock(struct fuse *f,
                  struct node *wnode,
                  char        *path)
 {
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
   unlock_path(f,nodeid,wnode,NULL);
   if(f->lockq)
     wake_up_queued(f);
   pthread_mutex_unlock(&f->lock);
-  free(path);
+  free_pathbuf(path);
 }
 
 static
@@ -1408,13 +1486,13 @@ free_path2(struct fuse *f,
            char        *path1,
            char        *path2)
 {
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
   unlock_path(f,nodeid1,wnode1,NULL);
   unlock_path(f,nodeid2,wnode2,NULL);
   wake_up_queued(f);
   pthread_mutex_unlock(&f->lock);
-  free(path1);
-  free(path2);
+  free_pathbuf(path1);
+  free_pathbuf(path2);
 }
 
 static
@@ -1428,7 +1506,7 @@ forget_node(struct fuse      *f,
   if(nodeid == FUSE_ROOT_ID)
     return;
 
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
   node = get_node(f,nodeid);
 
   /*
@@ -1485,7 +1563,7 @@ remove_node(struct fuse *f,
 {
   struct node *node;
 
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
   node = lookup_node(f,dir,name);
   if(node != NULL)
     unlink_node(f,node);
@@ -1504,7 +1582,7 @@ rename_node(struct fuse *f,
   struct node *newnode;
   int err = 0;
 
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
   node = lookup_node(f,olddir,oldname);
   newnode = lookup_node(f,newdir,newname);
   if(node == NULL)
@@ -1746,18 +1824,49 @@ fuse_fs_open(struct fuse_fs   *fs,
   return err;
 }
 
+/*
+  The per thread bufvec and read buffer are owned by the context and
+  reused. Anything else was allocated by the filesystem.
+*/
 static
 void
 fuse_free_buf(struct fuse_bufvec *buf)
 {
-  if(buf != NULL)
-    {
-      size_t i;
+  size_t i;
+  struct fuse_context_i *c;
 
-      for(i = 0; i < buf->count; i++)
+  if(buf == NULL)
+    return;
+
+  c = fuse_get_context_internal();
+  for(i = 0; i < buf->count; i++)
+    {
+      if(buf->buf[i].mem != c->readbuf)
         free(buf->buf[i].mem);
-      free(buf);
     }
+
+  if(buf != &c->bufvec)
+    free(buf);
+}
+
+static
+void*
+get_readbuf(struct fuse_context_i *c,
+            size_t                 size)
+{
+  void *mem;
+
+  if(c->readbufsize >= size)
+    return c->readbuf;
+
+  mem = realloc(c->readbuf,size);
+  if(mem == NULL)
+    return NULL;
+
+  c->readbuf     = mem;
+  c->readbufsize = size;
+
+  return mem;
 }
 
 int
@@ -1778,6 +1887,11 @@ fuse_fs_read_buf(struct fuse_fs      *fs,
                 (unsigned long long)fi->fh,
                 size,(unsigned long long)off,fi->flags);
 
+      struct fuse_context_i *c = fuse_get_context_internal();
+
+      c->bufvec = FUSE_BUFVEC_INIT(size);
+      *bufp = &c->bufvec;
+
       if(fs->op.read_buf)
         {
           res = fs->op.read_buf(fi,bufp,size,off);
@@ -1787,20 +1901,15 @@ fuse_fs_read_buf(struct fuse_fs      *fs,
           struct fuse_bufvec *buf;
           void *mem;
 
-          buf = malloc(sizeof(struct fuse_bufvec));
-          if(buf == NULL)
-            return -ENOMEM;
-
-          mem = malloc(size);
+          mem = get_readbuf(c,size);
           if(mem == NULL)
             {
-            free(buf);
-            return -ENOMEM;
-          }
+              *bufp = NULL;
+              return -ENOMEM;
+            }
 
-          *buf = FUSE_BUFVEC_INIT(size);
+          buf = *bufp;
           buf->buf[0].mem = mem;
-          *bufp = buf;
 
           res = fs->op.read(fi,mem,size,off);
           if(res >= 0)
@@ -2536,9 +2645,10 @@ update_stat(struct node       *node_,
       (node_->size         != stnew_->st_size)))
     node_->stat_cache_valid = 0;
 
-  node_->ino  = stnew_->st_ino;
-  node_->size = stnew_->st_size;
-  node_->mtim = stnew_->st_mtim;
+  node_->ino    = stnew_->st_ino;
+  node_->size   = stnew_->st_size;
+  node_->mtim   = stnew_->st_mtim;
+  node_->is_dir = S_ISDIR(stnew_->st_mode);
 }
 
 static
@@ -2572,7 +2682,7 @@ lookup_path(struct fuse             *f,
           e->ino        = node->nodeid;
           e->generation = node->generation;
 
-          pthread_mutex_lock(&f->lock);
+          fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
           update_stat(node,&e->attr);
           pthread_mutex_unlock(&f->lock);
 
@@ -2617,7 +2727,21 @@ static
 void
 fuse_freecontext(void *data)
 {
-  free(data);
+  struct fuse_context_i *c = data;
+
+  if(c == NULL)
+    return;
+
+  while(c->pathbufs_size)
+    free(c->pathbufs[--c->pathbufs_size]);
+  while(c->dhs_size)
+    {
+      struct fuse_dh *dh = c->dhs[--c->dhs_size];
+      fuse_dirents_free(&dh->d);
+      free(dh);
+    }
+  free(c->readbuf);
+  free(c);
 }
 
 static
@@ -2650,7 +2774,7 @@ fuse_delete_context_key(void)
   fuse_context_ref--;
   if(!fuse_context_ref)
     {
-      free(pthread_getspecific(fuse_context_key));
+      fuse_freecontext(pthread_getspecific(fuse_context_key));
       pthread_key_delete(fuse_context_key);
     }
   pthread_mutex_unlock(&fuse_context_lock);
@@ -2663,6 +2787,7 @@ req_fuse_prepare(fuse_req_t req)
   struct fuse_context_i *c = fuse_get_context_internal();
   const struct fuse_ctx *ctx = fuse_req_ctx(req);
   c->req = req;
+  c->async = 0;
   c->ctx.fuse = req_fuse(req);
   c->ctx.uid = ctx->uid;
   c->ctx.gid = ctx->gid;
@@ -2730,6 +2855,10 @@ fuse_lib_init(void                  *data,
   c->ctx.fuse = f;
   conn->want |= FUSE_CAP_EXPORT_SUPPORT;
   fuse_fs_init(f->fs,conn);
+
+  /* created here rather than in fuse_new so it survives daemonizing */
+  if(f->conf.async_io && (f->uring == NULL))
+    f->uring = fuse_uring_new(f->conf.async_io);
 }
 
 void
@@ -2772,7 +2901,7 @@ fuse_lib_lookup(fuse_req_t  req,
 
       if(len == 1 || (name[1] == '.' && len == 2))
         {
-          pthread_mutex_lock(&f->lock);
+          fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
           if(len == 1)
             {
               if(f->conf.debug)
@@ -2812,7 +2941,7 @@ fuse_lib_lookup(fuse_req_t  req,
     }
   if(dot)
     {
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       unref_node(f,dot);
       pthread_mutex_unlock(&f->lock);
     }
@@ -2877,7 +3006,7 @@ fuse_lib_getattr(fuse_req_t        req,
   f = req_fuse_prepare(req);
   if(fi == NULL)
     {
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       node = get_node(f,ino);
       if(node->is_hidden)
         {
@@ -2905,7 +3034,7 @@ fuse_lib_getattr(fuse_req_t        req,
 
   if(!err)
     {
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       node = get_node(f,ino);
       update_stat(node,&buf);
       pthread_mutex_unlock(&f->lock);
@@ -2962,7 +3091,7 @@ fuse_lib_setattr(fuse_req_t        req,
 
   if(fi == NULL)
     {
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       node = get_node(f,ino);
       if(node->is_hidden)
         {
@@ -3051,7 +3180,7 @@ fuse_lib_setattr(fuse_req_t        req,
 
   if(!err)
     {
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       update_stat(get_node(f,ino),&buf);
       pthread_mutex_unlock(&f->lock);
       set_stat(f,ino,&buf);
@@ -3192,7 +3321,7 @@ fuse_lib_unlink(fuse_req_t  req,
 
   if(!err)
     {
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       if(node_open(wnode))
         {
           err = fuse_fs_prepare_hide(f->fs,path,&wnode->hidden_fh);
@@ -3279,7 +3408,7 @@ fuse_lib_rename(fuse_req_t  req,
 
   if(!err)
     {
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       if(node_open(wnode2))
         {
           err = fuse_fs_prepare_hide(f->fs,newpath,&wnode2->hidden_fh);
@@ -3334,7 +3463,7 @@ fuse_do_release(struct fuse      *f,
   fh = 0;
   fuse_fs_release(f->fs,fi);
 
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
   node = get_node(f,ino);
   assert(node->open_count > 0);
   node->open_count--;
@@ -3387,7 +3516,7 @@ fuse_lib_create(fuse_req_t        req,
 
   if(!err)
     {
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       get_node(f,e.ino)->open_count++;
       pthread_mutex_unlock(&f->lock);
 
@@ -3426,7 +3555,7 @@ open_auto_cache(struct fuse      *f,
   struct node *node;
   fuse_timeouts_t timeout;
 
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
 
   node = get_node(f,ino);
   if(node->stat_cache_valid)
@@ -3436,7 +3565,7 @@ open_auto_cache(struct fuse      *f,
 
       pthread_mutex_unlock(&f->lock);
       err = fuse_fs_fgetattr(f->fs,&stbuf,fi,&timeout);
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
 
       if(!err)
         update_stat(node,&stbuf);
@@ -3476,7 +3605,7 @@ fuse_lib_open(fuse_req_t        req,
 
   if(!err)
     {
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       get_node(f,ino)->open_count++;
       pthread_mutex_unlock(&f->lock);
       /* The open syscall was interrupted,so it must be cancelled */
@@ -3506,9 +3635,14 @@ fuse_lib_read(fuse_req_t        req,
   res = fuse_fs_read_buf(f->fs,&buf,size,off,fi);
 
   if(res == 0)
-    fuse_reply_data(req,buf,FUSE_BUF_SPLICE_MOVE);
+    {
+      if((f->uring == NULL) || (fuse_uring_read(f->uring,req,buf) != 0))
+        fuse_reply_data(req,buf,FUSE_BUF_SPLICE_MOVE);
+    }
   else
-    reply_err(req,res);
+    {
+      reply_err(req,res);
+    }
 
   fuse_free_buf(buf);
 }
@@ -3527,6 +3661,9 @@ fuse_lib_write_buf(fuse_req_t          req,
   res = fuse_fs_write_buf(f->fs,buf,off,fi);
   free_path(f,ino,NULL);
 
+  if(fuse_get_context_internal()->async)
+    return;
+
   if(res >= 0)
     fuse_reply_write(req,res);
   else
@@ -3559,6 +3696,61 @@ get_dirhandle(const fuse_file_info_t *llfi,
   return dh;
 }
 
+/*
+  Released directory handles are kept, along with their entry
+  buffers, like path buffers are so listing a directory doesn't
+  allocate. Handles whose buffer grew past DH_CACHE_BUFMAX listing a
+  large directory are freed rather than pinning the memory.
+*/
+static
+struct fuse_dh*
+alloc_dirhandle(void)
+{
+  struct fuse_dh *dh;
+  struct fuse_context_i *c = fuse_get_context_internal();
+
+  if(c->dhs_size)
+    {
+      dh = c->dhs[--c->dhs_size];
+      fuse_dirents_reset(&dh->d);
+    }
+  else
+    {
+      dh = (struct fuse_dh *)calloc(1,sizeof(struct fuse_dh));
+      if(dh == NULL)
+        return NULL;
+      if(fuse_dirents_init(&dh->d) != 0)
+        {
+          free(dh);
+          return NULL;
+        }
+    }
+
+  dh->fh = 0;
+  fuse_mutex_init(&dh->lock);
+
+  return dh;
+}
+
+static
+void
+free_dirhandle(struct fuse_dh *dh)
+{
+  struct fuse_context_i *c;
+
+  pthread_mutex_destroy(&dh->lock);
+
+  c = fuse_get_context_internal();
+  if((c->dhs_size < DH_CACHE_MAX) && (dh->d.buf_len <= DH_CACHE_BUFMAX))
+    {
+      c->dhs[c->dhs_size++] = dh;
+      return;
+    }
+
+  fuse_dirents_free(&dh->d);
+  free(dh);
+}
+
 static
 void
 fuse_lib_opendir(fuse_req_t        req,
@@ -3571,16 +3763,13 @@ fuse_lib_opendir(fuse_req_t        req,
   fuse_file_info_t fi;
   struct fuse *f = req_fuse_prepare(req);
 
-  dh = (struct fuse_dh *)calloc(1,sizeof(struct fuse_dh));
+  dh = alloc_dirhandle();
   if(dh == NULL)
     {
       reply_err(req,-ENOMEM);
       return;
     }
 
-  fuse_dirents_init(&dh->d);
-  fuse_mutex_init(&dh->lock);
-
   llfi->fh = (uintptr_t)dh;
 
   memset(&fi,0,sizeof(fi));
@@ -3602,15 +3791,13 @@ fuse_lib_opendir(fuse_req_t        req,
           /* The opendir syscall was interrupted,so it
              must be cancelled */
           fuse_fs_releasedir(f->fs,&fi);
-          pthread_mutex_destroy(&dh->lock);
-          free(dh);
+          free_dirhandle(dh);
         }
     }
   else
     {
       reply_err(req,err);
-      pthread_mutex_destroy(&dh->lock);
-      free(dh);
+      free_dirhandle(dh);
     }
   free_path(f,ino,path);
 }
@@ -3762,9 +3949,7 @@ fuse_lib_releasedir(fuse_req_t        req_,
   /* Done to keep race condition between last readdir reply and the unlock */
   pthread_mutex_lock(&dh->lock);
   pthread_mutex_unlock(&dh->lock);
-  pthread_mutex_destroy(&dh->lock);
-  fuse_dirents_free(&dh->d);
-  free(dh);
+  free_dirhandle(dh);
   reply_err(req_,0);
 }
 
@@ -4165,7 +4350,7 @@ fuse_flush_common(struct fuse      *f,
     {
       flock_to_lock(&lock,&l);
       l.owner = fi->lock_owner;
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       locks_insert(get_node(f,ino),&l);
       pthread_mutex_unlock(&f->lock);
 
@@ -4243,7 +4428,7 @@ fuse_lib_getlk(fuse_req_t        req,
 
   flock_to_lock(lock,&l);
   l.owner = fi->lock_owner;
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
   conflict = locks_conflict(get_node(f,ino),&l);
   if(conflict)
     lock_to_flock(conflict,lock);
@@ -4275,7 +4460,7 @@ fuse_lib_setlk(fuse_req_t        req,
       struct lock l;
       flock_to_lock(lock,&l);
       l.owner = fi->lock_owner;
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       locks_insert(get_node(f,ino),&l);
       pthread_mutex_unlock(&f->lock);
     }
@@ -4436,7 +4621,7 @@ fuse_clean_cache(struct fuse *f)
   struct node *node;
   struct timespec now;
 
-  pthread_mutex_lock(&f->lock);
+  fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
 
   curr_time(&now);
 
@@ -4604,6 +4789,142 @@ fuse_get_context(void)
   return &fuse_get_context_internal()->ctx;
 }
 
+int
+fuse_context_standalone(void)
+{
+  return fuse_create_context_key();
+}
+
+void
+fuse_memstats(struct fuse     *f_,
+              fuse_memstats_t *ms_)
+{
+  fuse_lockstat_mutex_lock(&f_->lock,&fuse_lockstat);
+  ms_->nodes = f_->id_table.use;
+#ifdef FUSE_NODE_SLAB
+  ms_->node_bytes = (f_->slabs * f_->pagesize);
+#else
+  ms_->node_bytes = (f_->id_table.use * get_node_size(f_));
+#endif
+  ms_->table_slots = (f_->id_table.size + f_->name_table.size);
+  ms_->table_bytes = (ms_->table_slots * sizeof(struct node*));
+  ms_->names       = f_->names;
+  ms_->name_bytes  = f_->name_bytes;
+  pthread_mutex_unlock(&f_->lock);
+}
+
+#define TRIM_BATCH 4096
+
+struct trim_entry
+{
+  fuse_ino_t  parent;
+  char       *name;
+};
+
+/*
+  Picks up where the last call left off so the same entries aren't
+  invalidated over and over. The notifications are sent without the
+  lock held as the kernel may need to wait on requests which need it.
+
+  Directories are never trimmed. Invalidating one makes the kernel
+  d_invalidate it, which detaches anything mounted beneath it and
+  leaves processes inside it with a cwd getcwd can't resolve.
+*/
+uint64_t
+fuse_trim_nodes(struct fuse    *f_,
+                const uint64_t  max_)
+{
+  size_t i;
+  size_t n;
+  size_t want;
+  size_t scanned;
+  struct node *node;
+  struct fuse_chan *ch;
+  struct trim_entry *entries;
+
+  n = 0;
+  fuse_lockstat_mutex_lock(&f_->lock,&fuse_lockstat);
+  want = ((f_->id_table.use > max_) ? (f_->id_table.use - max_) : 0);
+  if(want > TRIM_BATCH)
+    want = TRIM_BATCH;
+
+  entries = NULL;
+  if(want > 0)
+    entries = malloc(want * sizeof(struct trim_entry));
+
+  for(scanned = 0;
+      (entries != NULL) && (n < want) && (scanned < f_->id_table.size);
+      scanned++)
+    {
+      f_->trim_pos = ((f_->trim_pos + 1) % f_->id_table.size);
+      for(node = f_->id_table.array[f_->trim_pos];
+          (node != NULL) && (n < want);
+          node = node->id_next)
+        {
+          if((node->nodeid == FUSE_ROOT_ID) ||
+             (node->name == NULL)           ||
+             (node->parent == NULL)         ||
+             (node->open_count > 0)         ||
+             (node->refctr > 1)             ||
+             (node->treelock != 0)          ||
+             node->is_hidden                ||
+             node->is_dir)
+            continue;
+
+          entries[n].name = strdup(node->name);
+          if(entries[n].name == NULL)
+            continue;
+          entries[n].parent = node->parent->nodeid;
+          n++;
+        }
+    }
+  pthread_mutex_unlock(&f_->lock);
+
+  ch = fuse_session_next_chan(f_->se,NULL);
+  for(i = 0; i < n; i++)
+    {
+      fuse_lowlevel_notify_inval_entry(ch,
+                                       entries[i].parent,
+                                       entries[i].name,
+                                       strlen(entries[i].name));
+      free(entries[i].name);
+    }
+  free(entries);
+
+  return n;
+}
+
+int
+fuse_write_buf_async(const int           fd_,
+                     struct fuse_bufvec *buf_,
+                     const off_t         off_)
+{
+  int rv;
+  struct fuse_context_i *c = fuse_get_context_internal();
+  struct fuse *f = c->ctx.fuse;
+
+  if(f->uring == NULL)
+    return -ENOSYS;
+
+  rv = fuse_uring_write(f->uring,c->req,fd_,buf_,off_);
+  if(rv == 0)
+    c->async = 1;
+
+  return rv;
+}
+
+int
+fuse_backing_open(const int fd_)
+{
+  return fuse_passthrough_open(fuse_get_context_internal()->req,fd_);
+}
+
+int
+fuse_backing_close(const int backing_id_)
+{
+  return fuse_passthrough_close(fuse_get_context_internal()->req,backing_id_);
+}
+
 enum {
   KEY_HELP,
 };
@@ -4627,6 +4948,7 @@ static const struct fuse_opt fuse_lib_opts[] =
     FUSE_LIB_OPT("noforget",           remember,-1),
     FUSE_LIB_OPT("remember=%u",        remember,0),
     FUSE_LIB_OPT("threads=%d",         threads,0),
+    FUSE_LIB_OPT("async_io=%u",        async_io,0),
     FUSE_LIB_OPT("use_ino",            use_ino,1),
     FUSE_OPT_END
   };
@@ -4642,6 +4964,8 @@ static void fuse_lib_help(void)
           "    -o threads=NUM         number of worker threads. 0 = autodetect.\n"
           "                           Negative values autodetect then divide by\n"
           "                           absolute value. default = 0\n"
+          "    -o async_io=DEPTH      submit reads/writes to io_uring with up to\n"
+          "                           DEPTH in flight. 0 = off. default = 0\n"
           "\n");
 }
 
@@ -4743,7 +5067,7 @@ fuse_stop_cleanup_thread(struct fuse *f)
 {
   if(lru_enabled(f))
     {
-      pthread_mutex_lock(&f->lock);
+      fuse_lockstat_mutex_lock(&f->lock,&fuse_lockstat);
       pthread_cancel(f->prune_thread);
       pthread_mutex_unlock(&f->lock);
       pthread_join(f->prune_thread,NULL);
@@ -4869,11 +5193,15 @@ fuse_destroy(struct fuse *f)
 {
   size_t i;
 
+  fuse_uring_destroy(f->uring);
+  f->uring = NULL;
+
   if(f->fs)
     {
       struct fuse_context_i *c = fuse_get_context_internal();
 
-      memset(c,0,sizeof(*c));
+      memset(&c->ctx,0,sizeof(c->ctx));
+      c->req      = NULL;
       c->ctx.fuse = f;
 
       for(i = 0; i < f->id_table.size; i++)
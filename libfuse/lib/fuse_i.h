@@ -86,6 +86,9 @@ struct fuse_ll
   pthread_mutex_t lock;
   int got_destroy;
   pthread_key_t pipe_key;
+  pthread_key_t req_cache_key;
+  pthread_key_t replybuf_key;
+  int hugepages;
   int broken_splice_nonblock;
   uint64_t notify_ctr;
   struct fuse_notify_req notify_list;
@@ -0,0 +1,129 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#define _GNU_SOURCE
+
+#include "fuse_lockstat.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+int fuse_lockstat_enabled_g = 0;
+
+static pthread_mutex_t  g_lock = PTHREAD_MUTEX_INITIALIZER;
+static fuse_lockstat_t *g_list = NULL;
+
+static
+uint64_t
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+
+  return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+}
+
+static
+void
+list_add(fuse_lockstat_t *ls_)
+{
+  pthread_mutex_lock(&g_lock);
+  if(!ls_->listed)
+    {
+      ls_->next = g_list;
+      g_list    = ls_;
+      __atomic_store_n(&ls_->listed,1,__ATOMIC_RELEASE);
+    }
+  pthread_mutex_unlock(&g_lock);
+}
+
+void
+fuse_lockstat_enable(int enabled_)
+{
+  __atomic_store_n(&fuse_lockstat_enabled_g,!!enabled_,__ATOMIC_RELAXED);
+}
+
+int
+fuse_lockstat_enabled(void)
+{
+  return __atomic_load_n(&fuse_lockstat_enabled_g,__ATOMIC_RELAXED);
+}
+
+/*
+  Racy against lockers but only used to start a new measurement.
+*/
+void
+fuse_lockstat_reset(void)
+{
+  fuse_lockstat_t *ls;
+
+  pthread_mutex_lock(&g_lock);
+  for(ls = g_list; ls != NULL; ls = ls->next)
+    {
+      __atomic_store_n(&ls->acquired,0,__ATOMIC_RELAXED);
+      __atomic_store_n(&ls->contended,0,__ATOMIC_RELAXED);
+      __atomic_store_n(&ls->wait_nsecs,0,__ATOMIC_RELAXED);
+    }
+  pthread_mutex_unlock(&g_lock);
+}
+
+void
+fuse_lockstat_foreach(void (*func_)(const fuse_lockstat_t *ls, void *data),
+                      void  *data_)
+{
+  fuse_lockstat_t *ls;
+
+  pthread_mutex_lock(&g_lock);
+  for(ls = g_list; ls != NULL; ls = ls->next)
+    func_(ls,data_);
+  pthread_mutex_unlock(&g_lock);
+}
+
+int
+fuse_lockstat_mutex_lock_slow(pthread_mutex_t *mutex_,
+                              fuse_lockstat_t *ls_)
+{
+  int rv;
+  uint64_t start;
+  uint64_t wait;
+
+  if(!__atomic_load_n(&ls_->listed,__ATOMIC_ACQUIRE))
+    list_add(ls_);
+
+  rv = pthread_mutex_trylock(mutex_);
+  if(rv == 0)
+    {
+      __atomic_store_n(&ls_->acquired,ls_->acquired + 1,__ATOMIC_RELAXED);
+      return 0;
+    }
+
+  start = now();
+  rv = pthread_mutex_lock(mutex_);
+  if(rv != 0)
+    return rv;
+  wait = (now() - start);
+
+  __atomic_store_n(&ls_->acquired,ls_->acquired + 1,__ATOMIC_RELAXED);
+  __atomic_store_n(&ls_->contended,ls_->contended + 1,__ATOMIC_RELAXED);
+  __atomic_store_n(&ls_->wait_nsecs,ls_->wait_nsecs + wait,__ATOMIC_RELAXED);
+
+  return 0;
+}
@@ -10,6 +10,7 @@
 #include "fuse_kernel.h"
 #include "fuse_lowlevel.h"
 #include "fuse_misc.h"
+#include "fuse_msgbuf.h"
 
 #include <errno.h>
 #include <semaphore.h>
@@ -145,7 +146,7 @@ static int fuse_loop_start_thread(struct fuse_mt *mt)
   }
   memset(w, 0, sizeof(struct fuse_worker));
   w->bufsize = fuse_chan_bufsize(mt->prevch);
-  w->buf = calloc(w->bufsize,1);
+  w->buf = msgbuf_alloc(w->bufsize);
   w->mt = mt;
   if(!w->buf) {
     fprintf(stderr, "fuse: failed to allocate read buffer\n");
@@ -155,7 +156,7 @@ static int fuse_loop_start_thread(struct fuse_mt *mt)
 
   res = fuse_start_thread(&w->thread_id, fuse_do_work, w);
   if(res == -1) {
-    free(w->buf);
+    msgbuf_free(w->buf,w->bufsize);
     free(w);
     return -1;
   }
@@ -168,7 +169,7 @@ static void fuse_join_worker(struct fuse_worker *w)
 {
   pthread_join(w->thread_id, NULL);
   list_del_worker(w);
-  free(w->buf);
+  msgbuf_free(w->buf,w->bufsize);
   free(w);
 }
 
@@ -13,6 +13,7 @@
 #include "fuse_kernel.h"
 #include "fuse_opt.h"
 #include "fuse_misc.h"
+#include "fuse_msgbuf.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -23,6 +24,7 @@
 #include <errno.h>
 #include <assert.h>
 #include <sys/file.h>
+#include <sys/ioctl.h>
 
 #ifndef F_LINUX_SPECIFIC_BASE
 #define F_LINUX_SPECIFIC_BASE       1024
@@ -135,12 +137,74 @@ list_add_req(struct fuse_req *req,
   next->prev = req;
 }
 
+/*
+  Requests are recycled through a small per-thread freelist so the
+  steady state request path doesn't touch the heap. A request may be
+  freed on a different thread than it was allocated on. That's fine,
+  it just ends up in that thread's list.
+*/
+#define FUSE_REQ_CACHE_MAX 64
+
+struct fuse_req_cache
+{
+  struct fuse_req *head;
+  unsigned int     size;
+};
+
+static
+struct fuse_req_cache*
+fuse_ll_get_req_cache(struct fuse_ll *f)
+{
+  struct fuse_req_cache *rc;
+
+  rc = pthread_getspecific(f->req_cache_key);
+  if (rc == NULL)
+    {
+      rc = calloc(1, sizeof(struct fuse_req_cache));
+      if (rc == NULL)
+        return NULL;
+
+      pthread_setspecific(f->req_cache_key, rc);
+    }
+
+  return rc;
+}
+
+static
+void
+fuse_ll_req_cache_destructor(void *data)
+{
+  struct fuse_req *req;
+  struct fuse_req_cache *rc = data;
+
+  while (rc->head != NULL)
+    {
+      req = rc->head;
+      rc->head = req->next;
+      free(req);
+    }
+
+  free(rc);
+}
+
 static
 void
 destroy_req(fuse_req_t req)
 {
+  struct fuse_req_cache *rc;
+
   pthread_mutex_destroy(&req->lock);
-  free(req);
+
+  rc = fuse_ll_get_req_cache(req->f);
+  if ((rc == NULL) || (rc->size >= FUSE_REQ_CACHE_MAX))
+    {
+      free(req);
+      return;
+    }
+
+  req->next = rc->head;
+  rc->head = req;
+  rc->size++;
 }
 
 void
@@ -164,8 +228,20 @@ struct fuse_req*
 fuse_ll_alloc_req(struct fuse_ll *f)
 {
   struct fuse_req *req;
+  struct fuse_req_cache *rc;
 
-  req = (struct fuse_req *) calloc(1, sizeof(struct fuse_req));
+  req = NULL;
+  rc  = fuse_ll_get_req_cache(f);
+  if ((rc != NULL) && (rc->head != NULL))
+    {
+      req = rc->head;
+      rc->head = req->next;
+      rc->size--;
+      memset(req, 0, sizeof(struct fuse_req));
+    }
+
+  if (req == NULL)
+    req = (struct fuse_req *) calloc(1, sizeof(struct fuse_req));
   if (req == NULL)
     {
       fprintf(stderr, "fuse: failed to allocate request\n");
@@ -408,6 +484,11 @@ fill_open(struct fuse_open_out   *arg,
     arg->open_flags |= FOPEN_NONSEEKABLE;
   if (f->cache_readdir)
     arg->open_flags |= FOPEN_CACHE_DIR;
+  if (f->passthrough)
+    {
+      arg->open_flags |= FOPEN_PASSTHROUGH;
+      arg->backing_id  = f->backing_id;
+    }
 }
 
 int
@@ -483,6 +564,38 @@ fuse_reply_open(fuse_req_t              req,
   return send_reply_ok(req, &arg, sizeof(arg));
 }
 
+int
+fuse_passthrough_open(fuse_req_t req,
+                      int        fd)
+{
+  int rv;
+  struct fuse_backing_map map = {0};
+
+  map.fd = fd;
+
+  rv = ioctl(fuse_chan_fd(req->ch), FUSE_DEV_IOC_BACKING_OPEN, &map);
+  if (rv == -1)
+    return -errno;
+  if (rv == 0)
+    return -EIO;
+
+  return rv;
+}
+
+int
+fuse_passthrough_close(fuse_req_t req,
+                       int        backing_id)
+{
+  int rv;
+  uint32_t id = backing_id;
+
+  rv = ioctl(fuse_chan_fd(req->ch), FUSE_DEV_IOC_BACKING_CLOSE, &id);
+  if (rv == -1)
+    return -errno;
+
+  return 0;
+}
+
 int
 fuse_reply_write(fuse_req_t req,
                  size_t     count)
@@ -503,6 +616,59 @@ fuse_reply_buf(fuse_req_t  req,
   return send_reply_ok(req, buf, size);
 }
 
+/*
+  Per thread buffer for replies whose data has to be copied out of a
+  file descriptor first. Sized for the largest message so it can be
+  reused for every read rather than allocating one per request.
+*/
+struct fuse_ll_replybuf
+{
+  void   *mem;
+  size_t  size;
+};
+
+static
+void
+fuse_ll_replybuf_destructor(void *data)
+{
+  struct fuse_ll_replybuf *rb = data;
+
+  msgbuf_free(rb->mem, rb->size);
+  free(rb);
+}
+
+static
+void*
+fuse_ll_get_replybuf(struct fuse_ll   *f,
+                     struct fuse_chan *ch,
+                     size_t            len)
+{
+  struct fuse_ll_replybuf *rb;
+
+  rb = pthread_getspecific(f->replybuf_key);
+  if (rb == NULL)
+    {
+      rb = malloc(sizeof(struct fuse_ll_replybuf));
+      if (rb == NULL)
+        return NULL;
+
+      rb->size = fuse_chan_bufsize(ch);
+      rb->mem  = msgbuf_alloc(rb->size);
+      if (rb->mem == NULL)
+        {
+          free(rb);
+          return NULL;
+        }
+
+      pthread_setspecific(f->replybuf_key, rb);
+    }
+
+  if (len > rb->size)
+    return NULL;
+
+  return rb->mem;
+}
+
 static
 int
 fuse_send_data_iov_fallback(struct fuse_ll     *f,
@@ -514,6 +680,7 @@ fuse_send_data_iov_fallback(struct fuse_ll     *f,
 {
   int res;
   void *mbuf;
+  int allocated = 0;
   struct fuse_bufvec mem_buf = FUSE_BUFVEC_INIT(len);
 
   /* Optimize common case */
@@ -530,15 +697,21 @@ fuse_send_data_iov_fallback(struct fuse_ll     *f,
       return fuse_send_msg(f, ch, iov, iov_count);
     }
 
-  res = posix_memalign(&mbuf, pagesize, len);
-  if (res != 0)
-    return res;
+  mbuf = fuse_ll_get_replybuf(f, ch, len);
+  if (mbuf == NULL)
+    {
+      res = posix_memalign(&mbuf, pagesize, len);
+      if (res != 0)
+        return res;
+      allocated = 1;
+    }
 
   mem_buf.buf[0].mem = mbuf;
   res = fuse_buf_copy(&mem_buf, buf, 0);
   if (res < 0)
     {
-      free(mbuf);
+      if (allocated)
+        free(mbuf);
       return -res;
     }
   len = res;
@@ -547,7 +720,8 @@ fuse_send_data_iov_fallback(struct fuse_ll     *f,
   iov[iov_count].iov_len = len;
   iov_count++;
   res = fuse_send_msg(f, ch, iov, iov_count);
-  free(mbuf);
+  if (allocated)
+    free(mbuf);
 
   return res;
 }
@@ -2217,6 +2391,8 @@ do_init(fuse_req_t  req,
         f->conn.capable |= FUSE_CAP_READDIR_PLUS;
       if (arg->flags & FUSE_READDIRPLUS_AUTO)
         f->conn.capable |= FUSE_CAP_READDIR_PLUS_AUTO;
+      if ((arg->flags & FUSE_INIT_EXT) && (arg->flags2 & FUSE_PASSTHROUGH))
+        f->conn.capable |= FUSE_CAP_PASSTHROUGH;
     }
   else
     {
@@ -2304,6 +2480,18 @@ do_init(fuse_req_t  req,
     outarg.flags |= FUSE_DO_READDIRPLUS;
   if (f->conn.want & FUSE_CAP_READDIR_PLUS_AUTO)
     outarg.flags |= FUSE_READDIRPLUS_AUTO;
+  if (f->conn.want & FUSE_CAP_PASSTHROUGH)
+    {
+      /*
+        The kernel refuses passthrough alongside writeback caching.
+        Depth 1 allows branches on non-stacked filesystems while
+        still letting mergerfs itself be stacked upon (overlayfs).
+      */
+      outarg.flags          |= FUSE_INIT_EXT;
+      outarg.flags          &= ~FUSE_WRITEBACK_CACHE;
+      outarg.flags2         |= FUSE_PASSTHROUGH;
+      outarg.max_stack_depth = 1;
+    }
 
   outarg.max_readahead = f->conn.max_readahead;
   outarg.max_write = f->conn.max_write;
@@ -3054,6 +3242,9 @@ static const struct fuse_opt fuse_ll_opts[] =
     { "no_splice_move", offsetof(struct fuse_ll, no_splice_move), 1},
     { "splice_read", offsetof(struct fuse_ll, splice_read), 1},
     { "no_splice_read", offsetof(struct fuse_ll, no_splice_read), 1},
+    { "hugepages=off", offsetof(struct fuse_ll, hugepages), FUSE_HUGEPAGES_OFF},
+    { "hugepages=transparent", offsetof(struct fuse_ll, hugepages), FUSE_HUGEPAGES_TRANSPARENT},
+    { "hugepages=explicit", offsetof(struct fuse_ll, hugepages), FUSE_HUGEPAGES_EXPLICIT},
     FUSE_OPT_KEY("max_read=", FUSE_OPT_KEY_DISCARD),
     FUSE_OPT_KEY("-h", KEY_HELP),
     FUSE_OPT_KEY("--help", KEY_HELP),
@@ -3084,6 +3275,8 @@ fuse_ll_help(void)
           "    -o [no_]splice_write   use splice to write to the fuse device\n"
           "    -o [no_]splice_move    move data while splicing to the fuse device\n"
           "    -o [no_]splice_read    use splice to read from the fuse device\n"
+          "    -o hugepages=off|transparent|explicit\n"
+          "                           back message buffers with hugepages\n"
           );
 }
 
@@ -3125,6 +3318,8 @@ fuse_ll_destroy(void *data)
 {
   struct fuse_ll *f = (struct fuse_ll *) data;
   struct fuse_ll_pipe *llp;
+  struct fuse_req_cache *rc;
+  struct fuse_ll_replybuf *rb;
 
   if (f->got_init && !f->got_destroy)
     {
@@ -3136,6 +3331,14 @@ fuse_ll_destroy(void *data)
   if (llp != NULL)
     fuse_ll_pipe_free(llp);
   pthread_key_delete(f->pipe_key);
+  rc = pthread_getspecific(f->req_cache_key);
+  if (rc != NULL)
+    fuse_ll_req_cache_destructor(rc);
+  pthread_key_delete(f->req_cache_key);
+  rb = pthread_getspecific(f->replybuf_key);
+  if (rb != NULL)
+    fuse_ll_replybuf_destructor(rb);
+  pthread_key_delete(f->replybuf_key);
   pthread_mutex_destroy(&f->lock);
   free(f);
 }
@@ -3329,9 +3532,27 @@ fuse_lowlevel_new_common(struct fuse_args               *args,
       goto out_free;
     }
 
+  err = pthread_key_create(&f->req_cache_key, fuse_ll_req_cache_destructor);
+  if (err)
+    {
+      fprintf(stderr, "fuse: failed to create thread specific key: %s\n",
+              strerror(err));
+      goto out_pipe_key_destroy;
+    }
+
+  err = pthread_key_create(&f->replybuf_key, fuse_ll_replybuf_destructor);
+  if (err)
+    {
+      fprintf(stderr, "fuse: failed to create thread specific key: %s\n",
+              strerror(err));
+      goto out_req_cache_key_destroy;
+    }
+
   if (fuse_opt_parse(args, f, fuse_ll_opts, fuse_ll_opt_proc) == -1)
     goto out_key_destroy;
 
+  msgbuf_set_hugepages(f->hugepages);
+
   if (f->debug)
     fprintf(stderr, "FUSE library version: %s\n", PACKAGE_VERSION);
 
@@ -3349,6 +3570,10 @@ fuse_lowlevel_new_common(struct fuse_args               *args,
   return se;
 
  out_key_destroy:
+  pthread_key_delete(f->replybuf_key);
+ out_req_cache_key_destroy:
+  pthread_key_delete(f->req_cache_key);
+ out_pipe_key_destroy:
   pthread_key_delete(f->pipe_key);
  out_free:
   pthread_mutex_destroy(&f->lock);
@@ -0,0 +1,152 @@
+/*
+  FUSE: Filesystem in Userspace
+
+  This program can be distributed under the terms of the GNU LGPLv2.
+  See the file COPYING.LIB
+*/
+
+#define _GNU_SOURCE
+
+#include "config.h"
+#include "fuse_msgbuf.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+/*
+  Buffers used to receive requests from and send replies to the
+  kernel. With hugepages enabled they are mmap'ed, rounded up to the
+  hugepage size and pre-faulted so the first large read or write on
+  a thread doesn't pay for hundreds of page faults and each buffer
+  costs a single TLB entry.
+
+  The mode is set once while parsing options, before any buffers are
+  allocated.
+*/
+
+static int g_hugepages = FUSE_HUGEPAGES_OFF;
+
+void
+msgbuf_set_hugepages(int hugepages)
+{
+  g_hugepages = hugepages;
+}
+
+static
+size_t
+round_up(size_t size,
+         size_t align)
+{
+  return (((size + align - 1) / align) * align);
+}
+
+size_t
+msgbuf_alloc_size(size_t size)
+{
+  if(g_hugepages == FUSE_HUGEPAGES_OFF)
+    return size;
+
+  return round_up(size,HUGEPAGE_SIZE);
+}
+
+#ifdef HAVE_MAP_HUGETLB
+static
+void*
+alloc_explicit(size_t size)
+{
+  void *buf;
+
+  buf = mmap(NULL,size,
+             PROT_READ|PROT_WRITE,
+             MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB|MAP_POPULATE,
+             -1,0);
+  if(buf == MAP_FAILED)
+    return NULL;
+
+  return buf;
+}
+#else
+static
+void*
+alloc_explicit(size_t size)
+{
+  (void)size;
+
+  return NULL;
+}
+#endif
+
+/*
+  Transparent hugepages need a hugepage aligned region so map a bit
+  extra and trim the ends.
+*/
+static
+void*
+alloc_transparent(size_t size)
+{
+  char *buf;
+  char *aligned;
+  size_t head;
+  size_t tail;
+
+  buf = mmap(NULL,size + HUGEPAGE_SIZE,
+             PROT_READ|PROT_WRITE,
+             MAP_PRIVATE|MAP_ANONYMOUS,
+             -1,0);
+  if(buf == MAP_FAILED)
+    return NULL;
+
+  aligned = (char*)round_up((uintptr_t)buf,HUGEPAGE_SIZE);
+  head    = (aligned - buf);
+  tail    = (HUGEPAGE_SIZE - head);
+  if(head)
+    munmap(buf,head);
+  if(tail)
+    munmap(aligned + size,tail);
+
+#ifdef HAVE_MADV_HUGEPAGE
+  madvise(aligned,size,MADV_HUGEPAGE);
+#endif
+
+  memset(aligned,0,size);
+
+  return aligned;
+}
+
+void*
+msgbuf_alloc(size_t size)
+{
+  void *buf;
+
+  switch(g_hugepages)
+    {
+    case FUSE_HUGEPAGES_EXPLICIT:
+      size = msgbuf_alloc_size(size);
+      buf  = alloc_explicit(size);
+      if(buf != NULL)
+        return buf;
+      return alloc_transparent(size);
+    case FUSE_HUGEPAGES_TRANSPARENT:
+      return alloc_transparent(msgbuf_alloc_size(size));
+    default:
+      return calloc(size,1);
+    }
+}
+
+void
+msgbuf_free(void *buf,
+            size_t size)
+{
+  if(buf == NULL)
+    return;
+
+  if(g_hugepages == FUSE_HUGEPAGES_OFF)
+    free(buf);
+  else
+    munmap(buf,msgbuf_alloc_size(size));
+}
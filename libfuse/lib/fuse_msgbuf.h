@@ -0,0 +1,22 @@
+/*
+  FUSE: Filesystem in Userspace
+
+  This program can be distributed under the terms of the GNU LGPLv2.
+  See the file COPYING.LIB
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+enum fuse_hugepages
+  {
+    FUSE_HUGEPAGES_OFF,
+    FUSE_HUGEPAGES_TRANSPARENT,
+    FUSE_HUGEPAGES_EXPLICIT
+  };
+
+void   msgbuf_set_hugepages(int hugepages);
+size_t msgbuf_alloc_size(size_t size);
+void  *msgbuf_alloc(size_t size);
+void   msgbuf_free(void *buf, size_t size);
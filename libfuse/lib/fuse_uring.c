@@ -0,0 +1,617 @@
+/*
+  FUSE: Filesystem in Userspace
+
+  This program can be distributed under the terms of the GNU LGPLv2.
+  See the file COPYING.LIB
+*/
+
+#define _GNU_SOURCE
+
+#include "config.h"
+#include "fuse_uring.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+/*
+  Asynchronous read/write engine built on io_uring.
+
+  Worker threads hand a request's file I/O to the ring and go back to
+  reading /dev/fuse. A single completion thread reaps results and
+  sends the replies. Short transfers are resubmitted for the
+  remainder so, like FUSE_BUF_FD_RETRY, the kernel only ever sees a
+  short read at EOF.
+
+  Submissions are serialized by a mutex and submitted immediately so
+  the submission queue never holds more than one entry. The number
+  of operations in flight is capped at the ring depth which keeps
+  the completion queue from overflowing; callers block when the cap
+  is reached.
+*/
+
+#ifdef HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+enum uring_opcode
+  {
+    URING_READ,
+    URING_WRITE
+  };
+
+struct uring_op
+{
+  fuse_req_t    req;
+  int           opcode;
+  int           fd;
+  char         *buf;
+  size_t        size;
+  size_t        done;
+  off_t         off;
+  struct iovec  iov;
+};
+
+struct fuse_uring
+{
+  int                  fd;
+  unsigned             depth;
+  unsigned             inflight;
+  int                  stop;
+  pthread_t            thread;
+  pthread_mutex_t      lock;
+  pthread_cond_t       cond;
+
+  void                *sq_ptr;
+  size_t               sq_size;
+  void                *cq_ptr;
+  size_t               cq_size;
+  struct io_uring_sqe *sqes;
+  size_t               sqes_size;
+
+  unsigned            *sq_tail;
+  unsigned            *sq_mask;
+  unsigned            *sq_array;
+  unsigned            *cq_head;
+  unsigned            *cq_tail;
+  unsigned            *cq_mask;
+  struct io_uring_cqe *cqes;
+};
+
+static
+int
+sys_io_uring_setup(unsigned                entries,
+                   struct io_uring_params *p)
+{
+  return syscall(__NR_io_uring_setup,entries,p);
+}
+
+static
+int
+sys_io_uring_enter(int      fd,
+                   unsigned to_submit,
+                   unsigned min_complete,
+                   unsigned flags)
+{
+  return syscall(__NR_io_uring_enter,fd,to_submit,min_complete,flags,NULL,0);
+}
+
+static
+int
+uring_map(struct fuse_uring *ur,
+          unsigned           depth)
+{
+  struct io_uring_params p;
+
+  memset(&p,0,sizeof(p));
+
+  ur->fd = sys_io_uring_setup(depth,&p);
+  if(ur->fd == -1)
+    return -errno;
+
+  ur->depth   = p.sq_entries;
+  ur->sq_size = p.sq_off.array + (p.sq_entries * sizeof(unsigned));
+  ur->cq_size = p.cq_off.cqes + (p.cq_entries * sizeof(struct io_uring_cqe));
+  if(p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+      if(ur->cq_size > ur->sq_size)
+        ur->sq_size = ur->cq_size;
+      ur->cq_size = 0;
+    }
+
+  ur->sq_ptr = mmap(NULL,ur->sq_size,PROT_READ|PROT_WRITE,
+                    MAP_SHARED|MAP_POPULATE,ur->fd,IORING_OFF_SQ_RING);
+  if(ur->sq_ptr == MAP_FAILED)
+    return -errno;
+
+  ur->cq_ptr = ur->sq_ptr;
+  if(ur->cq_size)
+    {
+      ur->cq_ptr = mmap(NULL,ur->cq_size,PROT_READ|PROT_WRITE,
+                        MAP_SHARED|MAP_POPULATE,ur->fd,IORING_OFF_CQ_RING);
+      if(ur->cq_ptr == MAP_FAILED)
+        return -errno;
+    }
+
+  ur->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  ur->sqes = mmap(NULL,ur->sqes_size,PROT_READ|PROT_WRITE,
+                  MAP_SHARED|MAP_POPULATE,ur->fd,IORING_OFF_SQES);
+  if(ur->sqes == MAP_FAILED)
+    return -errno;
+
+  ur->sq_tail  = (unsigned*)((char*)ur->sq_ptr + p.sq_off.tail);
+  ur->sq_mask  = (unsigned*)((char*)ur->sq_ptr + p.sq_off.ring_mask);
+  ur->sq_array = (unsigned*)((char*)ur->sq_ptr + p.sq_off.array);
+  ur->cq_head  = (unsigned*)((char*)ur->cq_ptr + p.cq_off.head);
+  ur->cq_tail  = (unsigned*)((char*)ur->cq_ptr + p.cq_off.tail);
+  ur->cq_mask  = (unsigned*)((char*)ur->cq_ptr + p.cq_off.ring_mask);
+  ur->cqes     = (struct io_uring_cqe*)((char*)ur->cq_ptr + p.cq_off.cqes);
+
+  return 0;
+}
+
+static
+void
+uring_unmap(struct fuse_uring *ur)
+{
+  if(ur->sqes && (ur->sqes != MAP_FAILED))
+    munmap(ur->sqes,ur->sqes_size);
+  if(ur->cq_size && ur->cq_ptr && (ur->cq_ptr != MAP_FAILED))
+    munmap(ur->cq_ptr,ur->cq_size);
+  if(ur->sq_ptr && (ur->sq_ptr != MAP_FAILED))
+    munmap(ur->sq_ptr,ur->sq_size);
+  if(ur->fd >= 0)
+    close(ur->fd);
+}
+
+/* must be called with ur->lock held */
+static
+int
+uring_submit_locked(struct fuse_uring *ur,
+                    uint8_t            opcode,
+                    int                fd,
+                    struct iovec      *iov,
+                    off_t              off,
+                    uint64_t           user_data)
+{
+  int rv;
+  unsigned tail;
+  unsigned idx;
+  struct io_uring_sqe *sqe;
+
+  tail = *ur->sq_tail;
+  idx  = (tail & *ur->sq_mask);
+  sqe  = &ur->sqes[idx];
+
+  memset(sqe,0,sizeof(*sqe));
+  sqe->opcode    = opcode;
+  sqe->fd        = fd;
+  sqe->addr      = (uint64_t)(uintptr_t)iov;
+  sqe->len       = (iov ? 1 : 0);
+  sqe->off       = off;
+  sqe->user_data = user_data;
+
+  ur->sq_array[idx] = idx;
+  __atomic_store_n(ur->sq_tail,tail + 1,__ATOMIC_RELEASE);
+
+  do
+    {
+      rv = sys_io_uring_enter(ur->fd,1,0,0);
+    }
+  while((rv == -1) && ((errno == EINTR) || (errno == EAGAIN)));
+
+  if(rv == -1)
+    {
+      /* take the entry back so it isn't submitted later */
+      __atomic_store_n(ur->sq_tail,tail,__ATOMIC_RELEASE);
+      return -errno;
+    }
+
+  return 0;
+}
+
+static
+int
+uring_submit_op(struct fuse_uring *ur,
+                struct uring_op   *op)
+{
+  int rv;
+
+  op->iov.iov_base = op->buf + op->done;
+  op->iov.iov_len  = op->size - op->done;
+
+  pthread_mutex_lock(&ur->lock);
+  rv = uring_submit_locked(ur,
+                           ((op->opcode == URING_READ) ?
+                            IORING_OP_READV : IORING_OP_WRITEV),
+                           op->fd,
+                           &op->iov,
+                           op->off + op->done,
+                           (uint64_t)(uintptr_t)op);
+  pthread_mutex_unlock(&ur->lock);
+
+  return rv;
+}
+
+static
+void
+uring_op_finish(struct fuse_uring *ur,
+                struct uring_op   *op,
+                int                err)
+{
+  if(op->opcode == URING_READ)
+    {
+      if(err && !op->done)
+        fuse_reply_err(op->req,err);
+      else
+        fuse_reply_buf(op->req,op->buf,op->done);
+    }
+  else
+    {
+      if(err && !op->done)
+        fuse_reply_err(op->req,err);
+      else
+        fuse_reply_write(op->req,op->done);
+    }
+
+  free(op->buf);
+  free(op);
+
+  pthread_mutex_lock(&ur->lock);
+  ur->inflight--;
+  pthread_cond_signal(&ur->cond);
+  pthread_mutex_unlock(&ur->lock);
+}
+
+static
+void
+uring_complete(struct fuse_uring *ur,
+               struct uring_op   *op,
+               int                res)
+{
+  int rv;
+
+  if((res == -EINTR) || (res == -EAGAIN))
+    res = 0;
+  else if(res < 0)
+    goto finish;
+  else if(res == 0)
+    goto eof;
+
+  op->done += res;
+  if(op->done >= op->size)
+    goto finish;
+
+  rv = uring_submit_op(ur,op);
+  if(rv == 0)
+    return;
+  res = rv;
+  goto finish;
+
+ eof:
+  /* a zero length write would otherwise retry forever */
+  if(op->opcode == URING_WRITE)
+    res = -EIO;
+
+ finish:
+  uring_op_finish(ur,op,((res < 0) ? -res : 0));
+}
+
+static
+void*
+uring_thread(void *data)
+{
+  struct fuse_uring *ur = data;
+  unsigned head;
+  unsigned tail;
+  struct io_uring_cqe *cqe;
+  uint64_t user_data;
+  int res;
+
+  for(;;)
+    {
+      head = *ur->cq_head;
+      tail = __atomic_load_n(ur->cq_tail,__ATOMIC_ACQUIRE);
+      if(head == tail)
+        {
+          sys_io_uring_enter(ur->fd,0,1,IORING_ENTER_GETEVENTS);
+          continue;
+        }
+
+      while(head != tail)
+        {
+          cqe       = &ur->cqes[head & *ur->cq_mask];
+          user_data = cqe->user_data;
+          res       = cqe->res;
+          head++;
+          __atomic_store_n(ur->cq_head,head,__ATOMIC_RELEASE);
+
+          if(user_data == 0)
+            return NULL;
+
+          uring_complete(ur,(struct uring_op*)(uintptr_t)user_data,res);
+        }
+    }
+
+  return NULL;
+}
+
+struct fuse_uring*
+fuse_uring_new(unsigned depth)
+{
+  int rv;
+  sigset_t oldset;
+  sigset_t newset;
+  struct fuse_uring *ur;
+
+  ur = calloc(1,sizeof(struct fuse_uring));
+  if(ur == NULL)
+    return NULL;
+
+  ur->fd = -1;
+  pthread_mutex_init(&ur->lock,NULL);
+  pthread_cond_init(&ur->cond,NULL);
+
+  rv = uring_map(ur,depth);
+  if(rv < 0)
+    goto out_free;
+
+  sigfillset(&newset);
+  pthread_sigmask(SIG_BLOCK,&newset,&oldset);
+  rv = -pthread_create(&ur->thread,NULL,uring_thread,ur);
+  pthread_sigmask(SIG_SETMASK,&oldset,NULL);
+  if(rv < 0)
+    goto out_free;
+
+  return ur;
+
+ out_free:
+  fprintf(stderr,"fuse: failed to setup io_uring: %s\n",strerror(-rv));
+  uring_unmap(ur);
+  pthread_cond_destroy(&ur->cond);
+  pthread_mutex_destroy(&ur->lock);
+  free(ur);
+  errno = -rv;
+  return NULL;
+}
+
+void
+fuse_uring_destroy(struct fuse_uring *ur)
+{
+  if(ur == NULL)
+    return;
+
+  pthread_mutex_lock(&ur->lock);
+  ur->stop = 1;
+  while(ur->inflight)
+    pthread_cond_wait(&ur->cond,&ur->lock);
+  uring_submit_locked(ur,IORING_OP_NOP,-1,NULL,0,0);
+  pthread_mutex_unlock(&ur->lock);
+
+  pthread_join(ur->thread,NULL);
+
+  uring_unmap(ur);
+  pthread_cond_destroy(&ur->cond);
+  pthread_mutex_destroy(&ur->lock);
+  free(ur);
+}
+
+static
+int
+uring_queue(struct fuse_uring *ur,
+            struct uring_op   *op)
+{
+  int rv;
+
+  pthread_mutex_lock(&ur->lock);
+  while((ur->inflight >= ur->depth) && !ur->stop)
+    pthread_cond_wait(&ur->cond,&ur->lock);
+  if(ur->stop)
+    {
+      pthread_mutex_unlock(&ur->lock);
+      return -ESHUTDOWN;
+    }
+  ur->inflight++;
+  pthread_mutex_unlock(&ur->lock);
+
+  rv = uring_submit_op(ur,op);
+  if(rv < 0)
+    {
+      pthread_mutex_lock(&ur->lock);
+      ur->inflight--;
+      pthread_cond_signal(&ur->cond);
+      pthread_mutex_unlock(&ur->lock);
+    }
+
+  return rv;
+}
+
+static
+struct uring_op*
+uring_op_new(fuse_req_t req,
+             int        opcode,
+             int        fd,
+             size_t     size,
+             off_t      off)
+{
+  struct uring_op *op;
+
+  op = calloc(1,sizeof(struct uring_op));
+  if(op == NULL)
+    return NULL;
+
+  op->buf = malloc(size ? size : 1);
+  if(op->buf == NULL)
+    {
+      free(op);
+      return NULL;
+    }
+
+  op->req    = req;
+  op->opcode = opcode;
+  op->fd     = fd;
+  op->size   = size;
+  op->off    = off;
+
+  return op;
+}
+
+static
+void
+uring_op_free(struct uring_op *op)
+{
+  free(op->buf);
+  free(op);
+}
+
+/*
+  Used when a write can't be queued after its data was copied.
+*/
+static
+void
+uring_write_sync(struct uring_op *op)
+{
+  ssize_t rv;
+
+  rv = 0;
+  while(op->done < op->size)
+    {
+      rv = pwrite(op->fd,
+                  op->buf + op->done,
+                  op->size - op->done,
+                  op->off + op->done);
+      if((rv == -1) && (errno == EINTR))
+        continue;
+      if(rv <= 0)
+        break;
+      op->done += rv;
+    }
+
+  if(op->done)
+    fuse_reply_write(op->req,op->done);
+  else
+    fuse_reply_err(op->req,((rv == 0) ? EIO : errno));
+
+  uring_op_free(op);
+}
+
+int
+fuse_uring_read(struct fuse_uring        *ur,
+                fuse_req_t                req,
+                const struct fuse_bufvec *src)
+{
+  int rv;
+  struct uring_op *op;
+  const struct fuse_buf *buf;
+
+  if(src->count != 1)
+    return -EINVAL;
+
+  buf = &src->buf[0];
+  if((buf->flags & (FUSE_BUF_IS_FD|FUSE_BUF_FD_SEEK)) !=
+     (FUSE_BUF_IS_FD|FUSE_BUF_FD_SEEK))
+    return -EINVAL;
+
+  op = uring_op_new(req,URING_READ,buf->fd,buf->size,buf->pos);
+  if(op == NULL)
+    return -ENOMEM;
+
+  rv = uring_queue(ur,op);
+  if(rv < 0)
+    uring_op_free(op);
+
+  return rv;
+}
+
+int
+fuse_uring_write(struct fuse_uring        *ur,
+                 fuse_req_t                req,
+                 int                       fd,
+                 struct fuse_bufvec       *src,
+                 off_t                     off)
+{
+  int rv;
+  ssize_t res;
+  size_t size;
+  struct uring_op *op;
+  struct fuse_bufvec dst;
+
+  size = fuse_buf_size(src);
+  op   = uring_op_new(req,URING_WRITE,fd,size,off);
+  if(op == NULL)
+    return -ENOMEM;
+
+  /*
+    The request data lives in the worker's buffer (or pipe) which is
+    reused as soon as the worker returns so it must be copied.
+  */
+  dst = FUSE_BUFVEC_INIT(size);
+  dst.buf[0].mem = op->buf;
+  res = fuse_buf_copy(&dst,src,0);
+  if(res <= 0)
+    {
+      uring_op_free(op);
+      return ((res < 0) ? res : -EIO);
+    }
+
+  /*
+    Once anything has been copied out of a pipe the caller can't
+    retry the write itself so the request must be finished here.
+  */
+  op->size = res;
+  if(res == (ssize_t)size)
+    {
+      rv = uring_queue(ur,op);
+      if(rv == 0)
+        return 0;
+    }
+
+  uring_write_sync(op);
+
+  return 0;
+}
+
+#else
+
+struct fuse_uring*
+fuse_uring_new(unsigned depth)
+{
+  (void)depth;
+
+  errno = ENOSYS;
+
+  return NULL;
+}
+
+void
+fuse_uring_destroy(struct fuse_uring *ur)
+{
+  (void)ur;
+}
+
+int
+fuse_uring_read(struct fuse_uring        *ur,
+                fuse_req_t                req,
+                const struct fuse_bufvec *src)
+{
+  return -ENOSYS;
+}
+
+int
+fuse_uring_write(struct fuse_uring        *ur,
+                 fuse_req_t                req,
+                 int                       fd,
+                 struct fuse_bufvec       *src,
+                 off_t                     off)
+{
+  return -ENOSYS;
+}
+
+#endif
@@ -0,0 +1,26 @@
+/*
+  FUSE: Filesystem in Userspace
+
+  This program can be distributed under the terms of the GNU LGPLv2.
+  See the file COPYING.LIB
+*/
+
+#pragma once
+
+#include "fuse_lowlevel.h"
+
+#include <sys/types.h>
+
+struct fuse_uring;
+
+struct fuse_uring *fuse_uring_new(unsigned depth);
+void               fuse_uring_destroy(struct fuse_uring *ur);
+
+int fuse_uring_read(struct fuse_uring        *ur,
+                    fuse_req_t                req,
+                    const struct fuse_bufvec *src);
+int fuse_uring_write(struct fuse_uring        *ur,
+                     fuse_req_t                req,
+                     int                       fd,
+                     struct fuse_bufvec       *src,
+                     off_t                     off);
@@ -0,0 +1,578 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "balance.hpp"
+
+#include "config.hpp"
+#include "fs_closedir.hpp"
+#include "fs_opendir.hpp"
+#include "fs_path.hpp"
+#include "fs_readdir.hpp"
+#include "mover.hpp"
+#include "ugid.hpp"
+
+#include <atomic>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+using mover::BranchInfo;
+using mover::BranchInfoVec;
+using mover::Result;
+
+namespace l
+{
+  enum State
+    {
+      IDLE,
+      RUNNING,
+      PAUSED,
+      STOPPING
+    };
+
+  struct Limits
+  {
+    mover::Limits io;
+    uint64_t      range;
+  };
+
+  static pthread_mutex_t       g_lock    = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t        g_cond    = PTHREAD_COND_INITIALIZER;
+  static State                 g_state   = IDLE;
+  static bool                  g_ready   = false;
+  static bool                  g_running = false;
+
+  static std::atomic<uint64_t> g_moved(0);
+  static std::atomic<uint64_t> g_bytes(0);
+  static std::atomic<uint64_t> g_skipped(0);
+  static std::atomic<uint64_t> g_errors(0);
+  static std::atomic<uint64_t> g_spread(0);
+
+  static
+  State
+  state(void)
+  {
+    State s;
+
+    pthread_mutex_lock(&g_lock);
+    s = g_state;
+    pthread_mutex_unlock(&g_lock);
+
+    return s;
+  }
+
+  /*
+    Blocks while paused. Returns false once asked to stop.
+  */
+  static
+  bool
+  wait_running(void)
+  {
+    bool rv;
+
+    pthread_mutex_lock(&g_lock);
+    while(g_state == PAUSED)
+      pthread_cond_wait(&g_cond,&g_lock);
+    rv = (g_state == RUNNING);
+    pthread_mutex_unlock(&g_lock);
+
+    return rv;
+  }
+
+  static
+  void
+  snapshot(BranchInfoVec *branches_,
+           Limits        *limits_)
+  {
+    Config::Read cfg;
+
+    limits_->io.rate = cfg->balance_rate;
+    limits_->io.iops = cfg->balance_iops;
+    limits_->range   = cfg->balance_range;
+
+    mover::snapshot(cfg->branches,branches_);
+  }
+
+  static
+  BranchInfo*
+  emptiest(BranchInfoVec    &branches_,
+           const BranchInfo &src_)
+  {
+    uint64_t pct;
+    uint64_t min;
+    BranchInfo *dst;
+
+    dst = NULL;
+    min = UINT64_MAX;
+    for(size_t i = 0; i < branches_.size(); i++)
+      {
+        BranchInfo &bi = branches_[i];
+
+        if(!bi.dst || (&bi == &src_) || (bi.tier != src_.tier))
+          continue;
+
+        pct = mover::percent_used(bi);
+        if(pct < min)
+          {
+            min = pct;
+            dst = &bi;
+          }
+      }
+
+    return dst;
+  }
+
+  /*
+    Branches are only balanced against others of the same tier. Picks
+    the source, not yet found to have nothing left to move, with the
+    largest spread to the emptiest destination of its tier. Returns
+    false when every spread is within range.
+  */
+  static
+  bool
+  pick(BranchInfoVec          &branches_,
+       const std::set<string> &exhausted_,
+       const uint64_t          range_,
+       BranchInfo            **src_,
+       BranchInfo            **dst_)
+  {
+    uint64_t max;
+    uint64_t spread;
+    uint64_t src_pct;
+    uint64_t dst_pct;
+    BranchInfo *dst;
+
+    for(size_t i = 0; i < branches_.size(); i++)
+      {
+        BranchInfo &bi = branches_[i];
+
+        if(!bi.src && !bi.dst)
+          continue;
+        if(mover::update(&bi) == -1)
+          bi.src = bi.dst = false;
+      }
+
+    *src_ = *dst_ = NULL;
+    max = spread = 0;
+    for(size_t i = 0; i < branches_.size(); i++)
+      {
+        BranchInfo &bi = branches_[i];
+
+        if(!bi.src)
+          continue;
+        dst = l::emptiest(branches_,bi);
+        if(dst == NULL)
+          continue;
+
+        src_pct = mover::percent_used(bi);
+        dst_pct = mover::percent_used(*dst);
+        if(src_pct <= dst_pct)
+          continue;
+        if((src_pct - dst_pct) > max)
+          max = (src_pct - dst_pct);
+        if(exhausted_.count(bi.path))
+          continue;
+        if((src_pct - dst_pct) < spread)
+          continue;
+
+        spread = (src_pct - dst_pct);
+        *src_  = &bi;
+        *dst_  = dst;
+      }
+
+    g_spread = max;
+
+    if(*src_ == NULL)
+      return false;
+
+    return (spread > (range_ * 100));
+  }
+
+  /*
+    Moving the file must not leave the destination fuller than the
+    source and the destination must keep its minfreespace.
+  */
+  static
+  bool
+  worth_moving(const BranchInfo &src_,
+               const BranchInfo &dst_,
+               const uint64_t    size_)
+  {
+    if(dst_.avail < (size_ + dst_.minfreespace))
+      return false;
+    if(src_.used < size_)
+      return false;
+
+    return (mover::percent_used(dst_.used + size_,dst_.avail - size_) <
+            mover::percent_used(src_.used - size_,src_.avail + size_));
+  }
+
+  class BalanceJob : public mover::Job
+  {
+  public:
+    BalanceJob(const BranchInfo &src_,
+               const BranchInfo &dst_)
+      : _src(src_),
+        _dst(dst_)
+    {
+    }
+
+  public:
+    bool
+    accept(const struct stat &st_)
+    {
+      return l::worth_moving(_src,_dst,st_.st_size);
+    }
+
+    bool
+    proceed(void)
+    {
+      return (l::state() == RUNNING);
+    }
+
+    void
+    copied(const uint64_t bytes_)
+    {
+      g_bytes += bytes_;
+    }
+
+  private:
+    const BranchInfo &_src;
+    const BranchInfo &_dst;
+  };
+
+  static
+  Result
+  move(BranchInfo      *src_,
+       BranchInfo      *dst_,
+       const string    &relpath_,
+       char            *buf_,
+       mover::Throttle *throttle_,
+       const Limits    &limits_)
+  {
+    Result res;
+    struct stat st;
+    l::BalanceJob job(*src_,*dst_);
+
+    res = mover::move(src_->path,
+                      dst_->path,
+                      relpath_,
+                      buf_,
+                      throttle_,
+                      limits_.io,
+                      &job,
+                      &st);
+    if(res != Result::MOVED)
+      return res;
+
+    g_moved++;
+    src_->used  -= st.st_size;
+    src_->avail += st.st_size;
+    dst_->used  += st.st_size;
+    dst_->avail -= st.st_size;
+
+    return res;
+  }
+
+  /*
+    Depth first walk of the source branch. Returns false when the
+    walk should end: interrupted or the source is no longer the one
+    to drain.
+  */
+  static
+  bool
+  walk(BranchInfo      *src_,
+       BranchInfo      *dst_,
+       const string    &reldir_,
+       char            *buf_,
+       mover::Throttle *throttle_,
+       const Limits    &limits_,
+       uint64_t        *moved_)
+  {
+    DIR *dh;
+    Result res;
+    string relpath;
+    struct dirent *de;
+    vector<string> dirs;
+
+    dh = fs::opendir(fs::path::make(src_->path,reldir_));
+    if(dh == NULL)
+      return true;
+
+    for(de = fs::readdir(dh); de != NULL; de = fs::readdir(dh))
+      {
+        if((strcmp(de->d_name,".") == 0) || (strcmp(de->d_name,"..") == 0))
+          continue;
+
+        relpath = reldir_ + "/" + de->d_name;
+        if(de->d_type == DT_DIR)
+          {
+            dirs.push_back(relpath);
+            continue;
+          }
+        if((de->d_type != DT_REG) && (de->d_type != DT_UNKNOWN))
+          continue;
+
+        res = l::move(src_,dst_,relpath,buf_,throttle_,limits_);
+        switch(res)
+          {
+          case Result::MOVED:
+            (*moved_)++;
+            break;
+          case Result::SKIPPED:
+            g_skipped++;
+            break;
+          case Result::FAILED:
+            g_errors++;
+            break;
+          case Result::INTERRUPTED:
+            break;
+          }
+
+        if(l::state() != RUNNING)
+          break;
+        if((res == Result::MOVED) &&
+           ((mover::percent_used(*src_) <= mover::percent_used(*dst_)) ||
+            ((mover::percent_used(*src_) - mover::percent_used(*dst_)) <= (limits_.range * 100))))
+          break;
+      }
+
+    fs::closedir(dh);
+
+    if(de != NULL)
+      return false;
+
+    for(size_t i = 0; i < dirs.size(); i++)
+      {
+        if(!l::walk(src_,dst_,dirs[i],buf_,throttle_,limits_,moved_))
+          return false;
+      }
+
+    return true;
+  }
+
+  /*
+    Each pass drains the current fullest branch into the emptiest
+    until they're within range or it has nothing more worth moving,
+    then everything is measured again.
+  */
+  static
+  void*
+  worker(void *arg_)
+  {
+    bool more;
+    void *buf;
+    uint64_t moved;
+    Limits limits;
+    mover::Throttle throttle;
+    BranchInfo *src;
+    BranchInfo *dst;
+    BranchInfoVec branches;
+    std::set<string> exhausted;
+
+    if(posix_memalign(&buf,mover::BUF_ALIGN,mover::BUF_SIZE) != 0)
+      buf = NULL;
+
+    for(;;)
+      {
+        more = true;
+        exhausted.clear();
+        while((buf != NULL) && l::wait_running())
+          {
+            l::snapshot(&branches,&limits);
+
+            more = l::pick(branches,exhausted,limits.range,&src,&dst);
+            if(!more)
+              break;
+
+            moved = 0;
+            throttle.reset();
+            if(l::walk(src,dst,string(),(char*)buf,&throttle,limits,&moved) &&
+               (moved == 0))
+              exhausted.insert(src->path);
+          }
+
+        pthread_mutex_lock(&g_lock);
+        // restarted after being asked to stop
+        if(more && (buf != NULL) && (g_state == RUNNING))
+          {
+            pthread_mutex_unlock(&g_lock);
+            continue;
+          }
+
+        g_state   = IDLE;
+        g_running = false;
+        pthread_cond_broadcast(&g_cond);
+        pthread_mutex_unlock(&g_lock);
+        break;
+      }
+
+    free(buf);
+
+    return NULL;
+  }
+
+  // called with g_lock held
+  static
+  void
+  spawn(void)
+  {
+    int rv;
+    pthread_t thread;
+    pthread_attr_t attr;
+    const ugid::Set ugid(0,0);
+
+    if(!g_ready || g_running)
+      return;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+    rv = pthread_create(&thread,&attr,l::worker,NULL);
+    pthread_attr_destroy(&attr);
+    if(rv != 0)
+      {
+        g_state = IDLE;
+        return;
+      }
+
+    g_running = true;
+  }
+}
+
+namespace balance
+{
+  /*
+    Requests made while parsing options are held until the
+    filesystem is up so no thread is lost to daemonizing.
+  */
+  void
+  init(void)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    l::g_ready = true;
+    if(l::g_state == l::RUNNING)
+      l::spawn();
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  void
+  start(void)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    switch(l::g_state)
+      {
+      case l::IDLE:
+        l::g_state = l::RUNNING;
+        l::spawn();
+        break;
+      case l::PAUSED:
+      case l::STOPPING:
+        l::g_state = l::RUNNING;
+        pthread_cond_broadcast(&l::g_cond);
+        break;
+      case l::RUNNING:
+        break;
+      }
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  void
+  pause(void)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    if(l::g_state == l::RUNNING)
+      l::g_state = l::PAUSED;
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  void
+  resume(void)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    if(l::g_state == l::PAUSED)
+      {
+        l::g_state = l::RUNNING;
+        pthread_cond_broadcast(&l::g_cond);
+      }
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  void
+  stop(void)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    if(l::g_state != l::IDLE)
+      {
+        l::g_state = (l::g_running ? l::STOPPING : l::IDLE);
+        pthread_cond_broadcast(&l::g_cond);
+      }
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  /*
+    Stops and waits for the current file to be abandoned so no
+    temporary file is left behind.
+  */
+  void
+  shutdown(void)
+  {
+    balance::stop();
+
+    pthread_mutex_lock(&l::g_lock);
+    while(l::g_running)
+      pthread_cond_wait(&l::g_cond,&l::g_lock);
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  const char*
+  state(void)
+  {
+    switch(l::state())
+      {
+      case l::RUNNING:
+        return "running";
+      case l::PAUSED:
+        return "paused";
+      case l::STOPPING:
+        return "stopping";
+      case l::IDLE:
+      default:
+        return "idle";
+      }
+  }
+
+  void
+  stats(Stats *stats_)
+  {
+    stats_->state   = balance::state();
+    stats_->moved   = l::g_moved;
+    stats_->bytes   = l::g_bytes;
+    stats_->skipped = l::g_skipped;
+    stats_->errors  = l::g_errors;
+    stats_->spread  = l::g_spread;
+  }
+}
@@ -0,0 +1,56 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+  Background branch balancer.
+
+  A single thread repeatedly picks the most and least used (by
+  percentage) writable branches and moves files from the former to
+  the latter until the difference is within the configured range.
+  Files open by anyone are skipped and a copy is abandoned if the
+  file is opened before it completes. Copies are paced by
+  balance.rate (bytes per second) and balance.iops.
+*/
+namespace balance
+{
+  struct Stats
+  {
+    const char *state;
+    uint64_t    moved;
+    uint64_t    bytes;
+    uint64_t    skipped;
+    uint64_t    errors;
+    uint64_t    spread;  // hundredths of a percent
+  };
+
+  void init(void);
+
+  void start(void);
+  void pause(void);
+  void resume(void);
+  void stop(void);
+  void shutdown(void);
+
+  const char *state(void);
+  void stats(Stats *stats);
+}
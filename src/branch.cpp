@@ -25,10 +25,13 @@
 #include "num.hpp"
 #include "str.hpp"
 
+#include "fuse_lockstat.h"
+
 #include <string>
 
 #include <errno.h>
 #include <fnmatch.h>
+#include <stdint.h>
 
 using std::string;
 using std::vector;
@@ -36,7 +39,8 @@ using nonstd::optional;
 
 
 Branch::Branch(const uint64_t &default_minfreespace_)
-  : _default_minfreespace(&default_minfreespace_)
+  : tier(0),
+    _default_minfreespace(&default_minfreespace_)
 {
 }
 
@@ -73,6 +77,12 @@ Branch::to_string(void) const
       rv += num::humanize(_minfreespace.value());
     }
 
+  if(tier > 0)
+    {
+      rv += ",tier";
+      rv += std::to_string(tier);
+    }
+
   return rv;
 }
 
@@ -127,9 +137,28 @@ namespace l
 }
 
 Branches::Branches(const uint64_t &default_minfreespace_)
-  : default_minfreespace(default_minfreespace_)
+  : _vec(new BranchVec()),
+    _fast(new Branches(default_minfreespace_,true)),
+    default_minfreespace(default_minfreespace_)
 {
-  pthread_rwlock_init(&lock,NULL);
+  pthread_mutex_init(&_write_lock,NULL);
+}
+
+Branches::Branches(const uint64_t &default_minfreespace_,
+                   const bool      fast_)
+  : _vec(new BranchVec()),
+    _fast(this),
+    default_minfreespace(default_minfreespace_)
+{
+  pthread_mutex_init(&_write_lock,NULL);
+}
+
+Branches::~Branches()
+{
+  if(_fast != this)
+    delete _fast;
+  delete _vec.load();
+  pthread_mutex_destroy(&_write_lock);
 }
 
 namespace l
@@ -168,12 +197,34 @@ namespace l
     return 0;
   }
 
+  static
+  int
+  parse_tier(const string &str_,
+             uint64_t     *tier_)
+  {
+    int rv;
+    uint64_t uint64;
+
+    rv = str::from(str_.substr(4),&uint64);
+    if(rv < 0)
+      return rv;
+
+    *tier_ = uint64;
+
+    return 0;
+  }
+
+  /*
+    After the mode come, in any order, the minfreespace and the tier
+    as "tierN".
+  */
   static
   int
   parse_branch(const string       &str_,
                string             *glob_,
                Branch::Mode       *mode_,
-               optional<uint64_t> *minfreespace_)
+               optional<uint64_t> *minfreespace_,
+               uint64_t           *tier_)
   {
     int rv;
     string options;
@@ -191,19 +242,21 @@ namespace l
         options = v[1];
         v.clear();
         str::split(options,',',&v);
-        switch(v.size())
+        if(v.empty() || (v.size() > 3))
+          return -EINVAL;
+
+        rv = l::parse_mode(v[0],mode_);
+        if(rv < 0)
+          return rv;
+
+        for(size_t i = 1; i < v.size(); i++)
           {
-          case 2:
-            rv = l::parse_minfreespace(v[1],minfreespace_);
-            if(rv < 0)
-              return rv;
-          case 1:
-            rv = l::parse_mode(v[0],mode_);
+            if(str::startswith(v[i],"tier"))
+              rv = l::parse_tier(v[i],tier_);
+            else
+              rv = l::parse_minfreespace(v[i],minfreespace_);
             if(rv < 0)
               return rv;
-            break;
-          case 0:
-            return -EINVAL;
           }
         break;
       default:
@@ -225,7 +278,7 @@ namespace l
     optional<uint64_t> minfreespace;
     Branch branch(default_minfreespace_);
 
-    rv = l::parse_branch(str_,&glob,&branch.mode,&minfreespace);
+    rv = l::parse_branch(str_,&glob,&branch.mode,&minfreespace,&branch.tier);
     if(rv < 0)
       return rv;
 
@@ -246,7 +299,8 @@ namespace l
   static
   int
   set(const std::string &str_,
-      Branches          *branches_)
+      const uint64_t    &default_minfreespace_,
+      BranchVec         *branches_)
   {
     int rv;
     vector<string> paths;
@@ -256,15 +310,12 @@ namespace l
 
     for(size_t i = 0; i < paths.size(); i++)
       {
-        rv = l::parse(paths[i],branches_->default_minfreespace,&tmp_branchvec);
+        rv = l::parse(paths[i],default_minfreespace_,&tmp_branchvec);
         if(rv < 0)
           return rv;
       }
 
-    branches_->vec.clear();
-    branches_->vec.insert(branches_->vec.end(),
-                          tmp_branchvec.begin(),
-                          tmp_branchvec.end());
+    branches_->swap(tmp_branchvec);
 
     return 0;
   }
@@ -272,7 +323,8 @@ namespace l
   static
   int
   add_begin(const std::string &str_,
-            Branches          *branches_)
+            const uint64_t    &default_minfreespace_,
+            BranchVec         *branches_)
   {
     int rv;
     vector<string> paths;
@@ -282,14 +334,14 @@ namespace l
 
     for(size_t i = 0; i < paths.size(); i++)
       {
-        rv = l::parse(paths[i],branches_->default_minfreespace,&tmp_branchvec);
+        rv = l::parse(paths[i],default_minfreespace_,&tmp_branchvec);
         if(rv < 0)
           return rv;
       }
 
-    branches_->vec.insert(branches_->vec.begin(),
-                          tmp_branchvec.begin(),
-                          tmp_branchvec.end());
+    branches_->insert(branches_->begin(),
+                      tmp_branchvec.begin(),
+                      tmp_branchvec.end());
 
     return 0;
   }
@@ -297,7 +349,8 @@ namespace l
   static
   int
   add_end(const std::string &str_,
-          Branches          *branches_)
+          const uint64_t    &default_minfreespace_,
+          BranchVec         *branches_)
   {
     int rv;
     vector<string> paths;
@@ -307,14 +360,14 @@ namespace l
 
     for(size_t i = 0; i < paths.size(); i++)
       {
-        rv = l::parse(paths[i],branches_->default_minfreespace,&tmp_branchvec);
+        rv = l::parse(paths[i],default_minfreespace_,&tmp_branchvec);
         if(rv < 0)
           return rv;
       }
 
-    branches_->vec.insert(branches_->vec.end(),
-                          tmp_branchvec.begin(),
-                          tmp_branchvec.end());
+    branches_->insert(branches_->end(),
+                      tmp_branchvec.begin(),
+                      tmp_branchvec.end());
 
     return 0;
   }
@@ -323,6 +376,9 @@ namespace l
   int
   erase_begin(BranchVec *branches_)
   {
+    if(branches_->empty())
+      return 0;
+
     branches_->erase(branches_->begin());
 
     return 0;
@@ -332,6 +388,9 @@ namespace l
   int
   erase_end(BranchVec *branches_)
   {
+    if(branches_->empty())
+      return 0;
+
     branches_->pop_back();
 
     return 0;
@@ -340,14 +399,14 @@ namespace l
   static
   int
   erase_fnmatch(const std::string &str_,
-                Branches          *branches_)
+                BranchVec         *branches_)
   {
     vector<string> patterns;
 
     str::split(str_,':',&patterns);
 
-    for(BranchVec::iterator i = branches_->vec.begin();
-        i != branches_->vec.end();)
+    for(BranchVec::iterator i = branches_->begin();
+        i != branches_->end();)
       {
         int match = FNM_NOMATCH;
 
@@ -358,72 +417,145 @@ namespace l
             match = ::fnmatch(pi->c_str(),i->path.c_str(),0);
           }
 
-        i = ((match == 0) ? branches_->vec.erase(i) : (i+1));
+        i = ((match == 0) ? branches_->erase(i) : (i+1));
       }
 
     return 0;
   }
+
+  static
+  int
+  modify(const std::string &s_,
+         const uint64_t    &default_minfreespace_,
+         BranchVec         *branches_)
+  {
+    std::string instr;
+    std::string values;
+
+    l::split(s_,&instr,&values);
+
+    if(instr == "+")
+      return l::add_end(values,default_minfreespace_,branches_);
+    if(instr == "+<")
+      return l::add_begin(values,default_minfreespace_,branches_);
+    if(instr == "+>")
+      return l::add_end(values,default_minfreespace_,branches_);
+    if(instr == "-")
+      return l::erase_fnmatch(values,branches_);
+    if(instr == "-<")
+      return l::erase_begin(branches_);
+    if(instr == "->")
+      return l::erase_end(branches_);
+    if(instr == "=")
+      return l::set(values,default_minfreespace_,branches_);
+    if(instr.empty())
+      return l::set(values,default_minfreespace_,branches_);
+
+    return -EINVAL;
+  }
+
+  static
+  void
+  lowest_tier(const BranchVec &branches_,
+              BranchVec       *fast_)
+  {
+    uint64_t tier;
+
+    tier = UINT64_MAX;
+    for(size_t i = 0; i < branches_.size(); i++)
+      {
+        if(branches_[i].tier < tier)
+          tier = branches_[i].tier;
+      }
+
+    for(size_t i = 0; i < branches_.size(); i++)
+      {
+        if(branches_[i].tier == tier)
+          fast_->push_back(branches_[i]);
+      }
+  }
+}
+
+namespace l
+{
+  // writers only, readers are lock free
+  static fuse_lockstat_t g_lockstat = FUSE_LOCKSTAT_INIT("branches");
 }
 
 int
 Branches::from_string(const std::string &s_)
 {
-  rwlock::WriteGuard guard(lock);
-
-  std::string instr;
-  std::string values;
-
-  l::split(s_,&instr,&values);
-
-  if(instr == "+")
-    return l::add_end(values,this);
-  if(instr == "+<")
-    return l::add_begin(values,this);
-  if(instr == "+>")
-    return l::add_end(values,this);
-  if(instr == "-")
-    return l::erase_fnmatch(values,this);
-  if(instr == "-<")
-    return l::erase_begin(&vec);
-  if(instr == "->")
-    return l::erase_end(&vec);
-  if(instr == "=")
-    return l::set(values,this);
-  if(instr.empty())
-    return l::set(values,this);
+  int rv;
+  BranchVec *oldvec;
+  BranchVec *newvec;
+  BranchVec *oldfast;
+  BranchVec *newfast;
 
-  return -EINVAL;
+  fuse_lockstat_mutex_lock(&_write_lock,&l::g_lockstat);
+
+  oldvec = _vec.load(std::memory_order_relaxed);
+  newvec = new BranchVec(*oldvec);
+
+  rv = l::modify(s_,default_minfreespace,newvec);
+  if(rv < 0)
+    {
+      pthread_mutex_unlock(&_write_lock);
+      delete newvec;
+      return rv;
+    }
+
+  newfast = new BranchVec();
+  l::lowest_tier(*newvec,newfast);
+  oldfast = _fast->_vec.load(std::memory_order_relaxed);
+
+  _vec.store(newvec,std::memory_order_release);
+  _fast->_vec.store(newfast,std::memory_order_release);
+
+  pthread_mutex_unlock(&_write_lock);
+
+  epoch::retire(oldvec);
+  epoch::retire(oldfast);
+
+  return 0;
 }
 
 string
 Branches::to_string(void) const
 {
-  rwlock::ReadGuard guard(lock);
+  const Branches::Snapshot branches(*this);
 
   string tmp;
 
-  for(size_t i = 0; i < vec.size(); i++)
+  for(size_t i = 0; i < branches.vec.size(); i++)
     {
-      const Branch &branch = vec[i];
+      const Branch &branch = branches.vec[i];
 
       tmp += branch.to_string();
       tmp += ':';
     }
 
-  if(*tmp.rbegin() == ':')
+  if(!tmp.empty() && (*tmp.rbegin() == ':'))
     tmp.erase(tmp.size() - 1);
 
   return tmp;
 }
 
+bool
+Branches::empty(void) const
+{
+  const Branches::Snapshot branches(*this);
+
+  return branches.vec.empty();
+}
+
 void
 Branches::to_paths(vector<string> &vec_) const
 {
-  rwlock::ReadGuard guard(lock);
+  const Branches::Snapshot branches(*this);
 
-  for(size_t i = 0; i < vec.size(); i++)
+  for(size_t i = 0; i < branches.vec.size(); i++)
     {
-      const Branch &branch = vec[i];
+      const Branch &branch = branches.vec[i];
 
       vec_.push_back(branch.path);
     }
@@ -444,17 +576,17 @@ SrcMounts::from_string(const std::string &s_)
 std::string
 SrcMounts::to_string(void) const
 {
-  rwlock::ReadGuard guard(_branches.lock);
+  const Branches::Snapshot branches(_branches);
 
   std::string rv;
 
-  for(uint64_t i = 0; i < _branches.vec.size(); i++)
+  for(uint64_t i = 0; i < branches.vec.size(); i++)
     {
-      rv += _branches.vec[i].path;
+      rv += branches.vec[i].path;
       rv += ':';
     }
 
-  if(*rv.rbegin() == ':')
+  if(!rv.empty() && (*rv.rbegin() == ':'))
     rv.erase(rv.size() - 1);
 
   return rv;
@@ -18,10 +18,11 @@
 
 #pragma once
 
-#include "rwlock.hpp"
+#include "epoch.hpp"
 #include "tofrom_string.hpp"
 #include "nonstd/optional.hpp"
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -49,6 +50,7 @@ public:
 public:
   Mode        mode;
   std::string path;
+  uint64_t    tier;
   uint64_t    minfreespace() const;
 
 public:
@@ -66,21 +68,58 @@ private:
 
 typedef std::vector<Branch> BranchVec;
 
-class Branches : public ToFromString
+/*
+  The branch list is an immutable vector published through an atomic
+  pointer. Readers take a Snapshot which pins it for the duration of
+  the guard without writing to any shared memory. Changes are made to
+  a copy which is then swapped in. The old vector is freed once every
+  reader which could have seen it has left.
+*/
+class Branches final : public ToFromString
 {
+public:
+  class Snapshot
+  {
+  public:
+    Snapshot(const Branches &branches_)
+      : vec(*branches_._vec.load(std::memory_order_acquire))
+    {
+    }
+
+  private:
+    // must be declared (and therefore constructed) before vec
+    epoch::ReadGuard _guard;
+
+  public:
+    const BranchVec &vec;
+  };
+
 public:
   Branches(const uint64_t &default_minfreespace_);
+  ~Branches();
 
 public:
   int from_string(const std::string &str);
   std::string to_string(void) const;
 
 public:
+  bool empty(void) const;
   void to_paths(std::vector<std::string> &vec) const;
 
 public:
-  mutable pthread_rwlock_t lock;
-  BranchVec vec;
+  // the branches of the lowest tier, published along with the rest
+  const Branches& fast(void) const { return *_fast; }
+
+private:
+  Branches(const uint64_t &default_minfreespace_,
+           const bool      fast_);
+
+private:
+  std::atomic<BranchVec*> _vec;
+  pthread_mutex_t         _write_lock;
+  Branches               *_fast;
+
+public:
   const uint64_t &default_minfreespace;
 };
 
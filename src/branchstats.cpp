@@ -0,0 +1,315 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "branchstats.hpp"
+
+#include "fs_findonfs.hpp"
+#include "optrace.hpp"
+#include "slowlog.hpp"
+#include "thread_slots.hpp"
+#include "ugid.hpp"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+
+#define CACHELINE_SIZE 64
+
+using std::string;
+using std::vector;
+
+namespace l
+{
+  /*
+    Indexes are never reused so counts stay with their path even if
+    the branch is removed and added back.
+  */
+  const int MAX_BRANCHES = 256;
+
+  typedef std::atomic<uint64_t> Counter;
+
+  struct BranchCounters
+  {
+    Counter ops;
+    Counter errors;
+    Counter nsecs;
+    Counter read;
+    Counter written;
+  };
+
+  struct BranchSlot
+  {
+    BranchCounters  branches[MAX_BRANCHES];
+    bool            used;
+    BranchSlot     *next;
+  } __attribute__((aligned(CACHELINE_SIZE)));
+
+  typedef ThreadSlots<BranchSlot> Slots;
+
+  static string           g_paths[MAX_BRANCHES];
+  static std::atomic<int> g_count(0);
+
+  static pthread_mutex_t  g_lock  = PTHREAD_MUTEX_INITIALIZER;
+
+  static pthread_cond_t   g_cond    = PTHREAD_COND_INITIALIZER;
+  static uint64_t         g_log     = 0;
+  static bool             g_logging = false;
+
+  static
+  inline
+  void
+  add(Counter        &c_,
+      const uint64_t  v_)
+  {
+    c_.store(c_.load(std::memory_order_relaxed) + v_,
+             std::memory_order_relaxed);
+  }
+
+  static
+  void
+  logger_sleep(const uint64_t secs_)
+  {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME,&ts);
+    ts.tv_sec += secs_;
+    pthread_cond_timedwait(&g_cond,&g_lock,&ts);
+  }
+
+  /*
+    Logs what each branch did over the interval.
+  */
+  static
+  void*
+  logger(void *arg_)
+  {
+    uint64_t ops;
+    vector<branchstats::Totals> prev;
+    vector<branchstats::Totals> curr;
+
+    branchstats::totals(&prev);
+
+    pthread_mutex_lock(&g_lock);
+    while(g_log > 0)
+      {
+        l::logger_sleep(g_log);
+        if(g_log == 0)
+          break;
+        pthread_mutex_unlock(&g_lock);
+
+        branchstats::totals(&curr);
+        for(size_t i = 0; i < curr.size(); i++)
+          {
+            const branchstats::Totals &c = curr[i];
+            const branchstats::Totals  p = ((i < prev.size()) ?
+                                            prev[i] :
+                                            branchstats::Totals());
+
+            ops = (c.ops - p.ops);
+            syslog(LOG_INFO,
+                   "branch %s: ops=%llu errors=%llu read=%llu written=%llu avg_usecs=%llu",
+                   c.path.c_str(),
+                   (unsigned long long)ops,
+                   (unsigned long long)(c.errors - p.errors),
+                   (unsigned long long)(c.read - p.read),
+                   (unsigned long long)(c.written - p.written),
+                   (unsigned long long)(ops ? ((c.nsecs - p.nsecs) / ops / 1000) : 0));
+          }
+        prev.swap(curr);
+
+        pthread_mutex_lock(&g_lock);
+      }
+
+    g_logging = false;
+    pthread_mutex_unlock(&g_lock);
+
+    return NULL;
+  }
+}
+
+namespace branchstats
+{
+  int
+  index(const string &basepath_)
+  {
+    int i;
+    int count;
+
+    count = l::g_count.load(std::memory_order_acquire);
+    for(i = 0; i < count; i++)
+      {
+        if(l::g_paths[i] == basepath_)
+          return i;
+      }
+
+    pthread_mutex_lock(&l::g_lock);
+    count = l::g_count.load(std::memory_order_relaxed);
+    for(; i < count; i++)
+      {
+        if(l::g_paths[i] == basepath_)
+          break;
+      }
+    if((i == count) && (count < l::MAX_BRANCHES))
+      {
+        l::g_paths[i] = basepath_;
+        l::g_count.store(count + 1,std::memory_order_release);
+      }
+    pthread_mutex_unlock(&l::g_lock);
+
+    return ((i < l::MAX_BRANCHES) ? i : -1);
+  }
+
+  const string&
+  path(const int branch_)
+  {
+    return l::g_paths[branch_];
+  }
+
+  /*
+    For when a file has been moved out from under its handle.
+  */
+  int
+  find(const Branches &branches_,
+       const string   &fusepath_,
+       const int       fd_)
+  {
+    int rv;
+    string basepath;
+
+    rv = fs::findonfs(branches_,fusepath_,fd_,&basepath);
+    if(rv == -1)
+      return -1;
+
+    return branchstats::index(basepath);
+  }
+
+  void
+  record(const int      branch_,
+         const Kind     kind_,
+         const uint64_t bytes_,
+         const uint64_t nsecs_,
+         const bool     error_)
+  {
+    l::BranchCounters *c;
+
+    if(branch_ < 0)
+      return;
+
+    optrace::branch(branch_);
+    slowlog::branch(branch_,nsecs_);
+
+    c = &l::Slots::get()->branches[branch_];
+
+    l::add(c->ops,1);
+    l::add(c->nsecs,nsecs_);
+    if(error_)
+      l::add(c->errors,1);
+    if(kind_ == READ)
+      l::add(c->read,bytes_);
+    else if(kind_ == WRITE)
+      l::add(c->written,bytes_);
+  }
+
+  /*
+    For I/O completed elsewhere, by libfuse or io_uring, so not
+    timed.
+  */
+  void
+  bytes(const int      branch_,
+        const Kind     kind_,
+        const uint64_t bytes_)
+  {
+    l::BranchCounters *c;
+
+    if(branch_ < 0)
+      return;
+
+    optrace::branch(branch_);
+
+    c = &l::Slots::get()->branches[branch_];
+
+    if(kind_ == READ)
+      l::add(c->read,bytes_);
+    else if(kind_ == WRITE)
+      l::add(c->written,bytes_);
+  }
+
+  void
+  totals(vector<Totals> *totals_)
+  {
+    int count;
+
+    count = l::g_count.load(std::memory_order_acquire);
+
+    totals_->clear();
+    totals_->resize(count);
+
+    for(int i = 0; i < count; i++)
+      {
+        Totals &t = (*totals_)[i];
+
+        t.path    = l::g_paths[i];
+        t.ops     = 0;
+        t.errors  = 0;
+        t.nsecs   = 0;
+        t.read    = 0;
+        t.written = 0;
+        for(l::BranchSlot *slot = l::Slots::head(); slot != NULL; slot = slot->next)
+          {
+            const l::BranchCounters &c = slot->branches[i];
+
+            t.ops     += c.ops.load(std::memory_order_relaxed);
+            t.errors  += c.errors.load(std::memory_order_relaxed);
+            t.nsecs   += c.nsecs.load(std::memory_order_relaxed);
+            t.read    += c.read.load(std::memory_order_relaxed);
+            t.written += c.written.load(std::memory_order_relaxed);
+          }
+      }
+  }
+
+  void
+  log_interval(const uint64_t secs_)
+  {
+    int rv;
+    pthread_t thread;
+    pthread_attr_t attr;
+
+    pthread_mutex_lock(&l::g_lock);
+    l::g_log = secs_;
+    pthread_cond_broadcast(&l::g_cond);
+    if((secs_ > 0) && !l::g_logging)
+      {
+        const ugid::Set ugid(0,0);
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+        rv = pthread_create(&thread,&attr,l::logger,NULL);
+        pthread_attr_destroy(&attr);
+        l::g_logging = (rv == 0);
+      }
+    pthread_mutex_unlock(&l::g_lock);
+  }
+}
@@ -0,0 +1,107 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "branch.hpp"
+#include "opstats.hpp"
+
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <stdint.h>
+
+/*
+  I/O accounting per branch so a slow or overloaded drive can be
+  picked out. Branches are given a small, stable index the first time
+  they're seen. Each thread counts into its own slot, summed on read.
+*/
+namespace branchstats
+{
+  enum Kind
+    {
+      READ,
+      WRITE,
+      OTHER
+    };
+
+  struct Totals
+  {
+    std::string path;
+    uint64_t    ops;
+    uint64_t    errors;
+    uint64_t    nsecs;
+    uint64_t    read;
+    uint64_t    written;
+  };
+
+  int index(const std::string &basepath);
+  const std::string& path(const int branch);
+  int find(const Branches    &branches,
+           const std::string &fusepath,
+           const int          fd);
+
+  void record(const int      branch,
+              const Kind     kind,
+              const uint64_t bytes,
+              const uint64_t nsecs,
+              const bool     error);
+  void bytes(const int      branch,
+             const Kind     kind,
+             const uint64_t bytes);
+
+  void totals(std::vector<Totals> *totals);
+
+  void log_interval(const uint64_t secs);
+
+  /*
+    Times one call made on a branch and counts it as OTHER. done()
+    takes the call's return value, negative being an error, and hands it
+    back with errno untouched.
+  */
+  class Call
+  {
+  public:
+    Call(const std::string &basepath_)
+      : _branch(branchstats::index(basepath_)),
+        _start(opstats::now())
+    {
+    }
+
+  public:
+    template<typename T>
+    T
+    done(const T rv_) const
+    {
+      int err;
+
+      err = errno;
+      branchstats::record(_branch,OTHER,0,
+                          (opstats::now() - _start),(rv_ < 0));
+      errno = err;
+
+      return rv_;
+    }
+
+  private:
+    const int      _branch;
+    const uint64_t _start;
+  };
+}
@@ -19,14 +19,16 @@
 #include "errno.hpp"
 #include "from_string.hpp"
 #include "num.hpp"
-#include "rwlock.hpp"
+#include "str.hpp"
 #include "to_string.hpp"
 #include "version.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <string>
 #include <iostream>
 
+#include <pthread.h>
 #include <stdint.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -39,77 +41,171 @@ using std::string;
 
 namespace l
 {
+  static Config                     *master = NULL;
+  static std::atomic<const Config*>  snapshot(NULL);
+  static pthread_mutex_t             write_lock = PTHREAD_MUTEX_INITIALIZER;
+
   static
   bool
   readonly(const std::string &s_)
   {
+    IFERT("async_io");
     IFERT("async_read");
+    IFERT("balance.stats");
+    IFERT("branches.stats");
+    IFERT("cache.gid.stats");
     IFERT("cache.symlinks");
     IFERT("cache.writeback");
+    IFERT("credentials");
     IFERT("fsname");
     IFERT("fuse_msg_size");
+    IFERT("hugepages");
+    IFERT("locks.stats");
+    IFERT("memory.stats");
     IFERT("mount");
+    IFERT("moveonenospc.stats");
     IFERT("nullrw");
+    IFERT("passthrough");
     IFERT("pid");
     IFERT("readdirplus");
+    if(str::startswith(s_,"stats.") && (s_ != "stats.reset"))
+      return true;
     IFERT("threads");
+    IFERT("tiering.stats");
+    IFERT("trace.dump");
+    IFERT("trace.raw");
     IFERT("version");
 
     return false;
   }
 }
 
-Config::Config()
+ConfigOptions::ConfigOptions()
   :
-  open_cache(),
+  open_cache(*new PolicyCache()),
 
   controlfile("/.mergerfs"),
 
+  async_io(0),
   async_read(true),
   auto_cache(false),
-  branches(minfreespace),
+  balance(),
+  balance_iops(200),
+  balance_range(2),
+  balance_rate(64ULL * 1024ULL * 1024ULL),
+  balance_stats(),
+  branches(*new Branches(minfreespace)),
+  branches_stats(),
+  branches_stats_log(0),
   cache_attr(1),
   cache_entry(1),
   cache_files(CacheFiles::ENUM::LIBFUSE),
+  cache_gid(3600),
+  cache_gid_invalidate(),
+  cache_gid_stats(),
   cache_negative_entry(0),
   cache_readdir(false),
   cache_statfs(0),
   cache_symlinks(false),
-  category(func),
+  credentials(Credentials::ENUM::SWITCH),
   direct_io(false),
   dropcacheonclose(false),
   fsname(),
   func(),
   fuse_msg_size(FUSE_MAX_MAX_PAGES),
+  hugepages(HugePages::ENUM::OFF),
   ignorepponrename(false),
   inodecalc("hybrid-hash"),
+  kernel_cache(false),
   link_cow(false),
+  locks_profile(false),
+  locks_stats(),
+  memory_nodes_max(0),
+  memory_stats(),
+  mempool_max(32ULL * 1024ULL * 1024ULL),
   minfreespace(MINFREESPACE_DEFAULT),
   mount(),
   moveonenospc(false),
+  moveonenospc_async(false),
+  moveonenospc_stats(),
   nfsopenhack(NFSOpenHack::ENUM::OFF),
   nullrw(false),
+  passthrough(false),
   pid(::getpid()),
   posix_acl(false),
   readdir(ReadDir::ENUM::POSIX),
   readdirplus(false),
   security_capability(true),
-  srcmounts(branches),
+  srcmounts(*new SrcMounts(branches)),
   statfs(StatFS::ENUM::BASE),
   statfs_ignore(StatFSIgnore::ENUM::NONE),
+  stats(),
+  stats_reset(),
   symlinkify(false),
   symlinkify_timeout(3600),
   threads(0),
+  tiering(false),
+  tiering_high(80),
+  tiering_interval(60),
+  tiering_iops(200),
+  tiering_low(60),
+  tiering_order(TieringOrder::ENUM::ATIME),
+  tiering_promote(0),
+  tiering_rate(64ULL * 1024ULL * 1024ULL),
+  tiering_stats(),
+  tiering_window(3600),
+  trace(0),
+  trace_dump(false),
+  trace_raw(true),
+  trace_record(),
+  trace_slow(0),
+  trace_slow_rate(10),
   version(MERGERFS_VERSION),
   writeback_cache(false),
   xattr(XAttr::ENUM::PASSTHROUGH)
 {
+}
+
+Config::Config()
+  : ConfigOptions(),
+    category(func)
+{
+  map_keys();
+  l::master = this;
+}
+
+/*
+  Used only to create the snapshots handed out by Config::Read. The
+  key map and function categories must refer to the copy's own
+  members rather than the master's.
+*/
+Config::Config(const Config &c_)
+  : ConfigOptions(c_),
+    category(func)
+{
+  map_keys();
+}
+
+void
+Config::map_keys(void)
+{
+  _map["async_io"]             = &async_io;
   _map["async_read"]           = &async_read;
   _map["auto_cache"]           = &auto_cache;
+  _map["balance"]              = &balance;
+  _map["balance.iops"]         = &balance_iops;
+  _map["balance.range"]        = &balance_range;
+  _map["balance.rate"]         = &balance_rate;
+  _map["balance.stats"]        = &balance_stats;
   _map["branches"]             = &branches;
+  _map["branches.stats"]       = &branches_stats;
+  _map["branches.stats.log"]   = &branches_stats_log;
   _map["cache.attr"]           = &cache_attr;
   _map["cache.entry"]          = &cache_entry;
   _map["cache.files"]          = &cache_files;
+  _map["cache.gid"]            = &cache_gid;
+  _map["cache.gid.invalidate"] = &cache_gid_invalidate;
+  _map["cache.gid.stats"]      = &cache_gid_stats;
   _map["cache.negative_entry"] = &cache_negative_entry;
   _map["cache.readdir"]        = &cache_readdir;
   _map["cache.statfs"]         = &cache_statfs;
@@ -118,6 +214,7 @@ Config::Config()
   _map["category.action"]      = &category.action;
   _map["category.create"]      = &category.create;
   _map["category.search"]      = &category.search;
+  _map["credentials"]          = &credentials;
   _map["direct_io"]            = &direct_io;
   _map["dropcacheonclose"]     = &dropcacheonclose;
   _map["fsname"]               = &fsname;
@@ -142,15 +239,24 @@ Config::Config()
   _map["func.unlink"]          = &func.unlink;
   _map["func.utimens"]         = &func.utimens;
   _map["fuse_msg_size"]        = &fuse_msg_size;
+  _map["hugepages"]            = &hugepages;
   _map["ignorepponrename"]     = &ignorepponrename;
   _map["inodecalc"]            = &inodecalc;
   _map["kernel_cache"]         = &kernel_cache;
   _map["link_cow"]             = &link_cow;
+  _map["locks.profile"]        = &locks_profile;
+  _map["locks.stats"]          = &locks_stats;
+  _map["memory.nodes.max"]     = &memory_nodes_max;
+  _map["memory.stats"]         = &memory_stats;
+  _map["mempool_max"]          = &mempool_max;
   _map["minfreespace"]         = &minfreespace;
   _map["mount"]                = &mount;
   _map["moveonenospc"]         = &moveonenospc;
+  _map["moveonenospc.async"]   = &moveonenospc_async;
+  _map["moveonenospc.stats"]   = &moveonenospc_stats;
   _map["nfsopenhack"]          = &nfsopenhack;
   _map["nullrw"]               = &nullrw;
+  _map["passthrough"]          = &passthrough;
   _map["pid"]                  = &pid;
   _map["posix_acl"]            = &posix_acl;
   //  _map["readdir"]              = &readdir;
@@ -159,24 +265,65 @@ Config::Config()
   _map["srcmounts"]            = &srcmounts;
   _map["statfs"]               = &statfs;
   _map["statfs_ignore"]        = &statfs_ignore;
+  _map["stats.reset"]          = &stats_reset;
   _map["symlinkify"]           = &symlinkify;
   _map["symlinkify_timeout"]   = &symlinkify_timeout;
   _map["threads"]              = &threads;
+  _map["tiering"]              = &tiering;
+  _map["tiering.high"]         = &tiering_high;
+  _map["tiering.interval"]     = &tiering_interval;
+  _map["tiering.iops"]         = &tiering_iops;
+  _map["tiering.low"]          = &tiering_low;
+  _map["tiering.order"]        = &tiering_order;
+  _map["tiering.promote"]      = &tiering_promote;
+  _map["tiering.rate"]         = &tiering_rate;
+  _map["tiering.stats"]        = &tiering_stats;
+  _map["tiering.window"]       = &tiering_window;
+  _map["trace"]                = &trace;
+  _map["trace.dump"]           = &trace_dump;
+  _map["trace.raw"]            = &trace_raw;
+  _map["trace.record"]         = &trace_record;
+  _map["trace.slow"]           = &trace_slow;
+  _map["trace.slow.rate"]      = &trace_slow_rate;
   _map["version"]              = &version;
   _map["xattr"]                = &xattr;
+
+  for(int op = 0; op < opstats::OPS; op++)
+    {
+      stats[op].op = (opstats::Op)op;
+      _map[std::string("stats.") + opstats::name(stats[op].op)] = &stats[op];
+    }
+}
+
+void
+Config::publish(void)
+{
+  const Config *old;
+
+  old = l::snapshot.exchange(new Config(*l::master),
+                             std::memory_order_acq_rel);
+  if(old == NULL)
+    return;
+
+  // requests may hold the old one across slow branch I/O
+  epoch::retire(old);
+}
+
+Config::Read::Read()
+  : _cfg(l::snapshot.load(std::memory_order_acquire))
+{
 }
 
-const
-Config&
-Config::ro(void)
+Config::Write::Write()
+  : _cfg(l::master)
 {
-  return *((Config*)fuse_get_context()->private_data);
+  pthread_mutex_lock(&l::write_lock);
 }
 
-Config&
-Config::rw(void)
+Config::Write::~Write()
 {
-  return *((Config*)fuse_get_context()->private_data);
+  Config::publish();
+  pthread_mutex_unlock(&l::write_lock);
 }
 
 bool
@@ -17,15 +17,26 @@
 #pragma once
 
 #include "branch.hpp"
+#include "config_balance.hpp"
+#include "config_branchstats.hpp"
 #include "config_cachefiles.hpp"
+#include "config_credentials.hpp"
+#include "config_gidcache.hpp"
+#include "config_hugepages.hpp"
 #include "config_inodecalc.hpp"
+#include "config_lockstats.hpp"
+#include "config_memstats.hpp"
 #include "config_moveonenospc.hpp"
+#include "config_opstats.hpp"
+#include "config_optrace.hpp"
 #include "config_nfsopenhack.hpp"
 #include "config_readdir.hpp"
 #include "config_statfs.hpp"
 #include "config_statfsignore.hpp"
+#include "config_tiering.hpp"
 #include "config_xattr.hpp"
 #include "enum.hpp"
+#include "epoch.hpp"
 #include "errno.hpp"
 #include "func_category.hpp"
 #include "funcs.hpp"
@@ -47,57 +58,124 @@ typedef ToFromWrapper<int>                  ConfigINT;
 typedef ToFromWrapper<std::string>          ConfigSTR;
 typedef std::map<std::string,ToFromString*> Str2TFStrMap;
 
-class Config
+/*
+  Every option's value. Kept apart from Config so the snapshots can be
+  made with the implicit copy constructor: anything added here is
+  copied without having to be listed. The branches and open cache are
+  references and so are shared by the master and all copies.
+*/
+class ConfigOptions
 {
-public:
-  Config();
+protected:
+  ConfigOptions();
 
 public:
-  mutable PolicyCache open_cache;
+  PolicyCache &open_cache;
 
 public:
   const std::string controlfile;
 
 public:
+  ConfigUINT64   async_io;
   ConfigBOOL     async_read;
   ConfigBOOL     auto_cache;
-  Branches       branches;
+  BalanceCtl     balance;
+  ConfigUINT64   balance_iops;
+  ConfigUINT64   balance_range;
+  ConfigUINT64   balance_rate;
+  BalanceStats   balance_stats;
+  Branches      &branches;
+  BranchStats    branches_stats;
+  ConfigUINT64   branches_stats_log;
   ConfigUINT64   cache_attr;
   ConfigUINT64   cache_entry;
   CacheFiles     cache_files;
+  ConfigUINT64   cache_gid;
+  GIDInvalidate  cache_gid_invalidate;
+  GIDStats       cache_gid_stats;
   ConfigUINT64   cache_negative_entry;
   ConfigBOOL     cache_readdir;
   ConfigUINT64   cache_statfs;
   ConfigBOOL     cache_symlinks;
-  FuncCategories category;
+  Credentials    credentials;
   ConfigBOOL     direct_io;
   ConfigBOOL     dropcacheonclose;
   ConfigSTR      fsname;
   Funcs          func;
   ConfigUINT64   fuse_msg_size;
+  HugePages      hugepages;
   ConfigBOOL     ignorepponrename;
   InodeCalc      inodecalc;
   ConfigBOOL     kernel_cache;
   ConfigBOOL     link_cow;
+  ConfigBOOL     locks_profile;
+  LockStats      locks_stats;
+  ConfigUINT64   memory_nodes_max;
+  MemStats       memory_stats;
+  ConfigUINT64   mempool_max;
   ConfigUINT64   minfreespace;
   ConfigSTR      mount;
   MoveOnENOSPC   moveonenospc;
+  ConfigBOOL     moveonenospc_async;
+  MigrationStats moveonenospc_stats;
   NFSOpenHack    nfsopenhack;
   ConfigBOOL     nullrw;
+  ConfigBOOL     passthrough;
   ConfigUINT64   pid;
   ConfigBOOL     posix_acl;
   ReadDir        readdir;
   ConfigBOOL     readdirplus;
   ConfigBOOL     security_capability;
-  SrcMounts      srcmounts;
+  SrcMounts     &srcmounts;
   StatFS         statfs;
   StatFSIgnore   statfs_ignore;
+  OpStats        stats[opstats::OPS];
+  OpStatsReset   stats_reset;
   ConfigBOOL     symlinkify;
   ConfigUINT64   symlinkify_timeout;
   ConfigINT      threads;
+  ConfigBOOL     tiering;
+  ConfigUINT64   tiering_high;
+  ConfigUINT64   tiering_interval;
+  ConfigUINT64   tiering_iops;
+  ConfigUINT64   tiering_low;
+  TieringOrder   tiering_order;
+  ConfigUINT64   tiering_promote;
+  ConfigUINT64   tiering_rate;
+  TieringStats   tiering_stats;
+  ConfigUINT64   tiering_window;
+  ConfigUINT64   trace;
+  OpTraceDump    trace_dump;
+  OpTraceDump    trace_raw;
+  ConfigSTR      trace_record;
+  ConfigUINT64   trace_slow;
+  ConfigUINT64   trace_slow_rate;
   ConfigSTR      version;
   ConfigBOOL     writeback_cache;
   XAttr          xattr;
+};
+
+/*
+  There is one mutable master Config which is only touched through
+  Config::Write. Every Write publishes an immutable copy of it and
+  requests read that copy through Config::Read. A request therefore
+  sees one consistent set of options without taking any locks.
+*/
+class Config : public ConfigOptions
+{
+public:
+  class Read;
+  class Write;
+
+public:
+  Config();
+
+private:
+  Config(const Config &);
+
+public:
+  // refers to func so must follow it, and can't simply be copied
+  FuncCategories category;
 
 public:
   friend std::ostream& operator<<(std::ostream &s,
@@ -113,10 +191,39 @@ public:
   int set_raw(const std::string &key, const std::string &val);
   int set(const std::string &key, const std::string &val);
 
-public:
-  static const Config &ro(void);
-  static Config       &rw(void);
+private:
+  void map_keys(void);
+  static void publish(void);
 
 private:
   Str2TFStrMap _map;
 };
+
+class Config::Read
+{
+public:
+  Read();
+
+public:
+  const Config* operator->() const { return _cfg; }
+  const Config& operator*() const { return *_cfg; }
+
+private:
+  // must be declared (and therefore constructed) before _cfg
+  epoch::ReadGuard  _guard;
+  const Config     *_cfg;
+};
+
+class Config::Write
+{
+public:
+  Write();
+  ~Write();
+
+public:
+  Config* operator->() const { return _cfg; }
+  Config& operator*() const { return *_cfg; }
+
+private:
+  Config *_cfg;
+};
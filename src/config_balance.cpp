@@ -0,0 +1,80 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "config_balance.hpp"
+#include "balance.hpp"
+#include "ef.hpp"
+#include "errno.hpp"
+#include "to_string.hpp"
+
+#include <string>
+
+#include <stdio.h>
+
+int
+BalanceCtl::from_string(const std::string &s_)
+{
+  if(s_ == "start")
+    balance::start();
+  ef(s_ == "pause")
+    balance::pause();
+  ef(s_ == "resume")
+    balance::resume();
+  ef(s_ == "stop")
+    balance::stop();
+  else
+    return -EINVAL;
+
+  return 0;
+}
+
+std::string
+BalanceCtl::to_string(void) const
+{
+  return balance::state();
+}
+
+int
+BalanceStats::from_string(const std::string &s_)
+{
+  return -EINVAL;
+}
+
+std::string
+BalanceStats::to_string(void) const
+{
+  char spread[32];
+  std::string s;
+  balance::Stats stats;
+
+  balance::stats(&stats);
+
+  snprintf(spread,sizeof(spread),"%llu.%02llu",
+           (unsigned long long)(stats.spread / 100),
+           (unsigned long long)(stats.spread % 100));
+
+  s  = "state=" + std::string(stats.state);
+  s += " moved=" + str::to(stats.moved);
+  s += " bytes=" + str::to(stats.bytes);
+  s += " skipped=" + str::to(stats.skipped);
+  s += " errors=" + str::to(stats.errors);
+  s += " spread=" + std::string(spread);
+
+  return s;
+}
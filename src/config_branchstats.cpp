@@ -0,0 +1,57 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "config_branchstats.hpp"
+#include "branchstats.hpp"
+#include "errno.hpp"
+#include "to_string.hpp"
+
+#include <string>
+#include <vector>
+
+int
+BranchStats::from_string(const std::string &s_)
+{
+  return -EINVAL;
+}
+
+std::string
+BranchStats::to_string(void) const
+{
+  std::string s;
+  std::vector<branchstats::Totals> totals;
+
+  branchstats::totals(&totals);
+
+  for(size_t i = 0; i < totals.size(); i++)
+    {
+      const branchstats::Totals &t = totals[i];
+
+      if(i)
+        s += '\n';
+      s += t.path;
+      s += " ops=" + str::to(t.ops);
+      s += " errors=" + str::to(t.errors);
+      s += " nsecs=" + str::to(t.nsecs);
+      s += " read=" + str::to(t.read);
+      s += " written=" + str::to(t.written);
+    }
+
+  return s;
+}
@@ -0,0 +1,50 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "config_credentials.hpp"
+#include "ef.hpp"
+#include "errno.hpp"
+
+template<>
+int
+Credentials::from_string(const std::string &s_)
+{
+  if(s_ == "switch")
+    _data = Credentials::ENUM::SWITCH;
+  ef(s_ == "fixup")
+    _data = Credentials::ENUM::FIXUP;
+  else
+    return -EINVAL;
+
+  return 0;
+}
+
+template<>
+std::string
+Credentials::to_string(void) const
+{
+  switch(_data)
+    {
+    case Credentials::ENUM::SWITCH:
+      return "switch";
+    case Credentials::ENUM::FIXUP:
+      return "fixup";
+    }
+
+  return std::string();
+}
@@ -0,0 +1,117 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "config_gidcache.hpp"
+#include "errno.hpp"
+#include "gidcache.hpp"
+#include "to_string.hpp"
+
+#include <string>
+#include <vector>
+
+#include <pwd.h>
+#include <stdlib.h>
+
+namespace l
+{
+  static
+  int
+  getuid(const std::string &s_,
+         uid_t             *uid_)
+  {
+    int rv;
+    char *endptr;
+    unsigned long uid;
+    struct passwd pwd;
+    struct passwd *pwdrv;
+    std::vector<char> buf(4096);
+
+    if(s_.empty())
+      return -EINVAL;
+
+    uid = ::strtoul(s_.c_str(),&endptr,10);
+    if(*endptr == '\0')
+      {
+        *uid_ = uid;
+        return 0;
+      }
+
+    rv = ::getpwnam_r(s_.c_str(),&pwd,&buf[0],buf.size(),&pwdrv);
+    if((rv != 0) || (pwdrv == NULL))
+      return -EINVAL;
+
+    *uid_ = pwd.pw_uid;
+
+    return 0;
+  }
+}
+
+int
+GIDStats::from_string(const std::string &s_)
+{
+  return -EINVAL;
+}
+
+std::string
+GIDStats::to_string(void) const
+{
+  std::string s;
+  gidcache::Stats stats;
+
+  gidcache::stats(&stats);
+
+  s  = "hits=" + str::to(stats.hits);
+  s += " misses=" + str::to(stats.misses);
+  s += " stale=" + str::to(stats.stale);
+  s += " refreshes=" + str::to(stats.refreshes);
+  s += " entries=" + str::to(stats.entries);
+  s += " bytes=" + str::to(stats.bytes);
+
+  return s;
+}
+
+/*
+  Accepts "all", a uid or a user name.
+*/
+int
+GIDInvalidate::from_string(const std::string &s_)
+{
+  int rv;
+  uid_t uid;
+
+  if(s_ == "all")
+    {
+      gidcache::invalidate();
+      return 0;
+    }
+
+  rv = l::getuid(s_,&uid);
+  if(rv < 0)
+    return rv;
+
+  gidcache::invalidate(uid);
+
+  return 0;
+}
+
+std::string
+GIDInvalidate::to_string(void) const
+{
+  return std::string();
+}
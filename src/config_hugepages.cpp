@@ -0,0 +1,54 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "config_hugepages.hpp"
+#include "ef.hpp"
+#include "errno.hpp"
+
+template<>
+int
+HugePages::from_string(const std::string &s_)
+{
+  if(s_ == "off")
+    _data = HugePages::ENUM::OFF;
+  ef(s_ == "transparent")
+    _data = HugePages::ENUM::TRANSPARENT;
+  ef(s_ == "explicit")
+    _data = HugePages::ENUM::EXPLICIT;
+  else
+    return -EINVAL;
+
+  return 0;
+}
+
+template<>
+std::string
+HugePages::to_string(void) const
+{
+  switch(_data)
+    {
+    case HugePages::ENUM::OFF:
+      return "off";
+    case HugePages::ENUM::TRANSPARENT:
+      return "transparent";
+    case HugePages::ENUM::EXPLICIT:
+      return "explicit";
+    }
+
+  return std::string();
+}
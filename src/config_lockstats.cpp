@@ -0,0 +1,60 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "config_lockstats.hpp"
+#include "errno.hpp"
+#include "to_string.hpp"
+
+#include "fuse_lockstat.h"
+
+#include <string>
+
+namespace l
+{
+  static
+  void
+  append(const fuse_lockstat_t *ls_,
+         void                  *data_)
+  {
+    std::string *s = (std::string*)data_;
+
+    if(!s->empty())
+      *s += '\n';
+    *s += ls_->name;
+    *s += " acquired=" + str::to(__atomic_load_n(&ls_->acquired,__ATOMIC_RELAXED));
+    *s += " contended=" + str::to(__atomic_load_n(&ls_->contended,__ATOMIC_RELAXED));
+    *s += " wait_nsecs=" + str::to(__atomic_load_n(&ls_->wait_nsecs,__ATOMIC_RELAXED));
+  }
+}
+
+int
+LockStats::from_string(const std::string &s_)
+{
+  return -EINVAL;
+}
+
+std::string
+LockStats::to_string(void) const
+{
+  std::string s;
+
+  fuse_lockstat_foreach(l::append,&s);
+
+  return s;
+}
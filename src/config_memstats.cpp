@@ -0,0 +1,54 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "config_memstats.hpp"
+#include "errno.hpp"
+#include "memstats.hpp"
+#include "to_string.hpp"
+
+#include <string>
+#include <vector>
+
+int
+MemStats::from_string(const std::string &s_)
+{
+  return -EINVAL;
+}
+
+std::string
+MemStats::to_string(void) const
+{
+  std::string s;
+  std::vector<memstats::Usage> usage;
+
+  memstats::usage(&usage);
+
+  for(size_t i = 0; i < usage.size(); i++)
+    {
+      const memstats::Usage &u = usage[i];
+
+      if(i)
+        s += '\n';
+      s += u.name;
+      s += " entries=" + str::to(u.entries);
+      s += " bytes=" + str::to(u.bytes);
+    }
+
+  return s;
+}
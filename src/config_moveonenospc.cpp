@@ -20,6 +20,8 @@
 #include "ef.hpp"
 #include "errno.hpp"
 #include "from_string.hpp"
+#include "moveonenospc_async.hpp"
+#include "to_string.hpp"
 
 int
 MoveOnENOSPC::from_string(const std::string &s_)
@@ -53,3 +55,27 @@ MoveOnENOSPC::to_string(void) const
     return policy->to_string();
   return "false";
 }
+
+int
+MigrationStats::from_string(const std::string &s_)
+{
+  return -EINVAL;
+}
+
+std::string
+MigrationStats::to_string(void) const
+{
+  std::string s;
+  moveonenospc::Stats stats;
+
+  moveonenospc::stats(&stats);
+
+  s  = "queued=" + str::to(stats.queued);
+  s += " active=" + str::to(stats.active);
+  s += " completed=" + str::to(stats.completed);
+  s += " failed=" + str::to(stats.failed);
+  s += " bytes_copied=" + str::to(stats.bytes_copied);
+  s += " bytes_total=" + str::to(stats.bytes_total);
+
+  return s;
+}
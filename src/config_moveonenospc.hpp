@@ -42,3 +42,13 @@ public:
   bool enabled;
   const Policy *policy;
 };
+
+/*
+  Stateless. Reports the progress of background migrations.
+*/
+class MigrationStats : public ToFromString
+{
+public:
+  int from_string(const std::string &);
+  std::string to_string(void) const;
+};
@@ -0,0 +1,70 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "config_opstats.hpp"
+#include "errno.hpp"
+#include "to_string.hpp"
+
+#include "fuse_lockstat.h"
+
+#include <string>
+
+OpStats::OpStats()
+  : op(opstats::ACCESS)
+{
+}
+
+int
+OpStats::from_string(const std::string &s_)
+{
+  return -EINVAL;
+}
+
+std::string
+OpStats::to_string(void) const
+{
+  std::string s;
+  opstats::Summary summary;
+
+  opstats::summary(op,&summary);
+
+  s  = "count=" + str::to(summary.count);
+  s += " errors=" + str::to(summary.errors);
+  s += " p50=" + str::to(summary.p50);
+  s += " p90=" + str::to(summary.p90);
+  s += " p99=" + str::to(summary.p99);
+  s += " p999=" + str::to(summary.p999);
+
+  return s;
+}
+
+int
+OpStatsReset::from_string(const std::string &s_)
+{
+  opstats::reset();
+  fuse_lockstat_reset();
+
+  return 0;
+}
+
+std::string
+OpStatsReset::to_string(void) const
+{
+  return std::string();
+}
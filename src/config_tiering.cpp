@@ -0,0 +1,96 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "config_tiering.hpp"
+#include "ef.hpp"
+#include "errno.hpp"
+#include "tiering.hpp"
+#include "to_string.hpp"
+
+#include <string>
+
+#include <stdio.h>
+
+template<>
+std::string
+TieringOrder::to_string() const
+{
+  switch(_data)
+    {
+    case TieringOrder::ENUM::ATIME:
+      return "atime";
+    case TieringOrder::ENUM::MTIME:
+      return "mtime";
+    }
+
+  return "invalid";
+}
+
+template<>
+int
+TieringOrder::from_string(const std::string &s_)
+{
+  if(s_ == "atime")
+    _data = TieringOrder::ENUM::ATIME;
+  ef(s_ == "mtime")
+    _data = TieringOrder::ENUM::MTIME;
+  else
+    return -EINVAL;
+
+  return 0;
+}
+
+int
+TieringStats::from_string(const std::string &s_)
+{
+  return -EINVAL;
+}
+
+std::string
+TieringStats::to_string(void) const
+{
+  char pct[32];
+  uint64_t used;
+  std::string s;
+  tiering::Stats stats;
+
+  tiering::stats(&stats);
+
+  s  = "state=" + std::string(stats.state);
+  s += " demoted=" + str::to(stats.demoted);
+  s += " promoted=" + str::to(stats.promoted);
+  s += " bytes=" + str::to(stats.bytes);
+  s += " skipped=" + str::to(stats.skipped);
+  s += " errors=" + str::to(stats.errors);
+  for(std::map<uint64_t,tiering::Usage>::const_iterator
+        i = stats.tiers.begin(), ei = stats.tiers.end(); i != ei; ++i)
+    {
+      used = 0;
+      if(i->second.total)
+        used = ((i->second.used * 10000ULL) / i->second.total);
+
+      snprintf(pct,sizeof(pct),"%llu.%02llu",
+               (unsigned long long)(used / 100),
+               (unsigned long long)(used % 100));
+
+      s += " tier" + str::to(i->first) + "=" + pct;
+    }
+
+  return s;
+}
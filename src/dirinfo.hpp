@@ -20,6 +20,8 @@
 
 #include <string>
 
+#include <stddef.h>
+
 class DirInfo : public FH
 {
 public:
@@ -27,4 +29,8 @@ public:
     : FH(fusepath_)
   {
   }
+
+public:
+  static void* operator new(size_t);
+  static void  operator delete(void*);
 };
@@ -0,0 +1,198 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "epoch.hpp"
+
+#include "thread_slots.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CACHELINE_SIZE 64
+
+namespace l
+{
+  struct EpochSlot
+  {
+    std::atomic<uint64_t> epoch;
+    uint64_t              depth;
+    bool                  used;
+    EpochSlot            *next;
+  } __attribute__((aligned(CACHELINE_SIZE)));
+
+  typedef ThreadSlots<EpochSlot> Slots;
+
+  static std::atomic<uint64_t> g_epoch(1);
+
+  struct Retired
+  {
+    void (*free)(void*);
+    void  *ptr;
+  };
+
+  static pthread_mutex_t       g_retired_lock = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t        g_retired_cond = PTHREAD_COND_INITIALIZER;
+  static pthread_once_t        g_reclaimer_once = PTHREAD_ONCE_INIT;
+  static std::vector<Retired>  g_retired;
+}
+
+namespace epoch
+{
+  void
+  enter(void)
+  {
+    l::EpochSlot *slot;
+
+    slot = l::Slots::get();
+    if(slot->depth++)
+      return;
+
+    slot->epoch.store(l::g_epoch.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+
+    // the slot must be visible before any shared pointer is loaded
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  void
+  leave(void)
+  {
+    l::EpochSlot *slot = l::Slots::local();
+
+    if(--slot->depth)
+      return;
+
+    slot->epoch.store(0,std::memory_order_release);
+  }
+
+  /*
+    Slots are only ever added to the head of the list and never freed
+    so once the head is read the list can be walked without the lock.
+    A thread registering a slot afterwards takes the lock after the
+    epoch was advanced and so can only enter with the new epoch.
+
+    The wait isn't done under the lock: readers may be in the middle
+    of slow branch I/O and other writers and registering threads
+    shouldn't queue up behind them.
+  */
+  void
+  synchronize(void)
+  {
+    uint64_t e;
+    uint64_t spins;
+    uint64_t target;
+    l::EpochSlot *self;
+    l::EpochSlot *slot;
+    struct timespec ts;
+
+    target = (l::g_epoch.fetch_add(1,std::memory_order_seq_cst) + 1);
+
+    // pairs with the fence in enter(): the new pointer, published by
+    // the caller before this, must be visible before slots are read
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    self = l::Slots::local();
+    for(slot = l::Slots::head(); slot != NULL; slot = slot->next)
+      {
+        if(slot == self)
+          continue;
+
+        for(spins = 0;; spins++)
+          {
+            e = slot->epoch.load(std::memory_order_acquire);
+            if((e == 0) || (e >= target))
+              break;
+
+            if(spins < 64)
+              {
+                sched_yield();
+                continue;
+              }
+
+            // back off to at most 1ms when a reader is blocked on I/O
+            ts.tv_sec  = 0;
+            ts.tv_nsec = (1000 << std::min(spins - 64,(uint64_t)10));
+            nanosleep(&ts,NULL);
+          }
+      }
+  }
+
+  /*
+    Everything retired before the batch is taken was unpublished
+    before the synchronize() so it's safe to free after.
+  */
+  static
+  void*
+  reclaimer(void *arg_)
+  {
+    std::vector<l::Retired> batch;
+
+    for(;;)
+      {
+        pthread_mutex_lock(&l::g_retired_lock);
+        while(l::g_retired.empty())
+          pthread_cond_wait(&l::g_retired_cond,&l::g_retired_lock);
+        batch.swap(l::g_retired);
+        pthread_mutex_unlock(&l::g_retired_lock);
+
+        epoch::synchronize();
+
+        for(size_t i = 0; i < batch.size(); i++)
+          batch[i].free(batch[i].ptr);
+        batch.clear();
+      }
+
+    return NULL;
+  }
+
+  static
+  void
+  reclaimer_start(void)
+  {
+    int rv;
+    pthread_t thread;
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+    rv = pthread_create(&thread,&attr,epoch::reclaimer,NULL);
+    if(rv != 0)
+      abort();
+    pthread_attr_destroy(&attr);
+  }
+
+  void
+  retire(void  (*free_)(void*),
+         void   *ptr_)
+  {
+    pthread_once(&l::g_reclaimer_once,epoch::reclaimer_start);
+
+    pthread_mutex_lock(&l::g_retired_lock);
+    l::g_retired.push_back((l::Retired){free_,ptr_});
+    pthread_cond_signal(&l::g_retired_cond);
+    pthread_mutex_unlock(&l::g_retired_lock);
+  }
+}
@@ -0,0 +1,76 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+/*
+  Epoch based reclamation.
+
+  Readers bracket their use of shared, immutable data with a
+  ReadGuard. Entering and leaving only touch the calling thread's own
+  slot so there is no shared cacheline traffic between readers and
+  readers never wait on writers.
+
+  A writer publishes a new version, calls synchronize() which waits
+  until every reader which might have seen the old version has left,
+  and then frees the old version. Guards may be nested.
+
+  Writers which mustn't wait on readers, who may be stuck on slow
+  branch I/O, retire() the old version instead. A background thread
+  frees it after a later synchronize().
+*/
+
+namespace epoch
+{
+  void enter(void);
+  void leave(void);
+  void synchronize(void);
+  void retire(void (*free)(void*), void *ptr);
+
+  template<typename T>
+  static
+  void
+  destroy(void *ptr_)
+  {
+    delete (T*)ptr_;
+  }
+
+  template<typename T>
+  static
+  inline
+  void
+  retire(T *ptr_)
+  {
+    epoch::retire(epoch::destroy<T>,(void*)ptr_);
+  }
+
+  class ReadGuard
+  {
+  public:
+    ReadGuard()
+    {
+      epoch::enter();
+    }
+
+    ~ReadGuard()
+    {
+      epoch::leave();
+    }
+  };
+}
@@ -18,18 +18,33 @@
 
 #include "fh.hpp"
 
+#include <atomic>
 #include <string>
 
+#include <stddef.h>
+
+namespace moveonenospc { class Migration; }
+
 class FileInfo : public FH
 {
 public:
   FileInfo(const int   fd_,
            const char *fusepath_)
     : FH(fusepath_),
-      fd(fd_)
+      fd(fd_),
+      backing_id(0),
+      branch(-1),
+      migration(NULL)
   {
   }
 
+public:
+  static void* operator new(size_t);
+  static void  operator delete(void*);
+
 public:
   int fd;
+  int backing_id;
+  int branch;
+  std::atomic<moveonenospc::Migration*> migration;
 };
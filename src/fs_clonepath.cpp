@@ -25,6 +25,7 @@
 #include "fs_mkdir.hpp"
 #include "fs_path.hpp"
 #include "fs_xattr.hpp"
+#include "slowlog.hpp"
 #include "ugid.hpp"
 
 using std::string;
@@ -142,6 +143,7 @@ namespace fs
       return 0;
 
     {
+      const slowlog::Timer timer(to_);
       const ugid::SetRootGuard ugidGuard;
 
       return fs::clonepath(from_,to_,relative_,return_metadata_errors_);
@@ -16,22 +16,260 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "fs_copydata.hpp"
+
+#include "errno.hpp"
 #include "fs_copydata_copy_file_range.hpp"
 #include "fs_copydata_readwrite.hpp"
 #include "fs_fadvise.hpp"
 #include "fs_ficlone.hpp"
 #include "fs_ftruncate.hpp"
+#include "fs_lseek.hpp"
+
+#include <atomic>
+#include <vector>
 
+#include <pthread.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define COPY_CHUNK_SIZE   (16ULL * 1024ULL * 1024ULL)
+#define COPY_BUF_SIZE     (1024ULL * 1024ULL)
+#define COPY_BUF_ALIGN    (4096)
+#define COPY_MAX_THREADS  4
+
+namespace l
+{
+  struct Range
+  {
+    uint64_t offset;
+    uint64_t end;
+  };
+
+  typedef std::vector<Range> RangeVec;
+
+  struct Job
+  {
+    int                  src_fd;
+    int                  dst_fd;
+    RangeVec             chunks;
+    std::atomic<size_t>  next;
+    std::atomic<bool>    cfr;
+    std::atomic<int>     error;
+  };
+
+  /*
+    Only the data regions of the source are copied. Everything else
+    was left a hole by the ftruncate of the destination. Filesystems
+    without SEEK_DATA support report the whole file as data.
+  */
+  static
+  void
+  data_extents(const int       fd_,
+               const uint64_t  size_,
+               RangeVec       *extents_)
+  {
+#if defined SEEK_DATA && defined SEEK_HOLE
+    off_t data;
+    off_t hole;
+
+    hole = 0;
+    while((uint64_t)hole < size_)
+      {
+        data = fs::lseek(fd_,hole,SEEK_DATA);
+        if((data == -1) && (errno == ENXIO))
+          return;
+        if(data == -1)
+          break;
+        if((uint64_t)data >= size_)
+          return;
+
+        hole = fs::lseek(fd_,data,SEEK_HOLE);
+        if((hole == -1) || ((uint64_t)hole > size_))
+          hole = size_;
+
+        extents_->push_back((Range){(uint64_t)data,(uint64_t)hole});
+      }
+
+    if((uint64_t)hole >= size_)
+      return;
+
+    extents_->clear();
+#endif
+
+    extents_->push_back((Range){0,size_});
+  }
+
+  static
+  void
+  split(const RangeVec &extents_,
+        RangeVec       *chunks_)
+  {
+    Range r;
+
+    for(size_t i = 0; i < extents_.size(); i++)
+      {
+        r.offset = extents_[i].offset;
+        while(r.offset < extents_[i].end)
+          {
+            r.end = r.offset + COPY_CHUNK_SIZE;
+            if(r.end > extents_[i].end)
+              r.end = extents_[i].end;
+
+            chunks_->push_back(r);
+            r.offset = r.end;
+          }
+      }
+  }
+
+  static
+  bool
+  cfr_unsupported(const int err_)
+  {
+    switch(err_)
+      {
+      case EINVAL:
+      case ENOSYS:
+      case ENOTSUP:
+#if ENOTSUP != EOPNOTSUPP
+      case EOPNOTSUPP:
+#endif
+      case EXDEV:
+        return true;
+      }
+
+    return false;
+  }
+
+  static
+  void*
+  worker(void *job_)
+  {
+    int rv;
+    size_t i;
+    void *buf;
+    Job *job = (Job*)job_;
+
+    if(posix_memalign(&buf,COPY_BUF_ALIGN,COPY_BUF_SIZE) != 0)
+      {
+        job->error = ENOMEM;
+        return NULL;
+      }
+
+    while(job->error == 0)
+      {
+        i = job->next++;
+        if(i >= job->chunks.size())
+          break;
+
+        fs::fadvise_sequential(job->src_fd,
+                               job->chunks[i].offset,
+                               job->chunks[i].end - job->chunks[i].offset);
+
+        rv = fs::copydata_range(job->src_fd,
+                                job->dst_fd,
+                                job->chunks[i].offset,
+                                job->chunks[i].end,
+                                &job->cfr,
+                                (char*)buf,
+                                COPY_BUF_SIZE);
+        if(rv == -1)
+          job->error = errno;
+      }
+
+    ::free(buf);
+
+    return NULL;
+  }
+
+  /*
+    Chunks are handed out to up to COPY_MAX_THREADS workers, the
+    calling thread being one of them, so large files are read and
+    written with several requests in flight.
+  */
+  static
+  int
+  copy_parallel(Job *job_)
+  {
+    int rv;
+    size_t nthreads;
+    std::vector<pthread_t> threads;
+
+    nthreads = job_->chunks.size();
+    if(nthreads > COPY_MAX_THREADS)
+      nthreads = COPY_MAX_THREADS;
+
+    for(size_t i = 1; i < nthreads; i++)
+      {
+        pthread_t thread;
+
+        rv = pthread_create(&thread,NULL,l::worker,job_);
+        if(rv != 0)
+          break;
+
+        threads.push_back(thread);
+      }
+
+    l::worker(job_);
+
+    for(size_t i = 0; i < threads.size(); i++)
+      pthread_join(threads[i],NULL);
+
+    if(job_->error != 0)
+      return (errno=job_->error,-1);
+
+    return 0;
+  }
+}
 
 namespace fs
 {
+  /*
+    copy_file_range is tried first as it lets the kernel reflink or
+    copy server side. Any failure falls back to copying the rest of
+    the range through buf. Once it fails as unsupported *cfr is
+    cleared so later ranges of the same copy don't try it again.
+  */
+  int
+  copydata_range(const int          src_fd_,
+                 const int          dst_fd_,
+                 const uint64_t     offset_,
+                 const uint64_t     end_,
+                 std::atomic<bool> *cfr_,
+                 char              *buf_,
+                 const size_t       bufsize_)
+  {
+    int rv;
+    uint64_t offset;
+
+    offset = offset_;
+    if(*cfr_)
+      {
+        rv = fs::copydata_copy_file_range(src_fd_,dst_fd_,&offset,end_);
+        if(rv == 0)
+          return 0;
+        if(l::cfr_unsupported(errno))
+          *cfr_ = false;
+      }
+
+    return fs::copydata_readwrite(src_fd_,
+                                  dst_fd_,
+                                  &offset,
+                                  end_,
+                                  buf_,
+                                  bufsize_);
+  }
+
   int
   copydata(const int    src_fd_,
            const int    dst_fd_,
            const size_t count_)
   {
     int rv;
+    l::Job job;
+    l::RangeVec extents;
 
     rv = fs::ftruncate(dst_fd_,count_);
     if(rv == -1)
@@ -42,12 +280,16 @@ namespace fs
       return rv;
 
     fs::fadvise_willneed(src_fd_,0,count_);
-    fs::fadvise_sequential(src_fd_,0,count_);
 
-    rv = fs::copydata_copy_file_range(src_fd_,dst_fd_);
-    if(rv != -1)
-      return rv;
+    l::data_extents(src_fd_,count_,&extents);
+
+    job.src_fd = src_fd_;
+    job.dst_fd = dst_fd_;
+    job.next   = 0;
+    job.cfr    = true;
+    job.error  = 0;
+    l::split(extents,&job.chunks);
 
-    return fs::copydata_readwrite(src_fd_,dst_fd_);
+    return l::copy_parallel(&job);
   }
 }
@@ -18,7 +18,10 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <stddef.h>
+#include <stdint.h>
 
 namespace fs
 {
@@ -26,4 +29,13 @@ namespace fs
   copydata(const int    src_fd,
            const int    dst_fd,
            const size_t count);
+
+  int
+  copydata_range(const int          src_fd,
+                 const int          dst_fd,
+                 const uint64_t     offset,
+                 const uint64_t     end,
+                 std::atomic<bool> *cfr,
+                 char              *buf,
+                 const size_t       bufsize);
 }
@@ -16,56 +16,43 @@
 
 #include "errno.hpp"
 #include "fs_copy_file_range.hpp"
-#include "fs_fstat.hpp"
 
 #include <stdint.h>
 
-namespace l
+namespace fs
 {
-  int64_t
-  copydata_copy_file_range(const int src_fd_,
-                           const int dst_fd_,
-                           uint64_t  size_)
+  /*
+    Copies [*offset,end) advancing *offset as data is copied so on
+    error the caller knows where to pick up with another method.
+  */
+  int
+  copydata_copy_file_range(const int       src_fd_,
+                           const int       dst_fd_,
+                           uint64_t       *offset_,
+                           const uint64_t  end_)
   {
-    int64_t  rv;
-    uint64_t nleft;
-    int64_t  src_off;
-    int64_t  dst_off;
+    int64_t rv;
+    int64_t src_off;
+    int64_t dst_off;
 
-    src_off = 0;
-    dst_off = 0;
-    nleft   = size_;
-    do
+    while(*offset_ < end_)
       {
-        rv = fs::copy_file_range(src_fd_,&src_off,dst_fd_,&dst_off,nleft,0);
+        src_off = *offset_;
+        dst_off = *offset_;
+        rv = fs::copy_file_range(src_fd_,&src_off,
+                                 dst_fd_,&dst_off,
+                                 (end_ - *offset_),
+                                 0);
         if((rv == -1) && (errno == EINTR))
           continue;
         if(rv == -1)
           return -1;
+        if(rv == 0)
+          break;
 
-        nleft -= rv;
+        *offset_ += rv;
       }
-    while(nleft > 0);
-
-    return size_;
-  }
-}
-
-namespace fs
-{
-  int64_t
-  copydata_copy_file_range(const int src_fd_,
-                           const int dst_fd_)
-  {
-    int rv;
-    struct stat st;
-
-    rv = fs::fstat(src_fd_,&st);
-    if(rv == -1)
-      return -1;
 
-    return l::copydata_copy_file_range(src_fd_,
-                                       dst_fd_,
-                                       st.st_size);
+    return 0;
   }
 }
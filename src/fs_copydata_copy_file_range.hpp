@@ -20,7 +20,9 @@
 
 namespace fs
 {
-  int64_t
-  copydata_copy_file_range(const int src_fd,
-                           const int dst_fd);
+  int
+  copydata_copy_file_range(const int       src_fd,
+                           const int       dst_fd,
+                           uint64_t       *offset,
+                           const uint64_t  end);
 }
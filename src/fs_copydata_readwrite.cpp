@@ -15,99 +15,81 @@
 */
 
 #include "errno.hpp"
-#include "fs_fstat.hpp"
-#include "fs_lseek.hpp"
 #include "fs_read.hpp"
 #include "fs_write.hpp"
 
-#include <vector>
-
-using std::vector;
+#include <stddef.h>
+#include <stdint.h>
 
 namespace l
 {
   static
   int
-  writen(const int     fd_,
-         const char   *buf_,
-         const size_t  size_)
+  pwriten(const int     fd_,
+          const char   *buf_,
+          const size_t  size_,
+          off_t         offset_)
   {
     ssize_t rv;
     size_t nleft;
 
     nleft = size_;
-    do
+    while(nleft > 0)
       {
-        rv = fs::write(fd_,buf_,nleft);
+        rv = fs::pwrite(fd_,buf_,nleft,offset_);
         if((rv == -1) && (errno == EINTR))
           continue;
         if(rv == -1)
           return -1;
 
-        nleft -= rv;
-        buf_  += rv;
+        nleft   -= rv;
+        buf_    += rv;
+        offset_ += rv;
       }
-    while(nleft > 0);
 
-    return size_;
+    return 0;
   }
+}
 
-  static
+namespace fs
+{
+  /*
+    Copies [*offset,end) through the provided buffer advancing *offset
+    as data is written. Stops early, without error, at end of file.
+  */
   int
-  copydata_readwrite(const int    src_fd_,
-                     const int    dst_fd_,
-                     const size_t count_,
-                     const size_t blocksize_)
+  copydata_readwrite(const int       src_fd_,
+                     const int       dst_fd_,
+                     uint64_t       *offset_,
+                     const uint64_t  end_,
+                     char           *buf_,
+                     const size_t    bufsize_)
   {
+    int rv;
     ssize_t nr;
-    ssize_t nw;
-    ssize_t bufsize;
-    size_t  totalwritten;
-    vector<char> buf;
+    size_t count;
 
-    bufsize = (blocksize_ * 16);
-    buf.resize(bufsize);
-
-    fs::lseek(src_fd_,0,SEEK_SET);
-
-    totalwritten = 0;
-    while(totalwritten < count_)
+    while(*offset_ < end_)
       {
-        nr = fs::read(src_fd_,&buf[0],bufsize);
-        if(nr == 0)
-          return totalwritten;
+        count = end_ - *offset_;
+        if(count > bufsize_)
+          count = bufsize_;
+
+        nr = fs::pread(src_fd_,buf_,count,*offset_);
         if((nr == -1) && (errno == EINTR))
           continue;
         if(nr == -1)
           return -1;
+        if(nr == 0)
+          break;
 
-        nw = l::writen(dst_fd_,&buf[0],nr);
-        if(nw == -1)
+        rv = l::pwriten(dst_fd_,buf_,nr,*offset_);
+        if(rv == -1)
           return -1;
 
-        totalwritten += nw;
+        *offset_ += nr;
       }
 
-    return totalwritten;
-  }
-}
-
-namespace fs
-{
-  int
-  copydata_readwrite(const int src_fd_,
-                     const int dst_fd_)
-  {
-    int rv;
-    struct stat st;
-
-    rv = fs::fstat(src_fd_,&st);
-    if(rv == -1)
-      return -1;
-
-    return l::copydata_readwrite(src_fd_,
-                                 dst_fd_,
-                                 st.st_size,
-                                 st.st_blksize);
+    return 0;
   }
 }
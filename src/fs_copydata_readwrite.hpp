@@ -16,9 +16,16 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 namespace fs
 {
   int
-  copydata_readwrite(const int src_fd,
-                     const int dst_fd);
+  copydata_readwrite(const int       src_fd,
+                     const int       dst_fd,
+                     uint64_t       *offset,
+                     const uint64_t  end,
+                     char           *buf,
+                     const size_t    bufsize);
 }
@@ -20,6 +20,7 @@
 
 #include "fs_lstat.hpp"
 #include "fs_path.hpp"
+#include "slowlog.hpp"
 
 #include <string>
 
@@ -55,6 +56,7 @@ namespace fs
          const std::string &relpath_)
   {
     std::string fullpath;
+    const slowlog::Timer timer(basepath_);
 
     fullpath = fs::path::make(basepath_,relpath_);
 
@@ -69,6 +71,7 @@ namespace fs
          struct stat       *st_)
   {
     std::string fullpath;
+    const slowlog::Timer timer(basepath_);
 
     fullpath = fs::path::make(basepath_,relpath_);
 
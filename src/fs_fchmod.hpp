@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include "errno.hpp"
 #include "fs_fstat.hpp"
 
 #include <sys/stat.h>
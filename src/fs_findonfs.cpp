@@ -74,8 +74,8 @@ namespace fs
            const int          fd_,
            std::string       *basepath_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return l::findonfs(branches_.vec,fusepath_,fd_,basepath_);
+    return l::findonfs(branches.vec,fusepath_,fd_,basepath_);
   }
 }
@@ -21,6 +21,7 @@
 #include "fs_stat.hpp"
 #include "fs_statvfs.hpp"
 #include "fs_statvfs_cache.hpp"
+#include "slowlog.hpp"
 #include "statvfs_util.hpp"
 
 #include <stdint.h>
@@ -37,6 +38,7 @@ namespace fs
   {
     int rv;
     struct statvfs st;
+    const slowlog::Timer timer(path_);
 
     rv = fs::statvfs_cache(path_.c_str(),&st);
     if(rv == 0)
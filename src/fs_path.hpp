@@ -19,6 +19,8 @@
 #include <string>
 #include <vector>
 
+#include <string.h>
+
 namespace fs
 {
   namespace path
@@ -63,13 +65,30 @@ namespace fs
       return path;
     }
 
+    // sized up front: `base_ + suffix_` copies base_ then grows it
+    static
+    inline
+    std::string
+    make(const std::string &base_,
+         const char        *suffix_,
+         const size_t       suffixlen_)
+    {
+      std::string path;
+
+      path.reserve(base_.size() + suffixlen_);
+      path.append(base_);
+      path.append(suffix_,suffixlen_);
+
+      return path;
+    }
+
     static
     inline
     std::string
     make(const std::string &base_,
          const char        *suffix_)
     {
-      return (base_ + suffix_);
+      return fs::path::make(base_,suffix_,strlen(suffix_));
     }
 
     static
@@ -78,7 +97,7 @@ namespace fs
     make(const std::string &base_,
          const std::string &suffix_)
     {
-      return (base_ + suffix_);
+      return fs::path::make(base_,suffix_.data(),suffix_.size());
     }
   }
 };
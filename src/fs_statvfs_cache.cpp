@@ -17,8 +17,11 @@
 */
 
 #include "fs_statvfs.hpp"
+#include "slowlog.hpp"
 #include "statvfs_util.hpp"
 
+#include "fuse_lockstat.h"
+
 #include <map>
 #include <string>
 
@@ -38,6 +41,7 @@ typedef std::map<std::string,Element> statvfs_cache;
 static uint64_t        g_timeout    = 0;
 static statvfs_cache   g_cache;
 static pthread_mutex_t g_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static fuse_lockstat_t g_lockstat   = FUSE_LOCKSTAT_INIT("statvfs_cache");
 
 namespace l
 {
@@ -81,7 +85,7 @@ namespace fs
     rv = 0;
     now = l::get_time();
 
-    pthread_mutex_lock(&g_cache_lock);
+    fuse_lockstat_mutex_lock(&g_cache_lock,&g_lockstat);
 
     e = &g_cache[path_];
 
@@ -98,12 +102,29 @@ namespace fs
     return rv;
   }
 
+  void
+  statvfs_cache_usage(uint64_t *entries_,
+                      uint64_t *bytes_)
+  {
+    statvfs_cache::const_iterator i;
+
+    fuse_lockstat_mutex_lock(&g_cache_lock,&g_lockstat);
+    *entries_ = g_cache.size();
+    *bytes_   = 0;
+    for(i = g_cache.begin(); i != g_cache.end(); ++i)
+      *bytes_ += ((4 * sizeof(void*)) +
+                  sizeof(statvfs_cache::value_type) +
+                  i->first.capacity());
+    pthread_mutex_unlock(&g_cache_lock);
+  }
+
   int
   statvfs_cache_readonly(const std::string &path_,
                          bool              *readonly_)
   {
     int rv;
     struct statvfs st;
+    const slowlog::Timer timer(path_);
 
     rv = fs::statvfs_cache(path_.c_str(),&st);
     if(rv == 0)
@@ -118,6 +139,7 @@ namespace fs
   {
     int rv;
     struct statvfs st;
+    const slowlog::Timer timer(path_);
 
     rv = fs::statvfs_cache(path_.c_str(),&st);
     if(rv == 0)
@@ -132,6 +154,7 @@ namespace fs
   {
     int rv;
     struct statvfs st;
+    const slowlog::Timer timer(path_);
 
     rv = fs::statvfs_cache(path_.c_str(),&st);
     if(rv == 0)
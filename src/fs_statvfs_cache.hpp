@@ -32,6 +32,10 @@ namespace fs
   statvfs_cache(const char     *path,
                 struct statvfs *st);
 
+  void
+  statvfs_cache_usage(uint64_t *entries,
+                      uint64_t *bytes);
+
   int
   statvfs_cache_readonly(const std::string &path,
                          bool              *readonly);
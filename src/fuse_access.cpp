@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_eaccess.hpp"
@@ -45,7 +46,8 @@ namespace l
 
     fullpath = fs::path::make(basepaths[0],fusepath);
 
-    rv = fs::eaccess(fullpath,mask);
+    const branchstats::Call call(basepaths[0]);
+    rv = call.done(fs::eaccess(fullpath,mask));
 
     return ((rv == -1) ? -errno : 0);
   }
@@ -58,11 +60,11 @@ namespace FUSE
          int         mask)
   {
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::access(config.func.access.policy,
-                     config.branches,
+    return l::access(cfg->func.access.policy,
+                     cfg->branches,
                      fusepath,
                      mask);
   }
@@ -14,10 +14,12 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_lchmod.hpp"
 #include "fs_path.hpp"
+#include "moveonenospc_async.hpp"
 #include "policy_rv.hpp"
 #include "ugid.hpp"
 
@@ -62,11 +64,12 @@ namespace l
                   PolicyRV     *prv_)
   {
     string fullpath;
+    const branchstats::Call call(basepath_);
 
     fullpath = fs::path::make(basepath_,fusepath_);
 
     errno = 0;
-    fs::lchmod(fullpath,mode_);
+    call.done(fs::lchmod(fullpath,mode_));
 
     prv_->insert(errno,basepath_);
   }
@@ -121,14 +124,19 @@ namespace FUSE
   chmod(const char *fusepath_,
         mode_t      mode_)
   {
+    int rv;
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::chmod(config.func.chmod.policy,
-                    config.func.getattr.policy,
-                    config.branches,
-                    fusepath_,
-                    mode_);
+    rv = l::chmod(cfg->func.chmod.policy,
+                  cfg->func.getattr.policy,
+                  cfg->branches,
+                  fusepath_,
+                  mode_);
+    if(rv == 0)
+      moveonenospc::chmod(fusepath_,mode_);
+
+    return rv;
   }
 }
@@ -14,10 +14,12 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_lchown.hpp"
 #include "fs_path.hpp"
+#include "moveonenospc_async.hpp"
 #include "policy_rv.hpp"
 #include "ugid.hpp"
 
@@ -61,11 +63,12 @@ namespace l
                   PolicyRV     *prv_)
   {
     string fullpath;
+    const branchstats::Call call(basepath_);
 
     fullpath = fs::path::make(basepath_,fusepath_);
 
     errno = 0;
-    fs::lchown(fullpath,uid_,gid_);
+    call.done(fs::lchown(fullpath,uid_,gid_));
 
     prv_->insert(errno,basepath_);
   }
@@ -123,15 +126,20 @@ namespace FUSE
         uid_t       uid_,
         gid_t       gid_)
   {
+    int rv;
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::chown(config.func.chown.policy,
-                    config.func.getattr.policy,
-                    config.branches,
-                    fusepath_,
-                    uid_,
-                    gid_);
+    rv = l::chown(cfg->func.chown.policy,
+                  cfg->func.getattr.policy,
+                  cfg->branches,
+                  fusepath_,
+                  uid_,
+                  gid_);
+    if(rv == 0)
+      moveonenospc::chown(fusepath_,uid_,gid_);
+
+    return rv;
   }
 }
@@ -17,6 +17,7 @@
 #include "errno.hpp"
 #include "fileinfo.hpp"
 #include "fs_copy_file_range.hpp"
+#include "moveonenospc_async.hpp"
 
 #include <fuse.h>
 
@@ -59,6 +60,10 @@ namespace FUSE
     FileInfo *fi_in  = reinterpret_cast<FileInfo*>(ffi_in_->fh);
     FileInfo *fi_out = reinterpret_cast<FileInfo*>(ffi_out_->fh);
 
+    // the kernel falls back to a read/write copy
+    if(moveonenospc::active(fi_in) || moveonenospc::active(fi_out))
+      return -EXDEV;
+
     return l::copy_file_range(fi_in->fd,
                               offset_in_,
                               fi_out->fd,
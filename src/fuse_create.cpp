@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fileinfo.hpp"
@@ -21,6 +22,8 @@
 #include "fs_clonepath.hpp"
 #include "fs_open.hpp"
 #include "fs_path.hpp"
+#include "opstats.hpp"
+#include "passthrough.hpp"
 #include "ugid.hpp"
 
 #include <fuse.h>
@@ -87,6 +90,33 @@ namespace l
       }
   }
 
+  /*
+    Without credential switching the file is created as root. Only a
+    file this call actually created may be handed to the requester so
+    O_EXCL is used to tell creating apart from opening an existing
+    file.
+  */
+  static
+  int
+  create_as_root(const string &fullpath_,
+                 const int     flags_,
+                 const mode_t  mode_)
+  {
+    int fd;
+
+    fd = fs::open(fullpath_,(flags_|O_EXCL),mode_);
+    if(fd >= 0)
+      {
+        ugid::fchown_created(fd,fullpath_,mode_);
+        return fd;
+      }
+
+    if((errno != EEXIST) || (flags_ & O_EXCL))
+      return -1;
+
+    return fs::open(fullpath_,(flags_ & ~O_CREAT),mode_);
+  }
+
   static
   int
   create_core(const string &fullpath_,
@@ -97,6 +127,9 @@ namespace l
     if(!fs::acl::dir_has_defaults(fullpath_))
       mode_ &= ~umask_;
 
+    if(!ugid::switching)
+      return l::create_as_root(fullpath_,flags_,mode_);
+
     return fs::open(fullpath_,flags_,mode_);
   }
 
@@ -110,24 +143,39 @@ namespace l
               uint64_t     *fh_)
   {
     int rv;
+    int branch;
+    uint64_t start;
     string fullpath;
+    FileInfo *fi;
 
     fullpath = fs::path::make(createpath_,fusepath_);
 
+    branch = branchstats::index(createpath_);
+    start  = opstats::now();
     rv = l::create_core(fullpath,mode_,umask_,flags_);
+    branchstats::record(branch,branchstats::OTHER,0,
+                        opstats::now() - start,(rv == -1));
     if(rv == -1)
       return -errno;
 
-    *fh_ = reinterpret_cast<uint64_t>(new FileInfo(rv,fusepath_));
+    fi = new FileInfo(rv,fusepath_);
+    fi->branch = branch;
+
+    *fh_ = reinterpret_cast<uint64_t>(fi);
 
     return 0;
   }
 
+  /*
+    With tiering new files go to the fastest tier unless the policy
+    finds none of its branches suitable, full or otherwise.
+  */
   static
   int
   create(Policy::Func::Search  searchFunc_,
          Policy::Func::Create  createFunc_,
          const Branches       &branches_,
+         const bool            tiering_,
          const char           *fusepath_,
          const mode_t          mode_,
          const mode_t          umask_,
@@ -146,7 +194,11 @@ namespace l
     if(rv == -1)
       return -errno;
 
-    rv = createFunc_(branches_,fusedirpath,&createpaths);
+    rv = -1;
+    if(tiering_)
+      rv = createFunc_(branches_.fast(),fusedirpath,&createpaths);
+    if(rv == -1)
+      rv = createFunc_(branches_,fusedirpath,&createpaths);
     if(rv == -1)
       return -errno;
 
@@ -170,22 +222,28 @@ namespace FUSE
          mode_t            mode_,
          fuse_file_info_t *ffi_)
   {
+    int rv;
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    l::config_to_ffi_flags(config,ffi_);
+    l::config_to_ffi_flags(*cfg,ffi_);
 
-    if(config.writeback_cache)
+    if(cfg->writeback_cache)
       l::tweak_flags_writeback_cache(&ffi_->flags);
 
-    return l::create(config.func.getattr.policy,
-                     config.func.create.policy,
-                     config.branches,
-                     fusepath_,
-                     mode_,
-                     fc->umask,
-                     ffi_->flags,
-                     &ffi_->fh);
+    rv = l::create(cfg->func.getattr.policy,
+                   cfg->func.create.policy,
+                   cfg->branches,
+                   cfg->tiering,
+                   fusepath_,
+                   mode_,
+                   fc->umask,
+                   ffi_->flags,
+                   &ffi_->fh);
+    if((rv == 0) && cfg->passthrough)
+      passthrough::open(reinterpret_cast<FileInfo*>(ffi_->fh),ffi_);
+
+    return rv;
   }
 }
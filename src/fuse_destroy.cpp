@@ -14,11 +14,21 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "balance.hpp"
+#include "memstats.hpp"
+#include "moveonenospc_async.hpp"
+#include "oprecord.hpp"
+#include "tiering.hpp"
+
 namespace FUSE
 {
   void
   destroy(void *)
   {
-
+    balance::shutdown();
+    tiering::shutdown();
+    moveonenospc::drain();
+    oprecord::path("");
+    memstats::fuse(NULL);
   }
 }
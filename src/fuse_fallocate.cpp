@@ -14,9 +14,11 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "epoch.hpp"
 #include "errno.hpp"
 #include "fileinfo.hpp"
 #include "fs_fallocate.hpp"
+#include "moveonenospc_async.hpp"
 
 #include <fuse.h>
 
@@ -45,11 +47,14 @@ namespace FUSE
             off_t                   offset_,
             off_t                   len_)
   {
+    int fd;
+    const epoch::ReadGuard guard;
     FileInfo *fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
-    return l::fallocate(fi->fd,
-                        mode_,
-                        offset_,
-                        len_);
+    fd = moveonenospc::write_fd(fi,offset_,len_);
+    if(fd == -1)
+      return -errno;
+
+    return l::fallocate(fd,mode_,offset_,len_);
   }
 }
@@ -17,6 +17,7 @@
 #include "errno.hpp"
 #include "fileinfo.hpp"
 #include "fs_fchmod.hpp"
+#include "moveonenospc_async.hpp"
 
 #include <fuse.h>
 
@@ -24,12 +25,12 @@ namespace l
 {
   static
   int
-  fchmod(const int    fd_,
-         const mode_t mode_)
+  fchmod(FileInfo     *fi_,
+         const mode_t  mode_)
   {
     int rv;
 
-    rv = fs::fchmod(fd_,mode_);
+    rv = moveonenospc::fchmod(fi_,mode_);
     if(rv == -1)
       return -errno;
 
@@ -45,6 +46,6 @@ namespace FUSE
   {
     FileInfo *fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
-    return l::fchmod(fi->fd,mode_);
+    return l::fchmod(fi,mode_);
   }
 }
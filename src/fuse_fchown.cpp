@@ -17,6 +17,7 @@
 #include "errno.hpp"
 #include "fileinfo.hpp"
 #include "fs_fchown.hpp"
+#include "moveonenospc_async.hpp"
 
 #include <fuse.h>
 
@@ -26,13 +27,13 @@ namespace l
 {
   static
   int
-  fchown(const int   fd_,
-         const uid_t uid_,
-         const gid_t gid_)
+  fchown(FileInfo    *fi_,
+         const uid_t  uid_,
+         const gid_t  gid_)
   {
     int rv;
 
-    rv = fs::fchown(fd_,uid_,gid_);
+    rv = moveonenospc::fchown(fi_,uid_,gid_);
     if(rv == -1)
       return -errno;
 
@@ -49,6 +50,6 @@ namespace FUSE
   {
     FileInfo *fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
-    return l::fchown(fi->fd,uid_,gid_);
+    return l::fchown(fi,uid_,gid_);
   }
 }
@@ -19,6 +19,7 @@
 #include "fileinfo.hpp"
 #include "fs_fstat.hpp"
 #include "fs_inode.hpp"
+#include "moveonenospc_async.hpp"
 
 #include <fuse.h>
 
@@ -26,17 +27,16 @@ namespace l
 {
   static
   int
-  fgetattr(const int          fd_,
-           const std::string &fusepath_,
-           struct stat       *st_)
+  fgetattr(FileInfo    *fi_,
+           struct stat *st_)
   {
     int rv;
 
-    rv = fs::fstat(fd_,st_);
+    rv = moveonenospc::fstat(fi_,st_);
     if(rv == -1)
       return -errno;
 
-    fs::inode::calc(fusepath_,st_);
+    fs::inode::calc(fi_->fusepath,st_);
 
     return 0;
   }
@@ -50,15 +50,15 @@ namespace FUSE
            fuse_timeouts_t        *timeout_)
   {
     int rv;
-    const Config &config = Config::ro();
+    Config::Read cfg;
     FileInfo *fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
-    rv = l::fgetattr(fi->fd,fi->fusepath,st_);
+    rv = l::fgetattr(fi,st_);
 
     timeout_->entry = ((rv >= 0) ?
-                       config.cache_entry :
-                       config.cache_negative_entry);
-    timeout_->attr  = config.cache_attr;
+                       cfg->cache_entry :
+                       cfg->cache_negative_entry);
+    timeout_->attr  = cfg->cache_attr;
 
     return rv;
   }
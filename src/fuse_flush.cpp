@@ -18,6 +18,7 @@
 #include "fileinfo.hpp"
 #include "fs_close.hpp"
 #include "fs_dup.hpp"
+#include "moveonenospc_async.hpp"
 
 #include <fuse.h>
 
@@ -44,8 +45,13 @@ namespace FUSE
   int
   flush(const fuse_file_info_t *ffi_)
   {
+    int fd;
     FileInfo *fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
-    return l::flush(fi->fd);
+    fd = moveonenospc::data_fd(fi);
+    if(fd == -1)
+      return -errno;
+
+    return l::flush(fd);
   }
 }
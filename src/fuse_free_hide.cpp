@@ -18,6 +18,7 @@
 
 #include "fileinfo.hpp"
 #include "fs_close.hpp"
+#include "moveonenospc_async.hpp"
 
 #include <stdint.h>
 
@@ -28,6 +29,7 @@ namespace FUSE
   {
     FileInfo *fi = reinterpret_cast<FileInfo*>(fh_);
 
+    moveonenospc::release(fi);
     fs::close(fi->fd);
 
     delete fi;
@@ -18,6 +18,7 @@
 #include "fileinfo.hpp"
 #include "fs_fdatasync.hpp"
 #include "fs_fsync.hpp"
+#include "moveonenospc_async.hpp"
 
 #include <fuse.h>
 
@@ -47,8 +48,13 @@ namespace FUSE
   fsync(const fuse_file_info_t *ffi_,
         int                     isdatasync_)
   {
+    int fd;
     FileInfo *fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
-    return l::fsync(fi->fd,isdatasync_);
+    fd = moveonenospc::data_fd(fi);
+    if(fd == -1)
+      return -errno;
+
+    return l::fsync(fd,isdatasync_);
   }
 }
@@ -14,9 +14,10 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "epoch.hpp"
 #include "errno.hpp"
 #include "fileinfo.hpp"
-#include "fs_ftruncate.hpp"
+#include "moveonenospc_async.hpp"
 
 #include <fuse.h>
 
@@ -24,12 +25,13 @@ namespace l
 {
   static
   int
-  ftruncate(const int   fd_,
-            const off_t size_)
+  ftruncate(FileInfo    *fi_,
+            const off_t  size_)
   {
     int rv;
+    const epoch::ReadGuard guard;
 
-    rv = fs::ftruncate(fd_,size_);
+    rv = moveonenospc::ftruncate(fi_,size_);
 
     return ((rv == -1) ? -errno : 0);
   }
@@ -43,6 +45,6 @@ namespace FUSE
   {
     FileInfo *fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
-    return l::ftruncate(fi->fd,size_);
+    return l::ftruncate(fi,size_);
   }
 }
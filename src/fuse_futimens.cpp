@@ -17,6 +17,7 @@
 #include "errno.hpp"
 #include "fileinfo.hpp"
 #include "fs_futimens.hpp"
+#include "moveonenospc_async.hpp"
 
 #include <fuse.h>
 
@@ -26,12 +27,12 @@ namespace l
 {
   static
   int
-  futimens(const int             fd_,
-           const struct timespec ts_[2])
+  futimens(FileInfo              *fi_,
+           const struct timespec  ts_[2])
   {
     int rv;
 
-    rv = fs::futimens(fd_,ts_);
+    rv = moveonenospc::futimens(fi_,ts_);
     if(rv == -1)
       return -errno;
 
@@ -47,6 +48,6 @@ namespace FUSE
   {
     FileInfo *fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
-    return l::futimens(fi->fd,ts_);
+    return l::futimens(fi,ts_);
   }
 }
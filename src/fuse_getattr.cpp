@@ -14,11 +14,14 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_inode.hpp"
 #include "fs_lstat.hpp"
 #include "fs_path.hpp"
+#include "moveonenospc_async.hpp"
+#include "opstats.hpp"
 #include "symlinkify.hpp"
 #include "ugid.hpp"
 
@@ -67,6 +70,7 @@ namespace l
           const time_t          symlinkify_timeout_)
   {
     int rv;
+    uint64_t start;
     string fullpath;
     vector<string> basepaths;
 
@@ -76,7 +80,10 @@ namespace l
 
     fullpath = fs::path::make(basepaths[0],fusepath_);
 
+    start = opstats::now();
     rv = fs::lstat(fullpath,st_);
+    branchstats::record(branchstats::index(basepaths[0]),branchstats::OTHER,0,
+                        opstats::now() - start,(rv == -1));
     if(rv == -1)
       return -errno;
 
@@ -97,25 +104,35 @@ namespace FUSE
           fuse_timeouts_t *timeout_)
   {
     int rv;
-    const Config &config = Config::ro();
+    Config::Read cfg;
 
-    if(fusepath_ == config.controlfile)
+    if(fusepath_ == cfg->controlfile)
       return l::getattr_controlfile(st_);
 
+    // a file being migrated is only current on its new branch
+    rv = moveonenospc::stat(fusepath_,st_);
+    if(rv == 0)
+      {
+        fs::inode::calc(fusepath_,st_);
+        timeout_->entry = cfg->cache_entry;
+        timeout_->attr  = cfg->cache_attr;
+        return 0;
+      }
+
     const fuse_context *fc = fuse_get_context();
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    rv = l::getattr(config.func.getattr.policy,
-                    config.branches,
+    rv = l::getattr(cfg->func.getattr.policy,
+                    cfg->branches,
                     fusepath_,
                     st_,
-                    config.symlinkify,
-                    config.symlinkify_timeout);
+                    cfg->symlinkify,
+                    cfg->symlinkify_timeout);
 
     timeout_->entry = ((rv >= 0) ?
-                       config.cache_entry :
-                       config.cache_negative_entry);
-    timeout_->attr  = config.cache_attr;
+                       cfg->cache_entry :
+                       cfg->cache_negative_entry);
+    timeout_->attr  = cfg->cache_attr;
 
     return rv;
   }
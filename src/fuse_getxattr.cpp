@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_findallfiles.hpp"
@@ -189,7 +190,9 @@ namespace l
                                        buf_,
                                        count_);
 
-    return l::lgetxattr(fullpath,attrname_,buf_,count_);
+    const branchstats::Call call(basepaths[0]);
+
+    return call.done(l::lgetxattr(fullpath,attrname_,buf_,count_));
   }
 }
 
@@ -201,26 +204,26 @@ namespace FUSE
            char       *buf_,
            size_t      count_)
   {
-    const Config &config = Config::ro();
+    Config::Read cfg;
 
-    if(fusepath_ == config.controlfile)
-      return l::getxattr_controlfile(config,
+    if(fusepath_ == cfg->controlfile)
+      return l::getxattr_controlfile(*cfg,
                                      attrname_,
                                      buf_,
                                      count_);
 
-    if((config.security_capability == false) &&
+    if((cfg->security_capability == false) &&
        l::is_attrname_security_capability(attrname_))
       return -ENOATTR;
 
-    if(config.xattr.to_int())
-      return -config.xattr.to_int();
+    if(cfg->xattr.to_int())
+      return -cfg->xattr.to_int();
 
     const fuse_context *fc = fuse_get_context();
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::getxattr(config.func.getxattr.policy,
-                       config.branches,
+    return l::getxattr(cfg->func.getxattr.policy,
+                       cfg->branches,
                        fusepath_,
                        attrname_,
                        buf_,
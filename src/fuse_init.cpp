@@ -14,10 +14,22 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "balance.hpp"
+#include "branchstats.hpp"
 #include "config.hpp"
+#include "gidcache.hpp"
+#include "locked_fixed_mem_pool.hpp"
+#include "memstats.hpp"
+#include "oprecord.hpp"
+#include "optrace.hpp"
+#include "slowlog.hpp"
+#include "tiering.hpp"
 #include "ugid.hpp"
 
 #include <fuse.h>
+#include <fuse_lockstat.h>
+
+#include <syslog.h>
 
 namespace l
 {
@@ -83,24 +95,49 @@ namespace FUSE
   void *
   init(fuse_conn_info *conn_)
   {
-    Config &config = Config::rw();
+    Config::Write cfg;
+
+    // credentials=fixup is only safe if the kernel checks ACLs
+    l::want_if_capable(conn_,FUSE_CAP_POSIX_ACL,&cfg->posix_acl);
+    if((cfg->credentials == Credentials::ENUM::FIXUP) && !cfg->posix_acl)
+      {
+        syslog(LOG_WARNING,
+               "kernel lacks POSIX ACL support, credentials=fixup unavailable, using switch");
+        cfg->credentials = Credentials::ENUM::SWITCH;
+      }
 
-    ugid::init();
+    ugid::init(cfg->credentials == Credentials::ENUM::SWITCH);
+    gidcache::ttl(cfg->cache_gid);
+    mempool::max_bytes(cfg->mempool_max);
+    balance::init();
+    tiering::enable(cfg->tiering);
+    tiering::promote(cfg->tiering_promote);
+    tiering::init();
+    branchstats::log_interval(cfg->branches_stats_log);
+    optrace::size(cfg->trace);
+    fuse_lockstat_enable(cfg->locks_profile);
+    memstats::fuse(fuse_get_context()->fuse);
+    memstats::nodes_max(cfg->memory_nodes_max);
+    slowlog::threshold(cfg->trace_slow);
+    slowlog::rate(cfg->trace_slow_rate);
+    oprecord::path(cfg->trace_record);
 
     l::want_if_capable(conn_,FUSE_CAP_ASYNC_DIO);
-    l::want_if_capable(conn_,FUSE_CAP_ASYNC_READ,&config.async_read);
+    l::want_if_capable(conn_,FUSE_CAP_ASYNC_READ,&cfg->async_read);
     l::want_if_capable(conn_,FUSE_CAP_ATOMIC_O_TRUNC);
     l::want_if_capable(conn_,FUSE_CAP_BIG_WRITES);
-    l::want_if_capable(conn_,FUSE_CAP_CACHE_SYMLINKS,&config.cache_symlinks);
+    l::want_if_capable(conn_,FUSE_CAP_CACHE_SYMLINKS,&cfg->cache_symlinks);
     l::want_if_capable(conn_,FUSE_CAP_DONT_MASK);
     l::want_if_capable(conn_,FUSE_CAP_IOCTL_DIR);
     l::want_if_capable(conn_,FUSE_CAP_PARALLEL_DIROPS);
-    l::want_if_capable(conn_,FUSE_CAP_READDIR_PLUS,&config.readdirplus);
+    l::want_if_capable(conn_,FUSE_CAP_READDIR_PLUS,&cfg->readdirplus);
     //l::want_if_capable(conn_,FUSE_CAP_READDIR_PLUS_AUTO);
-    l::want_if_capable(conn_,FUSE_CAP_POSIX_ACL,&config.posix_acl);
-    l::want_if_capable(conn_,FUSE_CAP_WRITEBACK_CACHE,&config.writeback_cache);
-    l::want_if_capable_max_pages(conn_,config);
+    l::want_if_capable(conn_,FUSE_CAP_PASSTHROUGH,&cfg->passthrough);
+    if(cfg->passthrough)
+      cfg->writeback_cache = false;
+    l::want_if_capable(conn_,FUSE_CAP_WRITEBACK_CACHE,&cfg->writeback_cache);
+    l::want_if_capable_max_pages(conn_,*cfg);
 
-    return &config;
+    return &(*cfg);
   }
 }
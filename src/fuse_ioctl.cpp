@@ -21,6 +21,7 @@
 #include "fileinfo.hpp"
 #include "fs_close.hpp"
 #include "fs_findallfiles.hpp"
+#include "fs_fstat.hpp"
 #include "fs_ioctl.hpp"
 #include "fs_open.hpp"
 #include "fs_path.hpp"
@@ -66,6 +67,18 @@ typedef char IOCTL_BUF[4096];
 # define FS_IOC_SETVERSION _IOW('v',2,long)
 #endif
 
+#ifndef FS_IOC_FSGETXATTR
+# define FS_IOC_FSGETXATTR _IOR('X',31,char[28])
+#endif
+
+#ifndef FS_IMMUTABLE_FL
+# define FS_IMMUTABLE_FL 0x00000010
+#endif
+
+#ifndef FS_APPEND_FL
+# define FS_APPEND_FL 0x00000020
+#endif
+
 /*
   There is a bug with FUSE and these ioctl commands. The regular
   libfuse high level API assumes the output buffer size based on the
@@ -87,6 +100,63 @@ typedef char IOCTL_BUF[4096];
 
 namespace l
 {
+  /*
+    Without credential switching the ioctl is issued as root so
+    whatever checks the branch filesystem would have made against the
+    requester are skipped. Only commands whose checks are known, and
+    made here, are allowed for non-root callers: reading flags,
+    version and fsxattr, and for the owner setting flags other than
+    immutable and append only (which require CAP_LINUX_IMMUTABLE) and
+    the version.
+  */
+  static
+  int
+  ioctl_permitted(const int       fd_,
+                  const uint32_t  cmd_,
+                  const void     *data_)
+  {
+    int rv;
+    int flags;
+    struct stat st;
+    const fuse_context *fc;
+
+    if(ugid::switching)
+      return 0;
+
+    fc = fuse_get_context();
+    if(fc->uid == 0)
+      return 0;
+
+    switch(cmd_)
+      {
+      case FS_IOC_GETFLAGS:
+      case FS_IOC_GETVERSION:
+      case FS_IOC_FSGETXATTR:
+        return 0;
+      case FS_IOC_SETFLAGS:
+      case FS_IOC_SETVERSION:
+        break;
+      default:
+        return -ENOTTY;
+      }
+
+    rv = fs::fstat(fd_,&st);
+    if(rv == -1)
+      return -errno;
+    if(st.st_uid != fc->uid)
+      return -EPERM;
+    if(cmd_ == FS_IOC_SETVERSION)
+      return 0;
+
+    rv = fs::ioctl(fd_,FS_IOC_GETFLAGS,&flags);
+    if(rv == -1)
+      return -errno;
+    if((flags ^ *(const int*)data_) & (FS_IMMUTABLE_FL|FS_APPEND_FL))
+      return -EPERM;
+
+    return 0;
+  }
+
   static
   int
   ioctl(const int       fd_,
@@ -109,6 +179,10 @@ namespace l
         break;
       }
 
+    rv = l::ioctl_permitted(fd_,cmd_,data_);
+    if(rv < 0)
+      return rv;
+
     rv = fs::ioctl(fd_,cmd_,data_);
 
     return ((rv == -1) ? -errno : rv);
@@ -172,11 +246,11 @@ namespace l
   {
     DirInfo            *di     = reinterpret_cast<DirInfo*>(ffi_->fh);
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::ioctl_dir_base(config.func.open.policy,
-                             config.branches,
+    return l::ioctl_dir_base(cfg->func.open.policy,
+                             cfg->branches,
                              di->fusepath.c_str(),
                              cmd_,
                              data_,
@@ -204,9 +278,9 @@ namespace l
   read_keys(void *data_)
   {
     std::string   keys;
-    const Config &config = Config::ro();
+    Config::Read  cfg;
 
-    config.keys(keys);
+    cfg->keys(keys);
 
     return l::strcpy(keys,data_);
   }
@@ -219,13 +293,13 @@ namespace l
     char *data;
     std::string key;
     std::string val;
-    const Config &config = Config::ro();
+    Config::Read cfg;
 
     data = (char*)data_;
     data[sizeof(IOCTL_BUF) - 1] = '\0';
 
     key = data;
-    rv = config.get(key,&val);
+    rv = cfg->get(key,&val);
     if(rv < 0)
       return rv;
 
@@ -240,7 +314,7 @@ namespace l
     std::string kv;
     std::string key;
     std::string val;
-    Config &config = Config::rw();
+    Config::Write cfg;
 
     data = (char*)data_;
     data[sizeof(IOCTL_BUF) - 1] = '\0';
@@ -248,7 +322,7 @@ namespace l
     kv = data;
     str::splitkv(kv,'=',&key,&val);
 
-    return config.set(key,val);
+    return cfg->set(key,val);
   }
 
   static
@@ -273,11 +347,11 @@ namespace l
   file_basepath(const fuse_file_info_t *ffi_,
                 void                   *data_)
   {
-    const Config &config   = Config::ro();
+    Config::Read cfg;
     std::string  &fusepath = reinterpret_cast<FH*>(ffi_->fh)->fusepath;
 
-    return l::file_basepath(config.func.open.policy,
-                            config.branches,
+    return l::file_basepath(cfg->func.open.policy,
+                            cfg->branches,
                             fusepath.c_str(),
                             data_);
   }
@@ -317,11 +391,11 @@ namespace l
   file_fullpath(const fuse_file_info_t *ffi_,
                 void                   *data_)
   {
-    const Config &config   = Config::ro();
+    Config::Read cfg;
     std::string  &fusepath = reinterpret_cast<FH*>(ffi_->fh)->fusepath;
 
-    return l::file_fullpath(config.func.open.policy,
-                            config.branches,
+    return l::file_fullpath(cfg->func.open.policy,
+                            cfg->branches,
                             fusepath,
                             data_);
   }
@@ -335,9 +409,9 @@ namespace l
     vector<string> paths;
     vector<string> branches;
     string &fusepath = reinterpret_cast<FH*>(ffi_->fh)->fusepath;
-    const Config &config = Config::ro();
+    Config::Read cfg;
 
-    config.branches.to_paths(branches);
+    cfg->branches.to_paths(branches);
 
     fs::findallfiles(branches,fusepath.c_str(),&paths);
 
@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_clonepath.hpp"
@@ -51,6 +52,17 @@ namespace error
 
 namespace l
 {
+  static
+  int
+  link_counted(const string &basepath_,
+               const string &oldfullpath_,
+               const string &newfullpath_)
+  {
+    const branchstats::Call call(basepath_);
+
+    return call.done(fs::link(oldfullpath_,newfullpath_));
+  }
+
   static
   int
   link_create_path_core(const string &oldbasepath_,
@@ -66,7 +78,7 @@ namespace l
     oldfullpath = fs::path::make(oldbasepath_,oldfusepath_);
     newfullpath = fs::path::make(oldbasepath_,newfusepath_);
 
-    rv = fs::link(oldfullpath,newfullpath);
+    rv = l::link_counted(oldbasepath_,oldfullpath,newfullpath);
 
     return error::calc(rv,error_,errno);
   }
@@ -171,7 +183,7 @@ namespace l
     oldfullpath = fs::path::make(oldbasepath_,oldfusepath_);
     newfullpath = fs::path::make(oldbasepath_,newfusepath_);
 
-    rv = fs::link(oldfullpath,newfullpath);
+    rv = l::link_counted(oldbasepath_,oldfullpath,newfullpath);
     if((rv == -1) && (errno == ENOENT))
       {
         rv = l::clonepath_if_would_create(searchFunc_,createFunc_,
@@ -179,7 +191,7 @@ namespace l
                                           oldbasepath_,
                                           oldfusepath_,newfusepath_);
         if(rv != -1)
-          rv = fs::link(oldfullpath,newfullpath);
+          rv = l::link_counted(oldbasepath_,oldfullpath,newfullpath);
       }
 
     return error::calc(rv,error_,errno);
@@ -239,20 +251,20 @@ namespace FUSE
        const char *to_)
   {
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    if(config.func.create.policy->path_preserving() && !config.ignorepponrename)
-      return l::link_preserve_path(config.func.getattr.policy,
-                                   config.func.link.policy,
-                                   config.func.create.policy,
-                                   config.branches,
+    if(cfg->func.create.policy->path_preserving() && !cfg->ignorepponrename)
+      return l::link_preserve_path(cfg->func.getattr.policy,
+                                   cfg->func.link.policy,
+                                   cfg->func.create.policy,
+                                   cfg->branches,
                                    from_,
                                    to_);
 
-    return l::link_create_path(config.func.link.policy,
-                               config.func.create.policy,
-                               config.branches,
+    return l::link_create_path(cfg->func.link.policy,
+                               cfg->func.create.policy,
+                               cfg->branches,
                                from_,
                                to_);
   }
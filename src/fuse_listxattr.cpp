@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "buildvector.hpp"
 #include "category.hpp"
 #include "config.hpp"
@@ -73,7 +74,8 @@ namespace l
 
     fullpath = fs::path::make(basepaths[0],fusepath_);
 
-    rv = fs::llistxattr(fullpath,list_,size_);
+    const branchstats::Call call(basepaths[0]);
+    rv = call.done(fs::llistxattr(fullpath,list_,size_));
 
     return ((rv == -1) ? -errno : rv);
   }
@@ -86,12 +88,12 @@ namespace FUSE
             char       *list_,
             size_t      size_)
   {
-    const Config &config = Config::ro();
+    Config::Read cfg;
 
-    if(fusepath_ == config.controlfile)
-      return l::listxattr_controlfile(config,list_,size_);
+    if(fusepath_ == cfg->controlfile)
+      return l::listxattr_controlfile(*cfg,list_,size_);
 
-    switch(config.xattr)
+    switch(cfg->xattr)
       {
       case XAttr::ENUM::PASSTHROUGH:
         break;
@@ -104,8 +106,8 @@ namespace FUSE
     const fuse_context *fc = fuse_get_context();
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::listxattr(config.func.listxattr.policy,
-                        config.branches,
+    return l::listxattr(cfg->func.listxattr.policy,
+                        cfg->branches,
                         fusepath_,
                         list_,
                         size_);
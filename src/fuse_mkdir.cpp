@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_acl.hpp"
@@ -58,10 +59,16 @@ namespace l
              mode_t        mode_,
              const mode_t  umask_)
   {
+    int rv;
+
     if(!fs::acl::dir_has_defaults(fullpath_))
       mode_ &= ~umask_;
 
-    return fs::mkdir(fullpath_,mode_);
+    rv = fs::mkdir(fullpath_,mode_);
+    if(rv == 0)
+      ugid::chown_created(fullpath_,S_IFDIR);
+
+    return rv;
   }
 
   static
@@ -74,10 +81,11 @@ namespace l
   {
     int rv;
     string fullpath;
+    const branchstats::Call call(createpath_);
 
     fullpath = fs::path::make(createpath_,fusepath_);
 
-    rv = l::mkdir_core(fullpath,mode_,umask_);
+    rv = call.done(l::mkdir_core(fullpath,mode_,umask_));
 
     return error::calc(rv,error_,errno);
   }
@@ -151,12 +159,12 @@ namespace FUSE
         mode_t      mode_)
   {
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::mkdir(config.func.getattr.policy,
-                    config.func.mkdir.policy,
-                    config.branches,
+    return l::mkdir(cfg->func.getattr.policy,
+                    cfg->func.mkdir.policy,
+                    cfg->branches,
                     fusepath_,
                     mode_,
                     fc->umask);
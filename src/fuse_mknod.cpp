@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_acl.hpp"
@@ -60,10 +61,16 @@ namespace l
              const mode_t  umask_,
              const dev_t   dev_)
   {
+    int rv;
+
     if(!fs::acl::dir_has_defaults(fullpath_))
       mode_ &= ~umask_;
 
-    return fs::mknod(fullpath_,mode_,dev_);
+    rv = fs::mknod(fullpath_,mode_,dev_);
+    if(rv == 0)
+      ugid::chown_created(fullpath_,mode_);
+
+    return rv;
   }
 
   static
@@ -77,10 +84,11 @@ namespace l
   {
     int rv;
     string fullpath;
+    const branchstats::Call call(createpath_);
 
     fullpath = fs::path::make(createpath_,fusepath_);
 
-    rv = l::mknod_core(fullpath,mode_,umask_,dev_);
+    rv = call.done(l::mknod_core(fullpath,mode_,umask_,dev_));
 
     return error::calc(rv,error_,errno);
   }
@@ -152,12 +160,12 @@ namespace FUSE
         dev_t       rdev_)
   {
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::mknod(config.func.getattr.policy,
-                    config.func.mknod.policy,
-                    config.branches,
+    return l::mknod(cfg->func.getattr.policy,
+                    cfg->func.mknod.policy,
+                    cfg->branches,
                     fusepath_,
                     mode_,
                     fc->umask,
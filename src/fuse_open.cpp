@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fileinfo.hpp"
@@ -23,8 +24,11 @@
 #include "fs_open.hpp"
 #include "fs_path.hpp"
 #include "fs_stat.hpp"
+#include "opstats.hpp"
+#include "passthrough.hpp"
 #include "policy_cache.hpp"
 #include "stat_util.hpp"
+#include "tiering.hpp"
 #include "ugid.hpp"
 
 #include "fuse.h"
@@ -160,29 +164,43 @@ namespace l
             uint64_t          *fh_)
   {
     int fd;
+    int branch;
+    uint64_t start;
     string fullpath;
+    FileInfo *fi;
 
     fullpath = fs::path::make(basepath_,fusepath_);
 
     if(link_cow_ && fs::cow::is_eligible(fullpath.c_str(),flags_))
       fs::cow::break_link(fullpath.c_str());
 
+    branch = branchstats::index(basepath_);
+    start  = opstats::now();
     fd = fs::open(fullpath,flags_);
     if((fd == -1) && (errno == EACCES))
       fd = l::nfsopenhack(fullpath,flags_,nfsopenhack_);
+    branchstats::record(branch,branchstats::OTHER,0,
+                        opstats::now() - start,(fd == -1));
     if(fd == -1)
       return -errno;
 
-    *fh_ = reinterpret_cast<uint64_t>(new FileInfo(fd,fusepath_));
+    fi = new FileInfo(fd,fusepath_);
+    fi->branch = branch;
+
+    *fh_ = reinterpret_cast<uint64_t>(fi);
 
     return 0;
   }
 
+  /*
+    With tiering a copy on the fastest tier is preferred.
+  */
   static
   int
   open(Policy::Func::Search  searchFunc_,
        PolicyCache          &cache,
        const Branches       &branches_,
+       const bool            tiering_,
        const char           *fusepath_,
        const int             flags_,
        const bool            link_cow_,
@@ -192,7 +210,11 @@ namespace l
     int rv;
     string basepath;
 
-    rv = cache(searchFunc_,branches_,fusepath_,&basepath);
+    rv = -1;
+    if(tiering_)
+      rv = cache(searchFunc_,branches_.fast(),fusepath_,&basepath);
+    if(rv == -1)
+      rv = cache(searchFunc_,branches_,fusepath_,&basepath);
     if(rv == -1)
       return -errno;
 
@@ -206,22 +228,30 @@ namespace FUSE
   open(const char       *fusepath_,
        fuse_file_info_t *ffi_)
   {
+    int rv;
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    l::config_to_ffi_flags(config,ffi_);
+    l::config_to_ffi_flags(*cfg,ffi_);
 
-    if(config.writeback_cache)
+    if(cfg->writeback_cache)
       l::tweak_flags_writeback_cache(&ffi_->flags);
 
-    return l::open(config.func.open.policy,
-                   config.open_cache,
-                   config.branches,
-                   fusepath_,
-                   ffi_->flags,
-                   config.link_cow,
-                   config.nfsopenhack,
-                   &ffi_->fh);
+    rv = l::open(cfg->func.open.policy,
+                 cfg->open_cache,
+                 cfg->branches,
+                 cfg->tiering,
+                 fusepath_,
+                 ffi_->flags,
+                 cfg->link_cow,
+                 cfg->nfsopenhack,
+                 &ffi_->fh);
+    if((rv == 0) && cfg->passthrough)
+      passthrough::open(reinterpret_cast<FileInfo*>(ffi_->fh),ffi_);
+    if(rv == 0)
+      tiering::access(reinterpret_cast<FileInfo*>(ffi_->fh)->fusepath);
+
+    return rv;
   }
 }
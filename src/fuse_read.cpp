@@ -14,9 +14,12 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "errno.hpp"
 #include "fileinfo.hpp"
 #include "fs_read.hpp"
+#include "moveonenospc_async.hpp"
+#include "opstats.hpp"
 
 #include <fuse.h>
 
@@ -41,6 +44,25 @@ namespace l
     return count_;
   }
 
+  static
+  int
+  read_migrating(FileInfo     *fi_,
+                 char         *buf_,
+                 const size_t  count_,
+                 const off_t   offset_,
+                 const bool    direct_io_)
+  {
+    int rv;
+
+    rv = moveonenospc::read(fi_,buf_,count_,offset_);
+    if(rv == -1)
+      return -errno;
+    if((rv == 0) || direct_io_)
+      return rv;
+
+    return count_;
+  }
+
   static
   inline
   int
@@ -67,13 +89,24 @@ namespace FUSE
        size_t                  count_,
        off_t                   offset_)
   {
+    int rv;
+    uint64_t start;
     FileInfo *fi;
 
     fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
+    if(moveonenospc::active(fi))
+      return l::read_migrating(fi,buf_,count_,offset_,ffi_->direct_io);
+
+    start = opstats::now();
     if(ffi_->direct_io)
-      return l::read_direct_io(fi->fd,buf_,count_,offset_);
-    return l::read_regular(fi->fd,buf_,count_,offset_);
+      rv = l::read_direct_io(fi->fd,buf_,count_,offset_);
+    else
+      rv = l::read_regular(fi->fd,buf_,count_,offset_);
+    branchstats::record(fi->branch,branchstats::READ,((rv > 0) ? rv : 0),
+                        opstats::now() - start,(rv < 0));
+
+    return rv;
   }
 
   int
@@ -14,8 +14,10 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "errno.hpp"
 #include "fileinfo.hpp"
+#include "moveonenospc_async.hpp"
 
 #include <fuse.h>
 
@@ -26,6 +28,10 @@ typedef struct fuse_bufvec fuse_bufvec;
 
 namespace l
 {
+  /*
+    libfuse hands us a preallocated, per thread bufvec in *bufp_ so
+    there is nothing to allocate here.
+  */
   static
   int
   read_buf(const int      fd_,
@@ -35,9 +41,7 @@ namespace l
   {
     fuse_bufvec *src;
 
-    src = (fuse_bufvec*)malloc(sizeof(fuse_bufvec));
-    if(src == NULL)
-      return -ENOMEM;
+    src = *bufp_;
 
     *src = FUSE_BUFVEC_INIT(size_);
 
@@ -45,7 +49,42 @@ namespace l
     src->buf->fd    = fd_;
     src->buf->pos   = offset_;
 
-    *bufp_ = src;
+    return 0;
+  }
+
+  /*
+    While a file is being migrated its data is spread over two files
+    so it is read into memory. libfuse frees any buffer which isn't
+    its own.
+  */
+  static
+  int
+  read_buf_migrating(FileInfo      *fi_,
+                     fuse_bufvec  **bufp_,
+                     const size_t   size_,
+                     const off_t    offset_)
+  {
+    int rv;
+    void *mem;
+    fuse_bufvec *src;
+
+    mem = malloc(size_);
+    if(mem == NULL)
+      return -ENOMEM;
+
+    rv = moveonenospc::read(fi_,(char*)mem,size_,offset_);
+    if(rv == -1)
+      {
+        rv = -errno;
+        free(mem);
+        return rv;
+      }
+
+    src = *bufp_;
+
+    *src = FUSE_BUFVEC_INIT((size_t)rv);
+
+    src->buf->mem = mem;
 
     return 0;
   }
@@ -61,6 +100,12 @@ namespace FUSE
   {
     FileInfo *fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
+    if(moveonenospc::active(fi))
+      return l::read_buf_migrating(fi,bufp_,size_,offset_);
+
+    // libfuse does the read itself so only the size asked for is known
+    branchstats::bytes(fi->branch,branchstats::READ,size_);
+
     return l::read_buf(fi->fd,
                      bufp_,
                      size_,
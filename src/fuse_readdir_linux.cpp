@@ -15,6 +15,7 @@
 */
 
 #include "branch.hpp"
+#include "branchstats.hpp"
 #include "errno.hpp"
 #include "fs_close.hpp"
 #include "fs_devid.hpp"
@@ -26,7 +27,6 @@
 #include "hashset.hpp"
 #include "linux_dirent64.h"
 #include "mempools.hpp"
-#include "rwlock.hpp"
 
 #include <fuse.h>
 #include <fuse_dirents.h>
@@ -74,10 +74,11 @@ namespace l
       {
         int dirfd;
         int64_t nread;
+        const branchstats::Call call(branches_[i].path);
 
         basepath = fs::path::make(branches_[i].path,dirname_);
 
-        dirfd = fs::open_dir_ro(basepath);
+        dirfd = call.done(fs::open_dir_ro(basepath));
         if(dirfd == -1)
           continue;
 
@@ -115,6 +116,7 @@ namespace l
               }
           }
 
+        call.done(nread);
         fs::close(dirfd);
       }
 
@@ -129,9 +131,9 @@ namespace l
           const char     *dirname_,
           fuse_dirents_t *buf_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return l::readdir(branches_.vec,dirname_,buf_);
+    return l::readdir(branches.vec,dirname_,buf_);
   }
 }
 
@@ -34,23 +34,23 @@ namespace FUSE
   {
     DirInfo            *di     = reinterpret_cast<DirInfo*>(ffi_->fh);
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    switch(config.readdir)
+    switch(cfg->readdir)
       {
       case ReadDir::ENUM::LINUX:
-        return FUSE::readdir_plus_linux(config.branches,
+        return FUSE::readdir_plus_linux(cfg->branches,
                                         di->fusepath.c_str(),
-                                        config.cache_entry,
-                                        config.cache_attr,
+                                        cfg->cache_entry,
+                                        cfg->cache_attr,
                                         buf_);
       default:
       case ReadDir::ENUM::POSIX:
-        return FUSE::readdir_plus_posix(config.branches,
+        return FUSE::readdir_plus_posix(cfg->branches,
                                         di->fusepath.c_str(),
-                                        config.cache_entry,
-                                        config.cache_attr,
+                                        cfg->cache_entry,
+                                        cfg->cache_attr,
                                         buf_);
       }
   }
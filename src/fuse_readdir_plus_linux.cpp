@@ -15,6 +15,7 @@
 */
 
 #include "branch.hpp"
+#include "branchstats.hpp"
 #include "errno.hpp"
 #include "fs_close.hpp"
 #include "fs_devid.hpp"
@@ -82,10 +83,11 @@ namespace l
       {
         int dirfd;
         int64_t nread;
+        const branchstats::Call call(branches_[i].path);
 
         basepath = fs::path::make(branches_[i].path,dirname_);
 
-        dirfd = fs::open_dir_ro(basepath);
+        dirfd = call.done(fs::open_dir_ro(basepath));
         if(dirfd == -1)
           continue;
 
@@ -129,6 +131,7 @@ namespace l
               }
           }
 
+        call.done(nread);
         fs::close(dirfd);
       }
 
@@ -145,9 +148,9 @@ namespace l
                const uint64_t  attr_timeout_,
                fuse_dirents_t *buf_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return l::readdir_plus(branches_.vec,dirname_,entry_timeout_,attr_timeout_,buf_);
+    return l::readdir_plus(branches.vec,dirname_,entry_timeout_,attr_timeout_,buf_);
   }
 }
 
@@ -17,6 +17,7 @@
 #define _DEFAULT_SOURCE
 
 #include "branch.hpp"
+#include "branchstats.hpp"
 #include "errno.hpp"
 #include "fs_closedir.hpp"
 #include "fs_devid.hpp"
@@ -28,7 +29,6 @@
 #include "fs_readdir.hpp"
 #include "fs_stat.hpp"
 #include "hashset.hpp"
-#include "rwlock.hpp"
 
 #include <fuse.h>
 #include <fuse_dirents.h>
@@ -83,12 +83,16 @@ namespace l
         int rv;
         int dirfd;
         DIR *dh;
+        const branchstats::Call call(branches_[i].path);
 
         basepath = fs::path::make(branches_[i].path,dirname_);
 
         dh = fs::opendir(basepath);
         if(!dh)
-          continue;
+          {
+            call.done(-1);
+            continue;
+          }
 
         dirfd = fs::dirfd(dh);
         dev   = fs::devid(dirfd);
@@ -122,6 +126,7 @@ namespace l
               return (fs::closedir(dh),-ENOMEM);
           }
 
+        call.done(0);
         fs::closedir(dh);
       }
 
@@ -136,9 +141,9 @@ namespace l
                const uint64_t  attr_timeout_,
                fuse_dirents_t *buf_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return l::readdir_plus(branches_.vec,
+    return l::readdir_plus(branches.vec,
                            dirname_,
                            entry_timeout_,
                            attr_timeout_,
@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_lstat.hpp"
@@ -81,13 +82,14 @@ namespace l
                 const time_t  symlinkify_timeout_)
   {
     string fullpath;
+    const branchstats::Call call(basepath_);
 
     fullpath = fs::path::make(basepath_,fusepath_);
 
     if(symlinkify_)
-      return l::readlink_core_symlinkify(fullpath,buf_,size_,symlinkify_timeout_);
+      return call.done(l::readlink_core_symlinkify(fullpath,buf_,size_,symlinkify_timeout_));
 
-    return l::readlink_core_standard(fullpath,buf_,size_);
+    return call.done(l::readlink_core_standard(fullpath,buf_,size_));
   }
 
   static
@@ -120,15 +122,15 @@ namespace FUSE
            size_t      size_)
   {
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::readlink(config.func.readlink.policy,
-                       config.branches,
+    return l::readlink(cfg->func.readlink.policy,
+                       cfg->branches,
                        fusepath_,
                        buf_,
                        size_,
-                       config.symlinkify,
-                       config.symlinkify_timeout);
+                       cfg->symlinkify,
+                       cfg->symlinkify_timeout);
   }
 }
@@ -19,6 +19,8 @@
 #include "fileinfo.hpp"
 #include "fs_close.hpp"
 #include "fs_fadvise.hpp"
+#include "moveonenospc_async.hpp"
+#include "passthrough.hpp"
 
 #include <fuse.h>
 
@@ -39,6 +41,9 @@ namespace l
         fs::fadvise_dontneed(fi_->fd);
       }
 
+    passthrough::release(fi_);
+    moveonenospc::release(fi_);
+
     fs::close(fi_->fd);
 
     delete fi_;
@@ -52,12 +57,12 @@ namespace FUSE
   int
   release(const fuse_file_info_t *ffi_)
   {
-    const Config &config = Config::ro();
+    Config::Read cfg;
     FileInfo *fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
-    if(config.open_cache.timeout)
-      config.open_cache.cleanup(10);
+    if(cfg->open_cache.timeout)
+      cfg->open_cache.cleanup(10);
 
-    return l::release(fi,config.dropcacheonclose);
+    return l::release(fi,cfg->dropcacheonclose);
   }
 }
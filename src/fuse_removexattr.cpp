@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_lremovexattr.hpp"
@@ -60,11 +61,12 @@ namespace l
                         PolicyRV     *prv_)
   {
     string fullpath;
+    const branchstats::Call call(basepath_);
 
     fullpath = fs::path::make(basepath_,fusepath_);
 
     errno = 0;
-    fs::lremovexattr(fullpath,attrname_);
+    call.done(fs::lremovexattr(fullpath,attrname_));
 
     prv_->insert(errno,basepath_);
   }
@@ -119,19 +121,19 @@ namespace FUSE
   removexattr(const char *fusepath_,
               const char *attrname_)
   {
-    const Config &config = Config::ro();
+    Config::Read cfg;
 
-    if(fusepath_ == config.controlfile)
+    if(fusepath_ == cfg->controlfile)
       return -ENOATTR;
-    if(config.xattr.to_int())
-      return -config.xattr.to_int();
+    if(cfg->xattr.to_int())
+      return -cfg->xattr.to_int();
 
     const fuse_context *fc = fuse_get_context();
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::removexattr(config.func.removexattr.policy,
-                          config.func.getxattr.policy,
-                          config.branches,
+    return l::removexattr(cfg->func.removexattr.policy,
+                          cfg->func.getxattr.policy,
+                          cfg->branches,
                           fusepath_,
                           attrname_);
   }
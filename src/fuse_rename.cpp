@@ -14,12 +14,14 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_clonepath.hpp"
 #include "fs_path.hpp"
 #include "fs_remove.hpp"
 #include "fs_rename.hpp"
+#include "moveonenospc_async.hpp"
 #include "ugid.hpp"
 
 #include <algorithm>
@@ -72,6 +74,17 @@ _remove(const vector<string> &toremove)
     fs::remove(toremove[i]);
 }
 
+static
+int
+_rename_counted(const string &basepath,
+                const string &oldfullpath,
+                const string &newfullpath)
+{
+  const branchstats::Call call(basepath);
+
+  return call.done(fs::rename(oldfullpath,newfullpath));
+}
+
 static
 void
 _rename_create_path_core(const vector<string> &oldbasepaths,
@@ -97,7 +110,7 @@ _rename_create_path_core(const vector<string> &oldbasepaths,
           oldfullpath = fs::path::make(oldbasepath,oldfusepath);
           newfullpath = fs::path::make(oldbasepath,newfusepath);
 
-          rv = fs::rename(oldfullpath,newfullpath);
+          rv = _rename_counted(oldbasepath,oldfullpath,newfullpath);
         }
 
       error = error::calc(rv,error,errno);
@@ -228,14 +241,14 @@ _rename_preserve_path_core(Policy::Func::Search  searchFunc,
 
       oldfullpath = fs::path::make(oldbasepath,oldfusepath);
 
-      rv = fs::rename(oldfullpath,newfullpath);
+      rv = _rename_counted(oldbasepath,oldfullpath,newfullpath);
       if((rv == -1) && (errno == ENOENT))
         {
           rv = _clonepath_if_would_create(searchFunc,createFunc,
                                           branches_,oldbasepath,
                                           oldfusepath,newfusepath);
           if(rv == 0)
-            rv = fs::rename(oldfullpath,newfullpath);
+            rv = _rename_counted(oldbasepath,oldfullpath,newfullpath);
         }
 
       error = error::calc(rv,error,errno);
@@ -294,22 +307,26 @@ namespace FUSE
          const char *newpath)
   {
     const fuse_context *fc     = fuse_get_context();
-    Config             &config = Config::rw();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    config.open_cache.erase(oldpath);
+    // the migration would otherwise finish at the old path
+    if(moveonenospc::busy(oldpath) || moveonenospc::busy(newpath))
+      return -EBUSY;
+
+    cfg->open_cache.erase(oldpath);
 
-    if(config.func.create.policy->path_preserving() && !config.ignorepponrename)
-      return _rename_preserve_path(config.func.getattr.policy,
-                                   config.func.rename.policy,
-                                   config.func.create.policy,
-                                   config.branches,
+    if(cfg->func.create.policy->path_preserving() && !cfg->ignorepponrename)
+      return _rename_preserve_path(cfg->func.getattr.policy,
+                                   cfg->func.rename.policy,
+                                   cfg->func.create.policy,
+                                   cfg->branches,
                                    oldpath,
                                    newpath);
 
-    return _rename_create_path(config.func.getattr.policy,
-                               config.func.rename.policy,
-                               config.branches,
+    return _rename_create_path(cfg->func.getattr.policy,
+                               cfg->func.rename.policy,
+                               cfg->branches,
                                oldpath,
                                newpath);
   }
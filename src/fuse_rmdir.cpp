@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_rmdir.hpp"
@@ -56,10 +57,11 @@ namespace l
   {
     int rv;
     string fullpath;
+    const branchstats::Call call(basepath_);
 
     fullpath = fs::path::make(basepath_,fusepath_);
 
-    rv = fs::rmdir(fullpath);
+    rv = call.done(fs::rmdir(fullpath));
 
     return error::calc(rv,error_,errno);
   }
@@ -103,11 +105,11 @@ namespace FUSE
   rmdir(const char *fusepath_)
   {
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::rmdir(config.func.rmdir.policy,
-                    config.branches,
+    return l::rmdir(cfg->func.rmdir.policy,
+                    cfg->branches,
                     fusepath_);
   }
 }
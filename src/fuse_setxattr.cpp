@@ -14,18 +14,27 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_glob.hpp"
 #include "fs_lsetxattr.hpp"
 #include "fs_path.hpp"
 #include "fs_statvfs_cache.hpp"
+#include "gidcache.hpp"
+#include "locked_fixed_mem_pool.hpp"
+#include "memstats.hpp"
 #include "num.hpp"
+#include "oprecord.hpp"
+#include "optrace.hpp"
 #include "policy_rv.hpp"
+#include "slowlog.hpp"
 #include "str.hpp"
+#include "tiering.hpp"
 #include "ugid.hpp"
 
 #include <fuse.h>
+#include <fuse_lockstat.h>
 
 #include <string>
 #include <vector>
@@ -94,8 +103,18 @@ namespace l
 
     config_.open_cache.clear();
     fs::statvfs_cache_timeout(config_.cache_statfs);
-
-    return rv;
+    gidcache::ttl(config_.cache_gid);
+    mempool::max_bytes(config_.mempool_max);
+    tiering::enable(config_.tiering);
+    tiering::promote(config_.tiering_promote);
+    branchstats::log_interval(config_.branches_stats_log);
+    optrace::size(config_.trace);
+    fuse_lockstat_enable(config_.locks_profile);
+    memstats::nodes_max(config_.memory_nodes_max);
+    slowlog::threshold(config_.trace_slow);
+    slowlog::rate(config_.trace_slow_rate);
+
+    return oprecord::path(config_.trace_record);
   }
 
   static
@@ -109,11 +128,12 @@ namespace l
                      PolicyRV     *prv_)
   {
     string fullpath;
+    const branchstats::Call call(basepath_);
 
     fullpath = fs::path::make(basepath_,fusepath_);
 
     errno = 0;
-    fs::lsetxattr(fullpath,attrname_,attrval_,attrvalsize_,flags_);
+    call.done(fs::lsetxattr(fullpath,attrname_,attrval_,attrvalsize_,flags_));
 
     prv_->insert(errno,basepath_);
   }
@@ -179,27 +199,29 @@ namespace FUSE
            size_t      attrvalsize_,
            int         flags_)
   {
-    Config &config = Config::rw();
-
-    if(fusepath_ == config.controlfile)
-      return l::setxattr_controlfile(config,
+    // a Write publishes a new snapshot on release so must not be
+    // taken while holding a Read
+    if(fusepath_ == Config::Read()->controlfile)
+      return l::setxattr_controlfile(*Config::Write(),
                                      attrname_,
                                      string(attrval_,attrvalsize_),
                                      flags_);
 
-    if((config.security_capability == false) &&
+    Config::Read cfg;
+
+    if((cfg->security_capability == false) &&
        l::is_attrname_security_capability(attrname_))
       return -ENOATTR;
 
-    if(config.xattr.to_int())
-      return -config.xattr.to_int();
+    if(cfg->xattr.to_int())
+      return -cfg->xattr.to_int();
 
     const fuse_context *fc = fuse_get_context();
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::setxattr(config.func.setxattr.policy,
-                       config.func.getxattr.policy,
-                       config.branches,
+    return l::setxattr(cfg->func.setxattr.policy,
+                       cfg->func.getxattr.policy,
+                       cfg->branches,
                        fusepath_,
                        attrname_,
                        attrval_,
@@ -14,12 +14,12 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_lstat.hpp"
 #include "fs_path.hpp"
 #include "fs_statvfs.hpp"
-#include "rwlock.hpp"
 #include "statvfs_util.hpp"
 #include "ugid.hpp"
 
@@ -85,7 +85,7 @@ namespace l
          const StatFSIgnore  ignore_,
          struct statvfs     *fsstat_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
     int rv;
     string fullpath;
@@ -99,18 +99,18 @@ namespace l
     min_bsize   = std::numeric_limits<unsigned long>::max();
     min_frsize  = std::numeric_limits<unsigned long>::max();
     min_namemax = std::numeric_limits<unsigned long>::max();
-    for(size_t i = 0, ei = branches_.vec.size(); i < ei; i++)
+    for(size_t i = 0, ei = branches.vec.size(); i < ei; i++)
       {
+        const branchstats::Call call(branches.vec[i].path);
+
         fullpath = ((mode_ == StatFS::ENUM::FULL) ?
-                    fs::path::make(branches_.vec[i].path,fusepath_) :
-                    branches_.vec[i].path);
+                    fs::path::make(branches.vec[i].path,fusepath_) :
+                    branches.vec[i].path);
 
         rv = fs::lstat(fullpath,&st);
-        if(rv == -1)
-          continue;
-
-        rv = fs::lstatvfs(fullpath,&stvfs);
-        if(rv == -1)
+        if(rv != -1)
+          rv = fs::lstatvfs(fullpath,&stvfs);
+        if(call.done(rv) == -1)
           continue;
 
         if(stvfs.f_bsize   && (min_bsize   > stvfs.f_bsize))
@@ -120,7 +120,7 @@ namespace l
         if(stvfs.f_namemax && (min_namemax > stvfs.f_namemax))
           min_namemax = stvfs.f_namemax;
 
-        if(l::should_ignore(ignore_,&branches_.vec[i],StatVFS::readonly(stvfs)))
+        if(l::should_ignore(ignore_,&branches.vec[i],StatVFS::readonly(stvfs)))
           {
             stvfs.f_bavail = 0;
             stvfs.f_favail = 0;
@@ -154,13 +154,13 @@ namespace FUSE
          struct statvfs *st_)
   {
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::statfs(config.branches,
+    return l::statfs(cfg->branches,
                      fusepath_,
-                     config.statfs,
-                     config.statfs_ignore,
+                     cfg->statfs,
+                     cfg->statfs_ignore,
                      st_);
   }
 }
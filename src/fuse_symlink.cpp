@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_symlink.hpp"
@@ -63,10 +64,13 @@ namespace l
   {
     int rv;
     string fullnewpath;
+    const branchstats::Call call(newbasepath_);
 
     fullnewpath = fs::path::make(newbasepath_,newpath_);
 
-    rv = fs::symlink(oldpath_,fullnewpath);
+    rv = call.done(fs::symlink(oldpath_,fullnewpath));
+    if(rv == 0)
+      ugid::chown_created(fullnewpath,S_IFLNK);
 
     return error::calc(rv,error_,errno);
   }
@@ -133,12 +137,12 @@ namespace FUSE
           const char *newpath_)
   {
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::symlink(config.func.getattr.policy,
-                      config.func.symlink.policy,
-                      config.branches,
+    return l::symlink(cfg->func.getattr.policy,
+                      cfg->func.symlink.policy,
+                      cfg->branches,
                       oldpath_,
                       newpath_);
   }
@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_path.hpp"
@@ -63,11 +64,12 @@ namespace l
                      PolicyRV     *prv_)
   {
     string fullpath;
+    const branchstats::Call call(basepath_);
 
     fullpath = fs::path::make(basepath_,fusepath_);
 
     errno = 0;
-    fs::truncate(fullpath,size_);
+    call.done(fs::truncate(fullpath,size_));
 
     prv_->insert(errno,basepath_);
   }
@@ -123,12 +125,12 @@ namespace FUSE
            off_t       size_)
   {
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::truncate(config.func.truncate.policy,
-                       config.func.getattr.policy,
-                       config.branches,
+    return l::truncate(cfg->func.truncate.policy,
+                       cfg->func.getattr.policy,
+                       cfg->branches,
                        fusepath_,
                        size_);
   }
@@ -14,6 +14,7 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_path.hpp"
@@ -58,10 +59,11 @@ namespace l
   {
     int rv;
     string fullpath;
+    const branchstats::Call call(basepath_);
 
     fullpath = fs::path::make(basepath_,fusepath_);
 
-    rv = fs::unlink(fullpath);
+    rv = call.done(fs::unlink(fullpath));
 
     return error::calc(rv,error_,errno);
   }
@@ -105,13 +107,13 @@ namespace FUSE
   unlink(const char *fusepath_)
   {
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    config.open_cache.erase(fusepath_);
+    cfg->open_cache.erase(fusepath_);
 
-    return l::unlink(config.func.unlink.policy,
-                     config.branches,
+    return l::unlink(cfg->func.unlink.policy,
+                     cfg->branches,
                      fusepath_);
   }
 }
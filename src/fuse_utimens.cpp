@@ -14,10 +14,12 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
 #include "errno.hpp"
 #include "fs_lutimens.hpp"
 #include "fs_path.hpp"
+#include "moveonenospc_async.hpp"
 #include "policy_rv.hpp"
 #include "ugid.hpp"
 
@@ -62,11 +64,12 @@ namespace l
                     PolicyRV       *prv_)
   {
     string fullpath;
+    const branchstats::Call call(basepath_);
 
     fullpath = fs::path::make(basepath_,fusepath_);
 
     errno = 0;
-    fs::lutimens(fullpath,ts_);
+    call.done(fs::lutimens(fullpath,ts_));
 
     prv_->insert(errno,basepath_);
   }
@@ -121,14 +124,19 @@ namespace FUSE
   utimens(const char     *fusepath_,
           const timespec  ts_[2])
   {
+    int rv;
     const fuse_context *fc     = fuse_get_context();
-    const Config       &config = Config::ro();
+    Config::Read        cfg;
     const ugid::Set     ugid(fc->uid,fc->gid);
 
-    return l::utimens(config.func.utimens.policy,
-                      config.func.getattr.policy,
-                      config.branches,
-                      fusepath_,
-                      ts_);
+    rv = l::utimens(cfg->func.utimens.policy,
+                    cfg->func.getattr.policy,
+                    cfg->branches,
+                    fusepath_,
+                    ts_);
+    if(rv == 0)
+      moveonenospc::utimens(fusepath_,ts_);
+
+    return rv;
   }
 }
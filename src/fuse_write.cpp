@@ -14,11 +14,15 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
+#include "epoch.hpp"
 #include "errno.hpp"
 #include "fileinfo.hpp"
 #include "fs_movefile.hpp"
 #include "fs_write.hpp"
+#include "moveonenospc_async.hpp"
+#include "opstats.hpp"
 #include "ugid.hpp"
 
 #include <string>
@@ -75,6 +79,26 @@ namespace l
     return rv;
   }
 
+  static
+  int
+  write_counted(WriteFunc     func_,
+                const int     fd_,
+                const char   *buf_,
+                const size_t  count_,
+                const off_t   offset_,
+                const int     branch_)
+  {
+    int rv;
+    uint64_t start;
+
+    start = opstats::now();
+    rv    = func_(fd_,buf_,count_,offset_);
+    branchstats::record(branch_,branchstats::WRITE,((rv > 0) ? rv : 0),
+                        opstats::now() - start,(rv < 0));
+
+    return rv;
+  }
+
   static
   int
   move_and_write(WriteFunc     func_,
@@ -85,19 +109,48 @@ namespace l
                  int           err_)
   {
     int rv;
-    const Config &config = Config::ro();
-
-    if(config.moveonenospc.enabled == false)
-      return err_;
-
-    rv = fs::movefile_as_root(config.moveonenospc.policy,
-                              config.branches,
+    int fd;
+    bool async;
+    const Policy *policy;
+    Branches *branches;
+
+    // don't pin the config across what may be a very long copy
+    {
+      Config::Read cfg;
+
+      if(cfg->moveonenospc.enabled == false)
+        return err_;
+
+      async    = cfg->moveonenospc_async;
+      policy   = cfg->moveonenospc.policy;
+      branches = &cfg->branches;
+    }
+
+    if(async || moveonenospc::active(fi_))
+      {
+        rv = moveonenospc::start(policy,
+                                 *branches,
+                                 fi_);
+        if(rv == -1)
+          return err_;
+
+        fd = moveonenospc::write_fd(fi_,offset_,count_);
+        if(fd == -1)
+          return -errno;
+
+        return func_(fd,buf_,count_,offset_);
+      }
+
+    rv = fs::movefile_as_root(policy,
+                              *branches,
                               fi_->fusepath,
                               &fi_->fd);
     if(rv == -1)
       return err_;
 
-    return func_(fi_->fd,buf_,count_,offset_);
+    fi_->branch = branchstats::find(*branches,fi_->fusepath,fi_->fd);
+
+    return l::write_counted(func_,fi_->fd,buf_,count_,offset_,fi_->branch);
   }
 
   static
@@ -109,11 +162,17 @@ namespace l
         const off_t             offset_)
   {
     int rv;
+    int fd;
     FileInfo* fi;
+    const epoch::ReadGuard guard;
 
     fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
-    rv = func_(fi->fd,buf_,count_,offset_);
+    fd = moveonenospc::write_fd(fi,offset_,count_);
+    if(fd == -1)
+      return -errno;
+
+    rv = l::write_counted(func_,fd,buf_,count_,offset_,fi->branch);
     if(l::out_of_space(-rv))
       rv = l::move_and_write(func_,buf_,count_,offset_,fi,rv);
 
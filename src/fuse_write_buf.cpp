@@ -14,11 +14,15 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "branchstats.hpp"
 #include "config.hpp"
+#include "epoch.hpp"
 #include "errno.hpp"
 #include "fileinfo.hpp"
 #include "fs_movefile.hpp"
 #include "fuse_write.hpp"
+#include "moveonenospc_async.hpp"
+#include "opstats.hpp"
 
 #include "fuse.h"
 
@@ -41,6 +45,14 @@ namespace l
             (error_ == EDQUOT));
   }
 
+  /*
+    When libfuse is splicing requests from /dev/fuse (splice_read)
+    src_ is a pipe and the data is spliced straight into the branch
+    file. A splice can be cut short at pipe buffer boundaries so the
+    destination is marked for retry to avoid returning short
+    writes. If the underlying filesystem doesn't support splice
+    fuse_buf_copy falls back to read/write.
+  */
   static
   int
   write_buf(const int    fd_,
@@ -52,13 +64,31 @@ namespace l
     const fuse_buf_copy_flags cpflags =
       (fuse_buf_copy_flags)(FUSE_BUF_SPLICE_MOVE|FUSE_BUF_SPLICE_NONBLOCK);
 
-    dst.buf->flags = (fuse_buf_flags)(FUSE_BUF_IS_FD|FUSE_BUF_FD_SEEK);
+    dst.buf->flags = (fuse_buf_flags)(FUSE_BUF_IS_FD|FUSE_BUF_FD_SEEK|FUSE_BUF_FD_RETRY);
     dst.buf->fd    = fd_;
     dst.buf->pos   = offset_;
 
     return fuse_buf_copy(&dst,src_,cpflags);
   }
 
+  static
+  int
+  write_buf_counted(const int    fd_,
+                    fuse_bufvec *src_,
+                    const off_t  offset_,
+                    const int    branch_)
+  {
+    int rv;
+    uint64_t start;
+
+    start = opstats::now();
+    rv    = l::write_buf(fd_,src_,offset_);
+    branchstats::record(branch_,branchstats::WRITE,((rv > 0) ? rv : 0),
+                        opstats::now() - start,(rv < 0));
+
+    return rv;
+  }
+
   static
   int
   move_and_write_buf(FileInfo    *fi_,
@@ -67,19 +97,48 @@ namespace l
                      int          err_)
   {
     int rv;
-    const Config &config = Config::ro();
-
-    if(config.moveonenospc.enabled == false)
-      return err_;
-
-    rv = fs::movefile_as_root(config.moveonenospc.policy,
-                              config.branches,
+    int fd;
+    bool async;
+    const Policy *policy;
+    Branches *branches;
+
+    // don't pin the config across what may be a very long copy
+    {
+      Config::Read cfg;
+
+      if(cfg->moveonenospc.enabled == false)
+        return err_;
+
+      async    = cfg->moveonenospc_async;
+      policy   = cfg->moveonenospc.policy;
+      branches = &cfg->branches;
+    }
+
+    if(async || moveonenospc::active(fi_))
+      {
+        rv = moveonenospc::start(policy,
+                                 *branches,
+                                 fi_);
+        if(rv == -1)
+          return err_;
+
+        fd = moveonenospc::write_fd(fi_,offset_,fuse_buf_size(src_));
+        if(fd == -1)
+          return -errno;
+
+        return l::write_buf(fd,src_,offset_);
+      }
+
+    rv = fs::movefile_as_root(policy,
+                              *branches,
                               fi_->fusepath,
                               &fi_->fd);
     if(rv == -1)
       return err_;
 
-    return l::write_buf(fi_->fd,src_,offset_);
+    fi_->branch = branchstats::find(*branches,fi_->fusepath,fi_->fd);
+
+    return l::write_buf_counted(fi_->fd,src_,offset_,fi_->branch);
   }
 }
 
@@ -91,9 +150,37 @@ namespace FUSE
             off_t                   offset_)
   {
     int rv;
+    int fd;
+    bool async_io;
+    const epoch::ReadGuard guard;
     FileInfo *fi = reinterpret_cast<FileInfo*>(ffi_->fh);
 
-    rv = l::write_buf(fi->fd,src_,offset_);
+    /*
+      Moving a file on ENOSPC can take a long time and can't be done
+      from the async completion thread so such writes stay synchronous.
+    */
+    {
+      Config::Read cfg;
+
+      async_io = (cfg->async_io && !cfg->moveonenospc.enabled);
+    }
+
+    if(async_io && !moveonenospc::active(fi))
+      {
+        rv = fuse_write_buf_async(fi->fd,src_,offset_);
+        if(rv == 0)
+          {
+            // completed by io_uring so only the size is known
+            branchstats::bytes(fi->branch,branchstats::WRITE,fuse_buf_size(src_));
+            return 0;
+          }
+      }
+
+    fd = moveonenospc::write_fd(fi,offset_,fuse_buf_size(src_));
+    if(fd == -1)
+      return -errno;
+
+    rv = l::write_buf_counted(fd,src_,offset_,fi->branch);
     if(l::out_of_space(-rv))
       rv = l::move_and_write_buf(fi,src_,offset_,rv);
 
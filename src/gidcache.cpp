@@ -14,10 +14,24 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "gidcache.hpp"
+
+#include "thread_slots.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <errno.h>
 #include <grp.h>
+#include <pthread.h>
 #include <pwd.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #if defined __linux__ and UGID_USE_RWLOCK == 0
@@ -26,150 +40,466 @@
 # include <sys/param.h>
 #endif
 
-#include <cstdlib>
-#include <algorithm>
-
-#include "gidcache.hpp"
-
-inline
-bool
-gid_t_rec::operator<(const struct gid_t_rec &b) const
-{
-  return uid < b.uid;
-}
-
-inline
-gid_t_rec *
-gid_t_cache::begin(void)
-{
-  return recs;
-}
+#define CACHELINE_SIZE 64
+#define SHARD_COUNT    64
 
-inline
-gid_t_rec *
-gid_t_cache::end(void)
+namespace l
 {
-  return recs + size;
-}
+  struct Record
+  {
+    uint64_t           time;
+    std::vector<gid_t> gids;
 
-inline
-gid_t_rec *
-gid_t_cache::allocrec(void)
-{
-  if(size == MAXRECS)
-    return &recs[rand() % MAXRECS];
-  else
-    return &recs[size++];
-}
+    void
+    swap(Record &r_)
+    {
+      std::swap(time,r_.time);
+      gids.swap(r_.gids);
+    }
+  };
 
-inline
-gid_t_rec *
-gid_t_cache::lower_bound(gid_t_rec   *begin,
-                         gid_t_rec   *end,
-                         const uid_t  uid)
-{
-  int step;
-  int count;
-  gid_t_rec *iter;
+  typedef std::map<uint64_t,Record> RecordMap;
 
-  count = std::distance(begin,end);
-  while(count > 0)
+  /*
+    Records are sharded by uid so all of one user's records live in
+    the same shard and can be invalidated together.
+  */
+  struct Shard
+  {
+    Shard()
     {
-      iter = begin;
-      step = count / 2;
-      std::advance(iter,step);
-      if(iter->uid < uid)
-        {
-          begin  = ++iter;
-          count -= step + 1;
-        }
-      else
-        {
-          count = step;
-        }
+      pthread_rwlock_init(&lock,NULL);
     }
 
-  return begin;
-}
+    pthread_rwlock_t lock;
+    RecordMap        recs;
+  } __attribute__((aligned(CACHELINE_SIZE)));
 
-static
-int
-_getgrouplist(const char  *user,
-              const gid_t  group,
-              gid_t       *groups,
-              int         *ngroups)
-{
-#if __APPLE__
-  return ::getgrouplist(user,group,(int*)groups,ngroups);
-#else
-  return ::getgrouplist(user,group,groups,ngroups);
-#endif
-}
+  static Shard                 g_shards[SHARD_COUNT];
+  static std::atomic<uint64_t> g_ttl(0);
 
-gid_t_rec *
-gid_t_cache::cache(const uid_t uid,
-                   const gid_t gid)
-{
-  int rv;
-  char buf[4096];
-  struct passwd pwd;
-  struct passwd *pwdrv;
-  gid_t_rec *rec;
+  static std::atomic<uint64_t> g_refreshes(0);
 
-  rec = allocrec();
+  /*
+    Lookups are counted per thread so the hot path doesn't share a
+    cacheline with every other thread.
+  */
+  struct LookupCounters
+  {
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> stale;
+    bool                  used;
+    LookupCounters       *next;
+  } __attribute__((aligned(CACHELINE_SIZE)));
 
-  rec->uid = uid;
-  rv = ::getpwuid_r(uid,&pwd,buf,sizeof(buf),&pwdrv);
-  if(pwdrv != NULL && rv == 0)
-    {
-      rec->size = 0;
-      ::_getgrouplist(pwd.pw_name,gid,NULL,&rec->size);
-      rec->size = std::min(MAXGIDS,rec->size);
-      rv = ::_getgrouplist(pwd.pw_name,gid,rec->gids,&rec->size);
-      if(rv == -1)
-        {
-          rec->gids[0] = gid;
-          rec->size    = 1;
-        }
-    }
+  typedef ThreadSlots<LookupCounters> CounterSlots;
 
-  return rec;
-}
+  static std::set<uint64_t>    g_pending;
+  static pthread_mutex_t       g_pending_lock = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t        g_pending_cond = PTHREAD_COND_INITIALIZER;
+  static pthread_once_t        g_thread_once  = PTHREAD_ONCE_INIT;
 
-static
-inline
-int
-setgroups(const gid_t_rec *rec)
-{
+  // only the owning thread writes so no read-modify-write is needed
+  static
+  inline
+  void
+  inc(std::atomic<uint64_t> &c_)
+  {
+    c_.store(c_.load(std::memory_order_relaxed) + 1,
+             std::memory_order_relaxed);
+  }
+
+  static
+  inline
+  uint64_t
+  key(const uid_t uid_,
+      const gid_t gid_)
+  {
+    return (((uint64_t)uid_ << 32) | (uint64_t)gid_);
+  }
+
+  static
+  inline
+  Shard&
+  shard(const uid_t uid_)
+  {
+    return g_shards[uid_ % SHARD_COUNT];
+  }
+
+  static
+  uint64_t
+  get_time(void)
+  {
+    return ::time(NULL);
+  }
+
+  static
+  int
+  getgrouplist(const char  *user_,
+               const gid_t  group_,
+               gid_t       *groups_,
+               int         *ngroups_)
+  {
+#if __APPLE__
+    return ::getgrouplist(user_,group_,(int*)groups_,ngroups_);
+#else
+    return ::getgrouplist(user_,group_,groups_,ngroups_);
+#endif
+  }
+
+  static
+  int
+  setgroups(const std::vector<gid_t> &gids_)
+  {
 #if defined __linux__ and UGID_USE_RWLOCK == 0
 # if defined SYS_setgroups32
-  return ::syscall(SYS_setgroups32,rec->size,rec->gids);
+    return ::syscall(SYS_setgroups32,gids_.size(),&gids_[0]);
 # else
-  return ::syscall(SYS_setgroups,rec->size,rec->gids);
+    return ::syscall(SYS_setgroups,gids_.size(),&gids_[0]);
 # endif
 #else
-  return ::setgroups(rec->size,rec->gids);
+    return ::setgroups(gids_.size(),&gids_[0]);
 #endif
+  }
+
+  /*
+    Neither the passwd entry nor the group list has a fixed upper
+    bound so both buffers grow until the lookup fits. The list is only
+    cut short at what setgroups will accept.
+  */
+  static
+  void
+  lookup(const uid_t         uid_,
+         const gid_t         gid_,
+         std::vector<gid_t> *gids_)
+  {
+    int rv;
+    int ngroups;
+    long ngroups_max;
+    struct passwd pwd;
+    struct passwd *pwdrv;
+    std::vector<char> buf(4096);
+
+    for(;;)
+      {
+        rv = ::getpwuid_r(uid_,&pwd,&buf[0],buf.size(),&pwdrv);
+        if(rv != ERANGE)
+          break;
+        buf.resize(buf.size() * 2);
+      }
+
+    if((rv != 0) || (pwdrv == NULL))
+      {
+        gids_->assign(1,gid_);
+        return;
+      }
+
+    gids_->resize(32);
+    for(;;)
+      {
+        ngroups = gids_->size();
+        rv = l::getgrouplist(pwd.pw_name,gid_,&(*gids_)[0],&ngroups);
+        if(rv != -1)
+          break;
+        if(ngroups <= (int)gids_->size())
+          ngroups = gids_->size() * 2;
+        gids_->resize(ngroups);
+      }
+
+    gids_->resize(ngroups);
+
+    ngroups_max = ::sysconf(_SC_NGROUPS_MAX);
+    if((ngroups_max > 0) && (gids_->size() > (size_t)ngroups_max))
+      gids_->resize(ngroups_max);
+  }
+
+  static
+  void
+  refresh(const uint64_t key_)
+  {
+    uid_t uid;
+    gid_t gid;
+    uint64_t now;
+    RecordMap::iterator i;
+    std::vector<gid_t> gids;
+
+    uid = (key_ >> 32);
+    gid = (key_ & 0xFFFFFFFF);
+    now = l::get_time();
+
+    Shard &s = l::shard(uid);
+
+    pthread_rwlock_rdlock(&s.lock);
+    i = s.recs.find(key_);
+    if((i == s.recs.end()) || ((now - i->second.time) < g_ttl))
+      {
+        pthread_rwlock_unlock(&s.lock);
+        return;
+      }
+    pthread_rwlock_unlock(&s.lock);
+
+    l::lookup(uid,gid,&gids);
+
+    pthread_rwlock_wrlock(&s.lock);
+    i = s.recs.find(key_);
+    if(i != s.recs.end())
+      {
+        i->second.time = now;
+        if(i->second.gids != gids)
+          {
+            i->second.gids.swap(gids);
+            gidcache::generation++;
+          }
+      }
+    pthread_rwlock_unlock(&s.lock);
+
+    g_refreshes++;
+  }
+
+  static
+  void
+  stale_keys(std::set<uint64_t> *keys_)
+  {
+    uint64_t now;
+    uint64_t ttl;
+    RecordMap::const_iterator i;
+
+    now = l::get_time();
+    ttl = g_ttl;
+    if(ttl == 0)
+      return;
+
+    for(int s = 0; s < SHARD_COUNT; s++)
+      {
+        pthread_rwlock_rdlock(&g_shards[s].lock);
+        for(i = g_shards[s].recs.begin(); i != g_shards[s].recs.end(); ++i)
+          {
+            if((now - i->second.time) >= ttl)
+              keys_->insert(i->first);
+          }
+        pthread_rwlock_unlock(&g_shards[s].lock);
+      }
+  }
+
+  /*
+    Stale entries found by requests are refreshed right away. Every
+    TTL seconds the whole cache is swept as well because a thread
+    which keeps serving the same user never looks its entry up again.
+  */
+  static
+  void*
+  refresh_thread(void *)
+  {
+    uint64_t ttl;
+    uint64_t now;
+    uint64_t sweep;
+    struct timespec ts;
+    std::set<uint64_t> pending;
+    std::set<uint64_t>::const_iterator i;
+
+    sweep = 0;
+    for(;;)
+      {
+        now = l::get_time();
+        ttl = std::max(g_ttl.load(),(uint64_t)1);
+        if((sweep == 0) || (sweep > (now + ttl)))
+          sweep = (now + ttl);
+
+        ts.tv_sec  = sweep;
+        ts.tv_nsec = 0;
+
+        pthread_mutex_lock(&g_pending_lock);
+        if(g_pending.empty())
+          pthread_cond_timedwait(&g_pending_cond,&g_pending_lock,&ts);
+        pending.swap(g_pending);
+        pthread_mutex_unlock(&g_pending_lock);
+
+        if(l::get_time() >= sweep)
+          {
+            l::stale_keys(&pending);
+            sweep = 0;
+          }
+
+        for(i = pending.begin(); i != pending.end(); ++i)
+          l::refresh(*i);
+
+        pending.clear();
+      }
+
+    return NULL;
+  }
+
+  /*
+    The refresh thread is started when the first entry is added rather
+    than at startup so it is created after mergerfs has daemonized.
+  */
+  static
+  void
+  refresh_thread_start(void)
+  {
+    int rv;
+    pthread_t thread;
+
+    rv = pthread_create(&thread,NULL,l::refresh_thread,NULL);
+    if(rv == 0)
+      pthread_detach(thread);
+  }
+
+  static
+  void
+  queue_refresh(const uint64_t key_)
+  {
+    pthread_mutex_lock(&g_pending_lock);
+    if(g_pending.insert(key_).second)
+      pthread_cond_signal(&g_pending_cond);
+    pthread_mutex_unlock(&g_pending_lock);
+  }
 }
 
-int
-gid_t_cache::initgroups(const uid_t uid,
-                        const gid_t gid)
+namespace gidcache
 {
-  int rv;
-  gid_t_rec *rec;
+  std::atomic<uint64_t> generation(0);
 
-  rec = lower_bound(begin(),end(),uid);
-  if(rec == end() || rec->uid != uid)
-    {
-      rec = cache(uid,gid);
-      rv = ::setgroups(rec);
-      std::sort(begin(),end());
-    }
-  else
-    {
-      rv = ::setgroups(rec);
-    }
+  uint64_t
+  ttl(void)
+  {
+    return l::g_ttl;
+  }
+
+  void
+  ttl(const uint64_t seconds_)
+  {
+    uint64_t prev;
+
+    prev = l::g_ttl.exchange(seconds_);
+    if((prev != 0) && (seconds_ == 0))
+      gidcache::invalidate();
+
+    pthread_cond_signal(&l::g_pending_cond);
+  }
+
+  int
+  initgroups(const uid_t uid_,
+             const gid_t gid_)
+  {
+    int rv;
+    bool stale;
+    uint64_t k;
+    uint64_t ttl;
+    uint64_t now;
+    l::Record rec;
+    l::RecordMap::const_iterator i;
+
+    k   = l::key(uid_,gid_);
+    ttl = l::g_ttl;
+    now = l::get_time();
+
+    l::Shard &s = l::shard(uid_);
+
+    if(ttl)
+      {
+        pthread_rwlock_rdlock(&s.lock);
+        i = s.recs.find(k);
+        if(i != s.recs.end())
+          {
+            stale = ((now - i->second.time) >= ttl);
+            rv    = l::setgroups(i->second.gids);
+            pthread_rwlock_unlock(&s.lock);
+
+            if(stale)
+              {
+                l::inc(l::CounterSlots::get()->stale);
+                l::queue_refresh(k);
+              }
+            else
+              {
+                l::inc(l::CounterSlots::get()->hits);
+              }
+
+            return rv;
+          }
+        pthread_rwlock_unlock(&s.lock);
+      }
+
+    l::inc(l::CounterSlots::get()->misses);
+
+    rec.time = now;
+    l::lookup(uid_,gid_,&rec.gids);
+
+    rv = l::setgroups(rec.gids);
+
+    if(ttl)
+      {
+        pthread_once(&l::g_thread_once,l::refresh_thread_start);
+
+        pthread_rwlock_wrlock(&s.lock);
+        s.recs[k].swap(rec);
+        pthread_rwlock_unlock(&s.lock);
+      }
+
+    return rv;
+  }
+
+  void
+  invalidate(void)
+  {
+    for(int i = 0; i < SHARD_COUNT; i++)
+      {
+        pthread_rwlock_wrlock(&l::g_shards[i].lock);
+        l::g_shards[i].recs.clear();
+        pthread_rwlock_unlock(&l::g_shards[i].lock);
+      }
+
+    gidcache::generation++;
+  }
+
+  void
+  invalidate(const uid_t uid_)
+  {
+    l::RecordMap::iterator b;
+    l::RecordMap::iterator e;
+
+    l::Shard &s = l::shard(uid_);
+
+    pthread_rwlock_wrlock(&s.lock);
+    b = s.recs.lower_bound(l::key(uid_,0));
+    e = s.recs.upper_bound(l::key(uid_,(gid_t)-1));
+    s.recs.erase(b,e);
+    pthread_rwlock_unlock(&s.lock);
+
+    gidcache::generation++;
+  }
+
+  void
+  stats(Stats *stats_)
+  {
+    stats_->hits      = 0;
+    stats_->misses    = 0;
+    stats_->stale     = 0;
+    stats_->refreshes = l::g_refreshes;
+
+    for(const l::LookupCounters *c = l::CounterSlots::head(); c != NULL; c = c->next)
+      {
+        stats_->hits   += c->hits.load(std::memory_order_relaxed);
+        stats_->misses += c->misses.load(std::memory_order_relaxed);
+        stats_->stale  += c->stale.load(std::memory_order_relaxed);
+      }
+    stats_->entries   = 0;
+    stats_->bytes     = 0;
+
+    for(int i = 0; i < SHARD_COUNT; i++)
+      {
+        const l::RecordMap &recs = l::g_shards[i].recs;
 
-  return rv;
+        pthread_rwlock_rdlock(&l::g_shards[i].lock);
+        stats_->entries += recs.size();
+        // a tree node is a color and 3 pointers plus the value
+        for(l::RecordMap::const_iterator r = recs.begin(); r != recs.end(); ++r)
+          stats_->bytes += ((4 * sizeof(void*)) +
+                            sizeof(l::RecordMap::value_type) +
+                            (r->second.gids.capacity() * sizeof(gid_t)));
+        pthread_rwlock_unlock(&l::g_shards[i].lock);
+      }
+  }
 }
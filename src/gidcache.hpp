@@ -16,40 +16,44 @@
 
 #pragma once
 
-#include <sys/types.h>
-#include <unistd.h>
-
-#define MAXGIDS 32
-#define MAXRECS 256
-
-struct gid_t_rec
-{
-  uid_t uid;
-  int   size;
-  gid_t gids[MAXGIDS];
+#include <atomic>
 
-  bool
-  operator<(const struct gid_t_rec &b) const;
-};
+#include <stdint.h>
+#include <sys/types.h>
 
-struct gid_t_cache
+/*
+  Supplementary groups are looked up once per uid / gid pair and
+  shared by every thread. Entries older than the TTL are still used
+  but are queued to be refreshed in the background so a request never
+  waits on the group database for a user it has already seen. A TTL of
+  0 disables the cache.
+*/
+namespace gidcache
 {
-public:
-  size_t     size;
-  gid_t_rec  recs[MAXRECS];
-
-private:
-  gid_t_rec * begin(void);
-  gid_t_rec * end(void);
-  gid_t_rec * allocrec(void);
-  gid_t_rec * lower_bound(gid_t_rec   *begin,
-                          gid_t_rec   *end,
-                          const uid_t  uid);
-  gid_t_rec * cache(const uid_t uid,
-                    const gid_t gid);
-
-public:
-  int
-  initgroups(const uid_t uid,
-             const gid_t gid);
-};
+  /*
+    Bumped whenever cached groups change or are dropped so threads
+    still holding a user's old groups know to set them again.
+  */
+  extern std::atomic<uint64_t> generation;
+
+  struct Stats
+  {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stale;
+    uint64_t refreshes;
+    uint64_t entries;
+    uint64_t bytes;
+  };
+
+  uint64_t ttl(void);
+  void     ttl(const uint64_t seconds);
+
+  int initgroups(const uid_t uid,
+                 const gid_t gid);
+
+  void invalidate(void);
+  void invalidate(const uid_t uid);
+
+  void stats(Stats *stats);
+}
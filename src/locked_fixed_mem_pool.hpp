@@ -18,52 +18,339 @@
 
 #pragma once
 
-#include "fixed_mem_pool.hpp"
+#include "fuse_lockstat.h"
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace mempool
+{
+  /*
+    Every pool registers itself so the depot limit can be changed and
+    applied to all of them at once.
+  */
+  class Base
+  {
+  public:
+    Base(const char *name);
+
+  public:
+    virtual void trim(const uint64_t max_bytes) = 0;
+    virtual void usage(uint64_t *objects,
+                       uint64_t *bytes) const = 0;
+
+  public:
+    const char *name;
+  };
 
+  struct Usage
+  {
+    std::string name;
+    uint64_t    objects;
+    uint64_t    bytes;
+  };
+
+  uint64_t max_bytes(void);
+  void     max_bytes(const uint64_t bytes);
+
+  void usage(std::vector<Usage> *usage);
+}
+
+/*
+  Each thread keeps two magazines, small arrays of free objects, and
+  only touches the shared depot when both are empty on alloc or both
+  are full on free. The depot holds full magazines up to
+  mempool::max_bytes and frees anything past that so memory from a
+  burst isn't kept forever.
+*/
 template<size_t SIZE>
-class LockedFixedMemPool
+class LockedFixedMemPool : public mempool::Base
 {
+private:
+  static const uint64_t CAPACITY = ((SIZE >= (1024 * 1024 / 2)) ? 2 :
+                                    (SIZE <= (1024 * 1024 / 64)) ? 64 :
+                                    ((1024 * 1024) / SIZE));
+
+  struct Magazine
+  {
+    uint64_t  count;
+    Magazine *next;
+    void     *objs[CAPACITY];
+  };
+
+  struct Cache
+  {
+    LockedFixedMemPool *pool;
+    Magazine           *loaded;
+    Magazine           *prev;
+  };
+
 public:
-  LockedFixedMemPool()
+  LockedFixedMemPool(const char *name_)
+    : mempool::Base(name_),
+      _full(NULL),
+      _full_count(0),
+      _empty(NULL),
+      _objects(0),
+      _lockstat()
   {
+    _lockstat.name = name;
     pthread_mutex_init(&_mutex,NULL);
+    pthread_key_create(&_key,LockedFixedMemPool::cache_release);
   }
 
+  // The pool lives as long as the process. Threads may still be
+  // using it while static destructors run so nothing is torn down.
   ~LockedFixedMemPool()
   {
-    pthread_mutex_destroy(&_mutex);
   }
 
 public:
   void*
   alloc(void)
   {
-    void *mem;
+    Cache *c;
+    Magazine *mag;
 
-    pthread_mutex_lock(&_mutex);
-    mem = _fmp.alloc();
-    pthread_mutex_unlock(&_mutex);
+    c = cache();
+    if(c->loaded->count == 0)
+      {
+        if(c->prev->count)
+          {
+            std::swap(c->loaded,c->prev);
+          }
+        else
+          {
+            mag = depot_get_full();
+            if(mag == NULL)
+              {
+                _objects.fetch_add(1,std::memory_order_relaxed);
+                return ::malloc(SIZE);
+              }
+
+            depot_put_empty(c->prev);
+            c->prev   = c->loaded;
+            c->loaded = mag;
+          }
+      }
 
-    return mem;
+    return c->loaded->objs[--c->loaded->count];
   }
 
   void
   free(void *mem_)
   {
-    pthread_mutex_lock(&_mutex);
-    _fmp.free(mem_);
-    pthread_mutex_unlock(&_mutex);
+    Cache *c;
+
+    if(mem_ == NULL)
+      return;
+
+    c = cache();
+    if(c->loaded->count == CAPACITY)
+      {
+        if(c->prev->count < CAPACITY)
+          {
+            std::swap(c->loaded,c->prev);
+          }
+        else
+          {
+            depot_put_full(c->prev);
+            c->prev   = c->loaded;
+            c->loaded = depot_get_empty();
+          }
+      }
+
+    c->loaded->objs[c->loaded->count++] = mem_;
   }
 
   uint64_t
   size(void)
   {
-    return _fmp.size();
+    return SIZE;
+  }
+
+  // in use or cached, by threads or the depot
+  void
+  usage(uint64_t *objects_,
+        uint64_t *bytes_) const
+  {
+    *objects_ = _objects.load(std::memory_order_relaxed);
+    *bytes_   = (*objects_ * SIZE);
+  }
+
+  void
+  trim(const uint64_t max_bytes_)
+  {
+    Magazine *mag;
+    uint64_t max;
+
+    max = (max_bytes_ / (SIZE * CAPACITY));
+
+    fuse_lockstat_mutex_lock(&_mutex,&_lockstat);
+    while(_full_count > max)
+      {
+        mag   = _full;
+        _full = mag->next;
+        _full_count--;
+        magazine_free(mag);
+      }
+    while(_empty != NULL)
+      {
+        mag    = _empty;
+        _empty = mag->next;
+        magazine_free(mag);
+      }
+    pthread_mutex_unlock(&_mutex);
+  }
+
+private:
+  static
+  Magazine*
+  magazine_new(void)
+  {
+    Magazine *mag;
+
+    mag = (Magazine*)::malloc(sizeof(Magazine));
+    if(mag == NULL)
+      abort();
+
+    mag->count = 0;
+    mag->next  = NULL;
+
+    return mag;
+  }
+
+  void
+  magazine_free(Magazine *mag_)
+  {
+    for(uint64_t i = 0; i < mag_->count; i++)
+      ::free(mag_->objs[i]);
+    _objects.fetch_sub(mag_->count,std::memory_order_relaxed);
+    ::free(mag_);
+  }
+
+  Cache*
+  cache(void)
+  {
+    Cache *c;
+
+    c = (Cache*)pthread_getspecific(_key);
+    if(c != NULL)
+      return c;
+
+    c = (Cache*)::malloc(sizeof(Cache));
+    if(c == NULL)
+      abort();
+
+    c->pool   = this;
+    c->loaded = depot_get_empty();
+    c->prev   = depot_get_empty();
+
+    pthread_setspecific(_key,c);
+
+    return c;
+  }
+
+  static
+  void
+  cache_release(void *c_)
+  {
+    Cache *c = (Cache*)c_;
+
+    c->pool->depot_put(c->loaded);
+    c->pool->depot_put(c->prev);
+
+    ::free(c);
+  }
+
+  Magazine*
+  depot_get_full(void)
+  {
+    Magazine *mag;
+
+    fuse_lockstat_mutex_lock(&_mutex,&_lockstat);
+    mag = _full;
+    if(mag != NULL)
+      {
+        _full = mag->next;
+        _full_count--;
+      }
+    pthread_mutex_unlock(&_mutex);
+
+    return mag;
+  }
+
+  Magazine*
+  depot_get_empty(void)
+  {
+    Magazine *mag;
+
+    fuse_lockstat_mutex_lock(&_mutex,&_lockstat);
+    mag = _empty;
+    if(mag != NULL)
+      _empty = mag->next;
+    pthread_mutex_unlock(&_mutex);
+
+    if(mag == NULL)
+      mag = LockedFixedMemPool::magazine_new();
+
+    return mag;
+  }
+
+  void
+  depot_put_empty(Magazine *mag_)
+  {
+    fuse_lockstat_mutex_lock(&_mutex,&_lockstat);
+    mag_->next = _empty;
+    _empty     = mag_;
+    pthread_mutex_unlock(&_mutex);
+  }
+
+  void
+  depot_put_full(Magazine *mag_)
+  {
+    uint64_t max;
+
+    max = (mempool::max_bytes() / (SIZE * CAPACITY));
+
+    fuse_lockstat_mutex_lock(&_mutex,&_lockstat);
+    if(_full_count < max)
+      {
+        mag_->next = _full;
+        _full      = mag_;
+        _full_count++;
+        mag_ = NULL;
+      }
+    pthread_mutex_unlock(&_mutex);
+
+    if(mag_ != NULL)
+      magazine_free(mag_);
+  }
+
+  // a partially filled magazine from an exiting thread
+  void
+  depot_put(Magazine *mag_)
+  {
+    if(mag_->count == 0)
+      return depot_put_empty(mag_);
+
+    depot_put_full(mag_);
   }
 
 private:
-  FixedMemPool<SIZE> _fmp;
-  pthread_mutex_t    _mutex;
+  pthread_key_t    _key;
+  pthread_mutex_t  _mutex;
+  Magazine        *_full;
+  uint64_t         _full_count;
+  Magazine        *_empty;
+  // only changed when objects are malloc'ed or free'd, not reused
+  std::atomic<uint64_t> _objects;
+  fuse_lockstat_t  _lockstat;
 };
@@ -16,6 +16,131 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "dirinfo.hpp"
+#include "fileinfo.hpp"
 #include "locked_fixed_mem_pool.hpp"
 
-LockedFixedMemPool<128 * 1024> g_DENTS_BUF_POOL;
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include <pthread.h>
+
+#define MEMPOOL_MAX_BYTES_DEFAULT (32ULL * 1024ULL * 1024ULL)
+
+namespace l
+{
+  static std::atomic<uint64_t> max_bytes(MEMPOOL_MAX_BYTES_DEFAULT);
+  static pthread_mutex_t       pools_lock = PTHREAD_MUTEX_INITIALIZER;
+  static std::atomic<uint64_t> fileinfos(0);
+  static std::atomic<uint64_t> dirinfos(0);
+
+  // function local so it exists before any pool registers
+  static
+  std::vector<mempool::Base*>&
+  pools(void)
+  {
+    static std::vector<mempool::Base*> pools;
+
+    return pools;
+  }
+}
+
+namespace mempool
+{
+  Base::Base(const char *name_)
+    : name(name_)
+  {
+    pthread_mutex_lock(&l::pools_lock);
+    l::pools().push_back(this);
+    pthread_mutex_unlock(&l::pools_lock);
+  }
+
+  uint64_t
+  max_bytes(void)
+  {
+    return l::max_bytes;
+  }
+
+  void
+  max_bytes(const uint64_t bytes_)
+  {
+    l::max_bytes = bytes_;
+
+    pthread_mutex_lock(&l::pools_lock);
+    for(size_t i = 0; i < l::pools().size(); i++)
+      l::pools()[i]->trim(bytes_);
+    pthread_mutex_unlock(&l::pools_lock);
+  }
+
+  void
+  usage(std::vector<Usage> *usage_)
+  {
+    pthread_mutex_lock(&l::pools_lock);
+    usage_->resize(l::pools().size());
+    for(size_t i = 0; i < l::pools().size(); i++)
+      {
+        (*usage_)[i].name = l::pools()[i]->name;
+        l::pools()[i]->usage(&(*usage_)[i].objects,&(*usage_)[i].bytes);
+      }
+    pthread_mutex_unlock(&l::pools_lock);
+  }
+
+  uint64_t
+  fileinfos(void)
+  {
+    return l::fileinfos.load(std::memory_order_relaxed);
+  }
+
+  uint64_t
+  dirinfos(void)
+  {
+    return l::dirinfos.load(std::memory_order_relaxed);
+  }
+}
+
+LockedFixedMemPool<128 * 1024>       g_DENTS_BUF_POOL("mempool.dents");
+LockedFixedMemPool<sizeof(FileInfo)> g_FILEINFO_POOL("mempool.fileinfo");
+LockedFixedMemPool<sizeof(DirInfo)>  g_DIRINFO_POOL("mempool.dirinfo");
+
+void*
+FileInfo::operator new(size_t size_)
+{
+  void *mem;
+
+  mem = g_FILEINFO_POOL.alloc();
+  if(mem == NULL)
+    throw std::bad_alloc();
+
+  l::fileinfos.fetch_add(1,std::memory_order_relaxed);
+
+  return mem;
+}
+
+void
+FileInfo::operator delete(void *mem_)
+{
+  l::fileinfos.fetch_sub(1,std::memory_order_relaxed);
+  g_FILEINFO_POOL.free(mem_);
+}
+
+void*
+DirInfo::operator new(size_t size_)
+{
+  void *mem;
+
+  mem = g_DIRINFO_POOL.alloc();
+  if(mem == NULL)
+    throw std::bad_alloc();
+
+  l::dirinfos.fetch_add(1,std::memory_order_relaxed);
+
+  return mem;
+}
+
+void
+DirInfo::operator delete(void *mem_)
+{
+  l::dirinfos.fetch_sub(1,std::memory_order_relaxed);
+  g_DIRINFO_POOL.free(mem_);
+}
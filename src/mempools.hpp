@@ -21,3 +21,10 @@
 #include "locked_fixed_mem_pool.hpp"
 
 extern LockedFixedMemPool<128 * 1024> g_DENTS_BUF_POOL;
+
+namespace mempool
+{
+  // FileInfo and DirInfo currently allocated, ie. open handles
+  uint64_t fileinfos(void);
+  uint64_t dirinfos(void);
+}
@@ -0,0 +1,200 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "memstats.hpp"
+
+#include "config.hpp"
+#include "dirinfo.hpp"
+#include "fileinfo.hpp"
+#include "fs_statvfs_cache.hpp"
+#include "gidcache.hpp"
+#include "mempools.hpp"
+#include "ugid.hpp"
+
+#include "fuse.h"
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <syslog.h>
+#include <time.h>
+
+using std::string;
+using std::vector;
+
+namespace l
+{
+  // seconds between checks of the node count
+  const uint64_t TRIM_INTERVAL = 10;
+
+  static struct fuse     *g_fuse      = NULL;
+  static pthread_mutex_t  g_lock      = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t   g_cond      = PTHREAD_COND_INITIALIZER;
+  static uint64_t         g_nodes_max = 0;
+  static bool             g_trimming  = false;
+  static bool             g_busy      = false;
+
+  static
+  void
+  add(vector<memstats::Usage> *usage_,
+      const string            &name_,
+      const uint64_t           entries_,
+      const uint64_t           bytes_)
+  {
+    memstats::Usage u;
+
+    u.name    = name_;
+    u.entries = entries_;
+    u.bytes   = bytes_;
+
+    usage_->push_back(u);
+  }
+
+  /*
+    Invalidates in batches until under the limit. The kernel forgets
+    in its own time so the count is checked again after a pause rather
+    than right away. Clearing the fuse instance waits for a pass in
+    progress to finish.
+  */
+  static
+  void*
+  trimmer(void *arg_)
+  {
+    uint64_t max;
+    uint64_t trimmed;
+    struct fuse *f;
+    struct timespec ts;
+    fuse_memstats_t ms;
+
+    pthread_mutex_lock(&g_lock);
+    while((g_nodes_max > 0) && (g_fuse != NULL))
+      {
+        f      = g_fuse;
+        max    = g_nodes_max;
+        g_busy = true;
+        pthread_mutex_unlock(&g_lock);
+
+        fuse_memstats(f,&ms);
+        if(ms.nodes > max)
+          {
+            trimmed = fuse_trim_nodes(f,max);
+            syslog(LOG_INFO,
+                   "memory.nodes.max: %llu nodes, asked the kernel to forget %llu",
+                   (unsigned long long)ms.nodes,
+                   (unsigned long long)trimmed);
+          }
+
+        pthread_mutex_lock(&g_lock);
+        g_busy = false;
+        pthread_cond_broadcast(&g_cond);
+        if((g_nodes_max == 0) || (g_fuse == NULL))
+          break;
+
+        clock_gettime(CLOCK_REALTIME,&ts);
+        ts.tv_sec += TRIM_INTERVAL;
+        pthread_cond_timedwait(&g_cond,&g_lock,&ts);
+      }
+
+    g_trimming = false;
+    pthread_mutex_unlock(&g_lock);
+
+    return NULL;
+  }
+}
+
+namespace memstats
+{
+  void
+  fuse(struct fuse *f_)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    l::g_fuse = f_;
+    pthread_cond_broadcast(&l::g_cond);
+    while(l::g_busy)
+      pthread_cond_wait(&l::g_cond,&l::g_lock);
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  void
+  usage(vector<Usage> *usage_)
+  {
+    uint64_t bytes;
+    uint64_t entries;
+    fuse_memstats_t ms;
+    gidcache::Stats gs;
+    vector<mempool::Usage> pools;
+    Config::Read cfg;
+
+    usage_->clear();
+
+    pthread_mutex_lock(&l::g_lock);
+    if(l::g_fuse != NULL)
+      {
+        fuse_memstats(l::g_fuse,&ms);
+        l::add(usage_,"nodes",ms.nodes,ms.node_bytes);
+        l::add(usage_,"nodes.tables",ms.table_slots,ms.table_bytes);
+        l::add(usage_,"nodes.names",ms.names,ms.name_bytes);
+      }
+    pthread_mutex_unlock(&l::g_lock);
+
+    cfg->open_cache.usage(&entries,&bytes);
+    l::add(usage_,"policy_cache",entries,bytes);
+
+    fs::statvfs_cache_usage(&entries,&bytes);
+    l::add(usage_,"statvfs_cache",entries,bytes);
+
+    gidcache::stats(&gs);
+    l::add(usage_,"gidcache",gs.entries,gs.bytes);
+
+    mempool::usage(&pools);
+    for(size_t i = 0; i < pools.size(); i++)
+      l::add(usage_,pools[i].name,pools[i].objects,pools[i].bytes);
+
+    entries = mempool::fileinfos();
+    l::add(usage_,"fileinfo",entries,(entries * sizeof(FileInfo)));
+
+    entries = mempool::dirinfos();
+    l::add(usage_,"dirinfo",entries,(entries * sizeof(DirInfo)));
+  }
+
+  void
+  nodes_max(const uint64_t max_)
+  {
+    int rv;
+    pthread_t thread;
+    pthread_attr_t attr;
+
+    pthread_mutex_lock(&l::g_lock);
+    l::g_nodes_max = max_;
+    pthread_cond_broadcast(&l::g_cond);
+    if((max_ > 0) && (l::g_fuse != NULL) && !l::g_trimming)
+      {
+        const ugid::Set ugid(0,0);
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+        rv = pthread_create(&thread,&attr,l::trimmer,NULL);
+        pthread_attr_destroy(&attr);
+        l::g_trimming = (rv == 0);
+      }
+    pthread_mutex_unlock(&l::g_lock);
+  }
+}
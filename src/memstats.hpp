@@ -0,0 +1,48 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+struct fuse;
+
+/*
+  Live entry and byte counts of the structures which grow with the
+  filesystem or its use. Bytes are estimates of heap used including
+  container overhead but not allocator overhead.
+*/
+namespace memstats
+{
+  struct Usage
+  {
+    std::string name;
+    uint64_t    entries;
+    uint64_t    bytes;
+  };
+
+  void fuse(struct fuse *f);
+
+  void usage(std::vector<Usage> *usage);
+
+  void nodes_max(const uint64_t max);
+}
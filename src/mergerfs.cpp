@@ -65,6 +65,7 @@
 #include "fuse_utimens.hpp"
 #include "fuse_write.hpp"
 #include "fuse_write_buf.hpp"
+#include "opstats.hpp"
 
 #include <fuse.h>
 
@@ -80,56 +81,62 @@ namespace l
   get_fuse_operations(struct fuse_operations &ops_,
                       const bool              nullrw_)
   {
-    ops_.access          = FUSE::access;
+    ops_.access          = OPSTATS_TIMED(ACCESS,FUSE::access);
     ops_.bmap            = NULL;
-    ops_.chmod           = FUSE::chmod;
-    ops_.chown           = FUSE::chown;
-    ops_.copy_file_range = FUSE::copy_file_range;
-    ops_.create          = FUSE::create;
+    ops_.chmod           = OPSTATS_TIMED(CHMOD,FUSE::chmod);
+    ops_.chown           = OPSTATS_TIMED(CHOWN,FUSE::chown);
+    ops_.copy_file_range = OPSTATS_TIMED(COPY_FILE_RANGE,FUSE::copy_file_range);
+    ops_.create          = OPSTATS_TIMED(CREATE,FUSE::create);
     ops_.destroy         = FUSE::destroy;
-    ops_.fallocate       = FUSE::fallocate;
-    ops_.fchmod          = FUSE::fchmod;
-    ops_.fchown          = FUSE::fchown;
-    ops_.fgetattr        = FUSE::fgetattr;
+    ops_.fallocate       = OPSTATS_TIMED(FALLOCATE,FUSE::fallocate);
+    ops_.fchmod          = OPSTATS_TIMED(FCHMOD,FUSE::fchmod);
+    ops_.fchown          = OPSTATS_TIMED(FCHOWN,FUSE::fchown);
+    ops_.fgetattr        = OPSTATS_TIMED(FGETATTR,FUSE::fgetattr);
     ops_.flock           = NULL; // FUSE::flock;
-    ops_.flush           = FUSE::flush;
-    ops_.free_hide       = FUSE::free_hide;
-    ops_.fsync           = FUSE::fsync;
-    ops_.fsyncdir        = FUSE::fsyncdir;
-    ops_.ftruncate       = FUSE::ftruncate;
-    ops_.futimens        = FUSE::futimens;
-    ops_.getattr         = FUSE::getattr;
-    ops_.getxattr        = FUSE::getxattr;
+    ops_.flush           = OPSTATS_TIMED(FLUSH,FUSE::flush);
+    ops_.free_hide       = OPSTATS_TIMED(FREE_HIDE,FUSE::free_hide);
+    ops_.fsync           = OPSTATS_TIMED(FSYNC,FUSE::fsync);
+    ops_.fsyncdir        = OPSTATS_TIMED(FSYNCDIR,FUSE::fsyncdir);
+    ops_.ftruncate       = OPSTATS_TIMED(FTRUNCATE,FUSE::ftruncate);
+    ops_.futimens        = OPSTATS_TIMED(FUTIMENS,FUSE::futimens);
+    ops_.getattr         = OPSTATS_TIMED(GETATTR,FUSE::getattr);
+    ops_.getxattr        = OPSTATS_TIMED(GETXATTR,FUSE::getxattr);
     ops_.init            = FUSE::init;
-    ops_.ioctl           = FUSE::ioctl;
-    ops_.link            = FUSE::link;
-    ops_.listxattr       = FUSE::listxattr;
+    ops_.ioctl           = OPSTATS_TIMED(IOCTL,FUSE::ioctl);
+    ops_.link            = OPSTATS_TIMED(LINK,FUSE::link);
+    ops_.listxattr       = OPSTATS_TIMED(LISTXATTR,FUSE::listxattr);
     ops_.lock            = NULL;
-    ops_.mkdir           = FUSE::mkdir;
-    ops_.mknod           = FUSE::mknod;
-    ops_.open            = FUSE::open;
-    ops_.opendir         = FUSE::opendir;
+    ops_.mkdir           = OPSTATS_TIMED(MKDIR,FUSE::mkdir);
+    ops_.mknod           = OPSTATS_TIMED(MKNOD,FUSE::mknod);
+    ops_.open            = OPSTATS_TIMED(OPEN,FUSE::open);
+    ops_.opendir         = OPSTATS_TIMED(OPENDIR,FUSE::opendir);
     ops_.poll            = NULL;
-    ops_.prepare_hide    = FUSE::prepare_hide;
-    ops_.read            = (nullrw_ ? FUSE::read_null : FUSE::read);
-    ops_.read_buf        = (nullrw_ ? NULL : FUSE::read_buf);
-    ops_.readdir         = FUSE::readdir;
-    ops_.readdir_plus    = FUSE::readdir_plus;
-    ops_.readlink        = FUSE::readlink;
-    ops_.release         = FUSE::release;
-    ops_.releasedir      = FUSE::releasedir;
-    ops_.removexattr     = FUSE::removexattr;
-    ops_.rename          = FUSE::rename;
-    ops_.rmdir           = FUSE::rmdir;
-    ops_.setxattr        = FUSE::setxattr;
-    ops_.statfs          = FUSE::statfs;
-    ops_.symlink         = FUSE::symlink;
-    ops_.truncate        = FUSE::truncate;
-    ops_.unlink          = FUSE::unlink;
+    ops_.prepare_hide    = OPSTATS_TIMED(PREPARE_HIDE,FUSE::prepare_hide);
+    ops_.read            = (nullrw_ ?
+                            OPSTATS_TIMED(READ,FUSE::read_null) :
+                            OPSTATS_TIMED(READ,FUSE::read));
+    ops_.read_buf        = (nullrw_ ? NULL : OPSTATS_TIMED(READ,FUSE::read_buf));
+    ops_.readdir         = OPSTATS_TIMED(READDIR,FUSE::readdir);
+    ops_.readdir_plus    = OPSTATS_TIMED(READDIR_PLUS,FUSE::readdir_plus);
+    ops_.readlink        = OPSTATS_TIMED(READLINK,FUSE::readlink);
+    ops_.release         = OPSTATS_TIMED(RELEASE,FUSE::release);
+    ops_.releasedir      = OPSTATS_TIMED(RELEASEDIR,FUSE::releasedir);
+    ops_.removexattr     = OPSTATS_TIMED(REMOVEXATTR,FUSE::removexattr);
+    ops_.rename          = OPSTATS_TIMED(RENAME,FUSE::rename);
+    ops_.rmdir           = OPSTATS_TIMED(RMDIR,FUSE::rmdir);
+    ops_.setxattr        = OPSTATS_TIMED(SETXATTR,FUSE::setxattr);
+    ops_.statfs          = OPSTATS_TIMED(STATFS,FUSE::statfs);
+    ops_.symlink         = OPSTATS_TIMED(SYMLINK,FUSE::symlink);
+    ops_.truncate        = OPSTATS_TIMED(TRUNCATE,FUSE::truncate);
+    ops_.unlink          = OPSTATS_TIMED(UNLINK,FUSE::unlink);
     ops_.utime           = NULL; /* deprecated; use utimens() */
-    ops_.utimens         = FUSE::utimens;
-    ops_.write           = (nullrw_ ? FUSE::write_null : FUSE::write);
-    ops_.write_buf       = (nullrw_ ? FUSE::write_buf_null : FUSE::write_buf);
+    ops_.utimens         = OPSTATS_TIMED(UTIMENS,FUSE::utimens);
+    ops_.write           = (nullrw_ ?
+                            OPSTATS_TIMED(WRITE,FUSE::write_null) :
+                            OPSTATS_TIMED(WRITE,FUSE::write));
+    ops_.write_buf       = (nullrw_ ?
+                            OPSTATS_TIMED(WRITE,FUSE::write_buf_null) :
+                            OPSTATS_TIMED(WRITE,FUSE::write_buf));
 
     return;
   }
@@ -0,0 +1,1196 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "moveonenospc_async.hpp"
+
+#include "branchstats.hpp"
+#include "epoch.hpp"
+#include "errno.hpp"
+#include "fileinfo.hpp"
+#include "fs_attr.hpp"
+#include "fs_clonepath.hpp"
+#include "fs_close.hpp"
+#include "fs_copydata.hpp"
+#include "fs_dup.hpp"
+#include "fs_fchmod.hpp"
+#include "fs_fchown.hpp"
+#include "fs_file_size.hpp"
+#include "fs_findonfs.hpp"
+#include "fs_fstat.hpp"
+#include "fs_ftruncate.hpp"
+#include "fs_futimens.hpp"
+#include "fs_getfl.hpp"
+#include "fs_has_space.hpp"
+#include "fs_lseek.hpp"
+#include "fs_lstat.hpp"
+#include "fs_mktemp.hpp"
+#include "fs_open.hpp"
+#include "fs_path.hpp"
+#include "fs_read.hpp"
+#include "fs_rename.hpp"
+#include "fs_stat_utils.hpp"
+#include "fs_unlink.hpp"
+#include "fs_xattr.hpp"
+#include "ugid.hpp"
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#define MIGRATE_CHUNK_SIZE (4ULL * 1024ULL * 1024ULL)
+#define MIGRATE_BUF_SIZE   (1024ULL * 1024ULL)
+#define MIGRATE_BUF_ALIGN  (4096)
+
+using std::string;
+using std::vector;
+
+namespace moveonenospc
+{
+  // start offset -> end offset, non-overlapping
+  typedef std::map<uint64_t,uint64_t> Intervals;
+
+  /*
+    One reference is held by the FileInfo and one by the worker. All
+    fields other than refs, done, error and cfr are protected by lock.
+
+    [pos,copy_end) is the range the worker is copying without holding
+    the lock. Writes to it and truncation wait on cond until it's
+    done.
+
+    times are what the new file's atime and mtime should be once
+    copied into, which is the original's until written to or set.
+  */
+  class Migration
+  {
+  public:
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    std::atomic<int>  refs;
+    std::atomic<bool> done;
+    std::atomic<int>  error;
+    std::atomic<bool> cfr;
+    FileInfo         *fi;
+    int               oldfd;
+    int               newfd;
+    int               origfd;
+    int               branch;
+    string            fusepath;
+    string            oldpath;
+    string            newpath;
+    string            temppath;
+    uint64_t          size;
+    uint64_t          pos;
+    uint64_t          copy_end;
+    Intervals         dirty;
+    bool              keep_times;
+    struct timespec   times[2];
+  };
+}
+
+using moveonenospc::Migration;
+using moveonenospc::Intervals;
+
+namespace l
+{
+  static pthread_once_t        g_worker_once = PTHREAD_ONCE_INIT;
+  static pthread_mutex_t       g_lock        = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t        g_cond        = PTHREAD_COND_INITIALIZER;
+  static pthread_cond_t        g_idle        = PTHREAD_COND_INITIALIZER;
+  static std::deque<Migration*> g_incoming;
+
+  // fusepath -> migration, guarded by g_lock
+  static std::map<string,Migration*> g_paths;
+  static std::atomic<uint64_t>       g_paths_count(0);
+
+  static std::atomic<uint64_t> g_queued(0);
+  static std::atomic<uint64_t> g_active(0);
+  static std::atomic<uint64_t> g_completed(0);
+  static std::atomic<uint64_t> g_failed(0);
+  static std::atomic<uint64_t> g_bytes_copied(0);
+  static std::atomic<uint64_t> g_bytes_total(0);
+
+  static
+  Migration*
+  get(const FileInfo *fi_)
+  {
+    Migration *m;
+
+    m = fi_->migration.load(std::memory_order_acquire);
+    if((m == NULL) || m->done)
+      return NULL;
+
+    return m;
+  }
+
+  /*
+    The path registry holds no reference of its own. The last
+    reference is dropped under g_lock so a lookup never finds a
+    migration about to be freed.
+  */
+  static
+  void
+  unref(Migration *m_)
+  {
+    std::map<string,Migration*>::iterator i;
+
+    pthread_mutex_lock(&g_lock);
+    if(--m_->refs > 0)
+      {
+        pthread_mutex_unlock(&g_lock);
+        return;
+      }
+
+    i = g_paths.find(m_->fusepath);
+    if((i != g_paths.end()) && (i->second == m_))
+      {
+        g_paths.erase(i);
+        g_paths_count--;
+      }
+    pthread_mutex_unlock(&g_lock);
+
+    if(m_->oldfd != -1)
+      fs::close(m_->oldfd);
+    if(m_->newfd != -1)
+      fs::close(m_->newfd);
+    if(m_->origfd != -1)
+      fs::close(m_->origfd);
+    pthread_cond_destroy(&m_->cond);
+    pthread_mutex_destroy(&m_->lock);
+
+    delete m_;
+  }
+
+  /*
+    Mark [offset,end) as holding current data in the new file. Only
+    the part the copy has yet to reach matters.
+  */
+  static
+  void
+  mark_dirty(Migration *m_,
+             uint64_t   offset_,
+             uint64_t   end_)
+  {
+    Intervals::iterator i;
+
+    if(offset_ < m_->pos)
+      offset_ = m_->pos;
+    if(end_ > m_->size)
+      end_ = m_->size;
+    if(offset_ >= end_)
+      return;
+
+    i = m_->dirty.upper_bound(offset_);
+    if(i != m_->dirty.begin())
+      {
+        --i;
+        if(i->second < offset_)
+          ++i;
+      }
+
+    while((i != m_->dirty.end()) && (i->first <= end_))
+      {
+        if(i->first < offset_)
+          offset_ = i->first;
+        if(i->second > end_)
+          end_ = i->second;
+        m_->dirty.erase(i++);
+      }
+
+    m_->dirty[offset_] = end_;
+  }
+
+  /*
+    The parts of [offset,end) not written since the migration began.
+  */
+  static
+  void
+  clean_ranges(const Migration                         *m_,
+               uint64_t                                 offset_,
+               const uint64_t                           end_,
+               vector<std::pair<uint64_t,uint64_t> >   *ranges_)
+  {
+    Intervals::const_iterator i;
+
+    i = m_->dirty.upper_bound(offset_);
+    if(i != m_->dirty.begin())
+      {
+        --i;
+        if(i->second <= offset_)
+          ++i;
+      }
+
+    for(; (i != m_->dirty.end()) && (i->first < end_); ++i)
+      {
+        if(i->first > offset_)
+          ranges_->push_back(std::make_pair(offset_,i->first));
+        if(i->second > offset_)
+          offset_ = i->second;
+      }
+
+    if(offset_ < end_)
+      ranges_->push_back(std::make_pair(offset_,end_));
+  }
+
+  /*
+    Once a migration failed the new file is gone along with whatever
+    was written to it so the handle's I/O fails rather than silently
+    using the original.
+  */
+  static
+  inline
+  int
+  check(const Migration *m_)
+  {
+    if(m_->error == 0)
+      return 0;
+
+    errno = EIO;
+
+    return -1;
+  }
+
+  /*
+    Wait for the worker to finish the chunk it's copying if it
+    overlaps [offset,end).
+  */
+  static
+  void
+  wait_copy(Migration      *m_,
+            const uint64_t  offset_,
+            const uint64_t  end_)
+  {
+    while((m_->copy_end > m_->pos) &&
+          (offset_ < m_->copy_end) &&
+          (end_ > m_->pos))
+      pthread_cond_wait(&m_->cond,&m_->lock);
+  }
+
+  /*
+    Copy the next chunk of the original. Holes are skipped since the
+    new file was created sparse at the full size. The lock is dropped
+    while copying. Writes to the chunk wait for it so the copy can't
+    overwrite them and everything else carries on. Returns 1 when
+    there is nothing left to copy.
+  */
+  static
+  int
+  copy_step(Migration *m_,
+            char      *buf_)
+  {
+    int rv;
+    int err;
+    off_t data;
+    off_t hole;
+    uint64_t end;
+    vector<std::pair<uint64_t,uint64_t> > ranges;
+
+    pthread_mutex_lock(&m_->lock);
+    if(m_->pos >= m_->size)
+      goto done;
+
+    end = m_->size;
+#if defined SEEK_DATA && defined SEEK_HOLE
+    data = fs::lseek(m_->oldfd,m_->pos,SEEK_DATA);
+    if((data == -1) && (errno == ENXIO))
+      data = m_->size;
+    if((data != -1) && ((uint64_t)data > m_->pos))
+      {
+        if((uint64_t)data > m_->size)
+          data = m_->size;
+        g_bytes_copied += (data - m_->pos);
+        m_->pos = data;
+        if(m_->pos >= m_->size)
+          goto done;
+      }
+
+    hole = fs::lseek(m_->oldfd,m_->pos,SEEK_HOLE);
+    if((hole != -1) && ((uint64_t)hole < end))
+      end = hole;
+#endif
+
+    if((end - m_->pos) > MIGRATE_CHUNK_SIZE)
+      end = m_->pos + MIGRATE_CHUNK_SIZE;
+
+    l::clean_ranges(m_,m_->pos,end,&ranges);
+    m_->copy_end = end;
+    pthread_mutex_unlock(&m_->lock);
+
+    rv = 0;
+    for(size_t i = 0; i < ranges.size(); i++)
+      {
+        rv = fs::copydata_range(m_->oldfd,
+                                m_->newfd,
+                                ranges[i].first,
+                                ranges[i].second,
+                                &m_->cfr,
+                                buf_,
+                                MIGRATE_BUF_SIZE);
+        if(rv == -1)
+          break;
+      }
+    err = errno;
+
+    pthread_mutex_lock(&m_->lock);
+    if(rv == 0)
+      {
+        g_bytes_copied += (end - m_->pos);
+        m_->pos = end;
+        while(!m_->dirty.empty() && (m_->dirty.begin()->second <= m_->pos))
+          m_->dirty.erase(m_->dirty.begin());
+      }
+    m_->copy_end = m_->pos;
+    pthread_cond_broadcast(&m_->cond);
+    pthread_mutex_unlock(&m_->lock);
+
+    return ((rv == -1) ? (errno = err,-1) : 0);
+
+  done:
+    pthread_mutex_unlock(&m_->lock);
+    return 1;
+  }
+
+  /*
+    If every handle to the original was closed and it was unlinked
+    while copying there is nothing to keep. If oldpath no longer
+    names the original, because it was renamed directly on the
+    branch, renaming over newpath could clobber some other file so
+    the migration fails instead.
+  */
+  static
+  int
+  finish(Migration *m_)
+  {
+    int rv;
+    struct stat st;
+    struct stat pathst;
+    const ugid::Set ugid(0,0);
+
+    rv = fs::fstat(m_->oldfd,&st);
+    if(rv == -1)
+      return -1;
+    if(st.st_nlink == 0)
+      return fs::unlink(m_->temppath);
+
+    rv = fs::lstat(m_->oldpath,&pathst);
+    if(rv == -1)
+      return -1;
+    if((pathst.st_dev != st.st_dev) || (pathst.st_ino != st.st_ino))
+      return (errno = ESTALE,-1);
+
+    rv = fs::attr::copy(m_->oldfd,m_->newfd);
+    if((rv == -1) && (errno != ENOTTY) && (errno != ENOTSUP))
+      return -1;
+
+    if(m_->keep_times)
+      fs::futimens(m_->newfd,m_->times);
+
+    rv = fs::rename(m_->temppath,m_->newpath);
+    if(rv == -1)
+      return -1;
+
+    // should we care if it fails?
+    fs::unlink(m_->oldpath);
+
+    return 0;
+  }
+
+  /*
+    Until every request which may have seen the handle without a
+    migration has completed the original can still be written
+    through the old descriptor. Only then is the handle switched over
+    and the copy allowed to start.
+  */
+  static
+  int
+  activate(Migration *m_)
+  {
+    int fd;
+
+    fd = 0;
+    pthread_mutex_lock(&m_->lock);
+    if(m_->fi != NULL)
+      {
+        fd = fs::dup(m_->newfd);
+        if(fd != -1)
+          {
+            m_->origfd     = m_->fi->fd;
+            m_->fi->fd     = fd;
+            m_->fi->branch = m_->branch;
+          }
+      }
+    pthread_mutex_unlock(&m_->lock);
+
+    return ((fd == -1) ? -1 : 0);
+  }
+
+  /*
+    Writes since the migration began exist only in the temporary file
+    and there is no space to put them back in the original. Rather
+    than leave a partial copy behind and let the handle quietly carry
+    on with the original it's removed and the handle's I/O fails.
+  */
+  static
+  void
+  fail(Migration *m_,
+       const int  err_)
+  {
+    const ugid::Set ugid(0,0);
+
+    pthread_mutex_lock(&m_->lock);
+    m_->error    = ((err_ == 0) ? EIO : err_);
+    m_->copy_end = m_->pos;
+    pthread_cond_broadcast(&m_->cond);
+    pthread_mutex_unlock(&m_->lock);
+
+    fs::unlink(m_->temppath);
+
+    syslog(LOG_ERR,
+           "moveonenospc: moving %s to %s failed - %s. Data written "
+           "since the move began is lost and further I/O on the file "
+           "handle will fail with EIO",
+           m_->oldpath.c_str(),
+           m_->newpath.c_str(),
+           strerror(m_->error));
+  }
+
+  static
+  void
+  complete(Migration *m_,
+           const bool ok_)
+  {
+    std::map<string,Migration*>::iterator i;
+
+    pthread_mutex_lock(&g_lock);
+    if(ok_)
+      m_->done = true;
+    i = g_paths.find(m_->fusepath);
+    if((i != g_paths.end()) && (i->second == m_))
+      {
+        g_paths.erase(i);
+        g_paths_count--;
+      }
+
+    g_active--;
+    if(ok_)
+      g_completed++;
+    else
+      g_failed++;
+    pthread_cond_broadcast(&g_idle);
+    pthread_mutex_unlock(&g_lock);
+
+    l::unref(m_);
+  }
+
+  static
+  void*
+  worker(void *arg_)
+  {
+    int rv;
+    void *buf;
+    Migration *m;
+    Migration *current;
+    std::deque<Migration*> failed;
+    std::deque<Migration*> incoming;
+    std::deque<Migration*> queue;
+
+    current = NULL;
+    if(posix_memalign(&buf,MIGRATE_BUF_ALIGN,MIGRATE_BUF_SIZE) != 0)
+      buf = NULL;
+
+    for(;;)
+      {
+        pthread_mutex_lock(&g_lock);
+        while(g_incoming.empty() && queue.empty())
+          pthread_cond_wait(&g_cond,&g_lock);
+        incoming.swap(g_incoming);
+        pthread_mutex_unlock(&g_lock);
+
+        if(!incoming.empty())
+          {
+            epoch::synchronize();
+            while(!incoming.empty())
+              {
+                m = incoming.front();
+                incoming.pop_front();
+                rv = l::activate(m);
+                if(rv == -1)
+                  {
+                    l::fail(m,errno);
+                    failed.push_back(m);
+                  }
+                else
+                  {
+                    queue.push_back(m);
+                  }
+              }
+          }
+
+        while(!failed.empty())
+          {
+            g_active++;
+            g_queued--;
+            l::complete(failed.front(),false);
+            failed.pop_front();
+          }
+
+        if(queue.empty())
+          continue;
+
+        m = queue.front();
+        if(m != current)
+          {
+            g_active++;
+            g_queued--;
+            current = m;
+          }
+
+        // one chunk at a time so new arrivals get switched over promptly
+        rv = ((buf == NULL) ? (errno = ENOMEM,-1) : l::copy_step(m,(char*)buf));
+        if(rv == 0)
+          continue;
+
+        if(rv == 1)
+          {
+            pthread_mutex_lock(&m->lock);
+            rv = ((l::finish(m) == 0) ? 1 : -1);
+            pthread_mutex_unlock(&m->lock);
+          }
+        if(rv == -1)
+          l::fail(m,errno);
+
+        queue.pop_front();
+        current = NULL;
+        l::complete(m,(rv == 1));
+      }
+
+    return NULL;
+  }
+
+  static
+  void
+  worker_start(void)
+  {
+    int rv;
+    pthread_t thread;
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+    rv = pthread_create(&thread,&attr,l::worker,NULL);
+    if(rv != 0)
+      abort();
+    pthread_attr_destroy(&attr);
+  }
+
+  /*
+    The migration of fusepath, if any, with a reference taken.
+  */
+  static
+  Migration*
+  lookup(const char *fusepath_)
+  {
+    Migration *m;
+    std::map<string,Migration*>::iterator i;
+
+    if(g_paths_count == 0)
+      return NULL;
+
+    pthread_mutex_lock(&g_lock);
+    i = g_paths.find(fusepath_);
+    m = ((i == g_paths.end()) ? NULL : i->second);
+    if(m != NULL)
+      m->refs++;
+    pthread_mutex_unlock(&g_lock);
+
+    return m;
+  }
+
+  static
+  int
+  fchmod(Migration    *m_,
+         const mode_t  mode_)
+  {
+    int rv;
+
+    pthread_mutex_lock(&m_->lock);
+    rv = l::check(m_);
+    if(rv == 0)
+      rv = fs::fchmod(m_->newfd,mode_);
+    pthread_mutex_unlock(&m_->lock);
+
+    return rv;
+  }
+
+  static
+  int
+  fchown(Migration   *m_,
+         const uid_t  uid_,
+         const gid_t  gid_)
+  {
+    int rv;
+
+    pthread_mutex_lock(&m_->lock);
+    rv = l::check(m_);
+    if(rv == 0)
+      rv = fs::fchown(m_->newfd,uid_,gid_);
+    pthread_mutex_unlock(&m_->lock);
+
+    return rv;
+  }
+
+  /*
+    The copy writing into the new file moves its mtime so the result
+    is remembered and applied again when the copy finishes.
+  */
+  static
+  int
+  futimens(Migration             *m_,
+           const struct timespec  ts_[2])
+  {
+    int rv;
+    struct stat st;
+
+    pthread_mutex_lock(&m_->lock);
+    rv = l::check(m_);
+    if(rv == 0)
+      rv = fs::futimens(m_->newfd,ts_);
+    if((rv == 0) && (fs::fstat(m_->newfd,&st) == 0))
+      {
+        m_->times[0]   = *fs::stat_atime(&st);
+        m_->times[1]   = *fs::stat_mtime(&st);
+        m_->keep_times = true;
+      }
+    pthread_mutex_unlock(&m_->lock);
+
+    return rv;
+  }
+
+  static
+  Migration*
+  prepare(Policy::Func::Create  createFunc_,
+          const Branches       &branches_,
+          FileInfo             *fi_)
+  {
+    int rv;
+    int err;
+    int flags;
+    int64_t size;
+    string fusedir;
+    struct stat st;
+    vector<string> newpath;
+    Migration *m;
+
+    m = new Migration();
+    m->refs   = 2;
+    m->done   = false;
+    m->error  = 0;
+    m->fi     = fi_;
+    m->oldfd  = -1;
+    m->newfd  = -1;
+    m->origfd = -1;
+    m->cfr    = true;
+    m->pos    = 0;
+    m->copy_end   = 0;
+    m->keep_times = false;
+    m->fusepath   = fi_->fusepath;
+    pthread_mutex_init(&m->lock,NULL);
+    pthread_cond_init(&m->cond,NULL);
+
+    flags = fs::getfl(fi_->fd);
+    if(flags == -1)
+      goto error;
+
+    rv = fs::findonfs(branches_,fi_->fusepath,fi_->fd,&m->oldpath);
+    if(rv == -1)
+      goto error;
+
+    rv = createFunc_(branches_,fi_->fusepath,&newpath);
+    if(rv == -1)
+      goto error;
+
+    size = fs::file_size(fi_->fd);
+    if(size == -1)
+      goto error;
+
+    if(fs::has_space(newpath[0],size) == false)
+      {
+        errno = ENOSPC;
+        goto error;
+      }
+
+    fusedir = fs::path::dirname(fi_->fusepath);
+    rv = fs::clonepath(m->oldpath,newpath[0],fusedir);
+    if(rv == -1)
+      goto error;
+
+    fs::path::append(m->oldpath,fi_->fusepath);
+    m->oldfd = fs::open(m->oldpath,O_RDONLY);
+    if(m->oldfd == -1)
+      goto error;
+
+    m->branch = branchstats::index(newpath[0]);
+    fs::path::append(newpath[0],fi_->fusepath);
+    m->newpath  = newpath[0];
+    m->temppath = newpath[0];
+    m->newfd = fs::mktemp(&m->temppath,flags);
+    if(m->newfd == -1)
+      goto error;
+
+    rv = fs::fstat(m->oldfd,&st);
+    if(rv == -1)
+      goto error_unlink;
+
+    m->size       = st.st_size;
+    m->times[0]   = *fs::stat_atime(&st);
+    m->times[1]   = *fs::stat_mtime(&st);
+    m->keep_times = true;
+    rv = fs::ftruncate(m->newfd,m->size);
+    if(rv == -1)
+      goto error_unlink;
+
+    rv = fs::xattr::copy(m->oldfd,m->newfd);
+    if((rv == -1) && (errno != ENOTTY) && (errno != ENOTSUP))
+      goto error_unlink;
+
+    rv = fs::fchown_check_on_error(m->newfd,st);
+    if(rv == -1)
+      goto error_unlink;
+
+    rv = fs::fchmod_check_on_error(m->newfd,st);
+    if(rv == -1)
+      goto error_unlink;
+
+    return m;
+
+  error_unlink:
+    err = errno;
+    fs::unlink(m->temppath);
+    errno = err;
+  error:
+    err = errno;
+    m->refs = 1;
+    l::unref(m);
+    errno = err;
+    return NULL;
+  }
+}
+
+namespace moveonenospc
+{
+  int
+  start(const Policy   *policy_,
+        const Branches &branches_,
+        FileInfo       *fi_)
+  {
+    int rv;
+    Migration *m;
+    Migration *expected;
+    const ugid::Set ugid(0,0);
+
+    if(fi_->migration.load(std::memory_order_acquire) != NULL)
+      return 0;
+
+    m = l::prepare(policy_,branches_,fi_);
+    if(m == NULL)
+      return -1;
+
+    /*
+      Another handle to the same file migrating would leave two
+      copies racing to replace the original.
+    */
+    expected = NULL;
+    pthread_mutex_lock(&l::g_lock);
+    if(l::g_paths.count(m->fusepath))
+      rv = ENOSPC;
+    else if(!fi_->migration.compare_exchange_strong(expected,m))
+      rv = EEXIST;
+    else
+      rv = 0;
+    if(rv != 0)
+      {
+        pthread_mutex_unlock(&l::g_lock);
+        fs::unlink(m->temppath);
+        m->refs = 1;
+        l::unref(m);
+        return ((rv == EEXIST) ? 0 : (errno = rv,-1));
+      }
+
+    l::g_paths[m->fusepath] = m;
+    l::g_paths_count++;
+    l::g_bytes_total += m->size;
+    l::g_queued++;
+    pthread_once(&l::g_worker_once,l::worker_start);
+    l::g_incoming.push_back(m);
+    pthread_cond_signal(&l::g_cond);
+    pthread_mutex_unlock(&l::g_lock);
+
+    return 0;
+  }
+
+  int
+  stat(const char  *fusepath_,
+       struct stat *st_)
+  {
+    int rv;
+    Migration *m;
+
+    m = l::lookup(fusepath_);
+    if(m == NULL)
+      return (errno = ENOENT,-1);
+
+    rv = fs::fstat(m->newfd,st_);
+
+    l::unref(m);
+
+    return rv;
+  }
+
+  bool
+  active(const FileInfo *fi_)
+  {
+    return (l::get(fi_) != NULL);
+  }
+
+  /*
+    Whether fusepath, or if a directory anything below it, is being
+    migrated.
+  */
+  bool
+  busy(const char *fusepath_)
+  {
+    bool rv;
+    string prefix;
+    std::map<string,Migration*>::const_iterator i;
+
+    if(l::g_paths_count == 0)
+      return false;
+
+    prefix = fusepath_;
+    if(prefix != "/")
+      prefix += '/';
+
+    pthread_mutex_lock(&l::g_lock);
+    rv = (l::g_paths.count(fusepath_) != 0);
+    if(!rv)
+      {
+        i  = l::g_paths.lower_bound(prefix);
+        rv = ((i != l::g_paths.end()) &&
+              (i->first.compare(0,prefix.size(),prefix) == 0));
+      }
+    pthread_mutex_unlock(&l::g_lock);
+
+    return rv;
+  }
+
+  void
+  release(FileInfo *fi_)
+  {
+    Migration *m;
+
+    m = fi_->migration.exchange(NULL);
+    if(m == NULL)
+      return;
+
+    pthread_mutex_lock(&m->lock);
+    m->fi = NULL;
+    pthread_mutex_unlock(&m->lock);
+
+    l::unref(m);
+  }
+
+  /*
+    Until a migration finishes writes made since it began exist only
+    in the temporary file so unmounting has to wait for it.
+  */
+  void
+  drain(void)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    while((l::g_queued + l::g_active) > 0)
+      pthread_cond_wait(&l::g_idle,&l::g_lock);
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  void
+  stats(Stats *stats_)
+  {
+    stats_->queued       = l::g_queued;
+    stats_->active       = l::g_active;
+    stats_->completed    = l::g_completed;
+    stats_->failed       = l::g_failed;
+    stats_->bytes_copied = l::g_bytes_copied;
+    stats_->bytes_total  = l::g_bytes_total;
+  }
+
+  int
+  write_fd(FileInfo     *fi_,
+           const off_t   offset_,
+           const size_t  count_)
+  {
+    Migration *m;
+
+    m = l::get(fi_);
+    if(m == NULL)
+      return fi_->fd;
+
+    pthread_mutex_lock(&m->lock);
+    l::wait_copy(m,offset_,offset_ + count_);
+    if(l::check(m) == -1)
+      {
+        pthread_mutex_unlock(&m->lock);
+        return -1;
+      }
+    l::mark_dirty(m,offset_,offset_ + count_);
+    m->keep_times = false;
+    pthread_mutex_unlock(&m->lock);
+
+    return m->newfd;
+  }
+
+  int
+  data_fd(FileInfo *fi_)
+  {
+    Migration *m;
+
+    m = l::get(fi_);
+    if(m == NULL)
+      return fi_->fd;
+    if(l::check(m) == -1)
+      return -1;
+
+    return m->newfd;
+  }
+
+  /*
+    The new file is read first and then anything the copy has yet to
+    reach, and which was not since written, is overlaid from the
+    original.
+  */
+  int
+  read(FileInfo     *fi_,
+       char         *buf_,
+       const size_t  count_,
+       const off_t   offset_)
+  {
+    ssize_t rv;
+    ssize_t n;
+    uint64_t begin;
+    uint64_t end;
+    Migration *m;
+    vector<std::pair<uint64_t,uint64_t> > ranges;
+
+    m = l::get(fi_);
+    if(m == NULL)
+      return fs::pread(fi_->fd,buf_,count_,offset_);
+
+    pthread_mutex_lock(&m->lock);
+
+    n = l::check(m);
+    if(n == -1)
+      goto out;
+
+    n = fs::pread(m->newfd,buf_,count_,offset_);
+    if(n == -1)
+      goto out;
+
+    begin = ((m->pos > (uint64_t)offset_) ? m->pos : offset_);
+    end   = offset_ + n;
+    if(end > m->size)
+      end = m->size;
+    if(begin < end)
+      l::clean_ranges(m,begin,end,&ranges);
+
+    for(size_t i = 0; i < ranges.size(); i++)
+      {
+        rv = fs::pread(m->oldfd,
+                       &buf_[ranges[i].first - offset_],
+                       ranges[i].second - ranges[i].first,
+                       ranges[i].first);
+        if(rv == -1)
+          {
+            n = -1;
+            break;
+          }
+      }
+
+  out:
+    pthread_mutex_unlock(&m->lock);
+
+    return n;
+  }
+
+  int
+  fstat(FileInfo    *fi_,
+        struct stat *st_)
+  {
+    Migration *m;
+
+    m = l::get(fi_);
+    if(m == NULL)
+      return fs::fstat(fi_->fd,st_);
+    if(l::check(m) == -1)
+      return -1;
+
+    return fs::fstat(m->newfd,st_);
+  }
+
+  int
+  ftruncate(FileInfo    *fi_,
+            const off_t  size_)
+  {
+    int rv;
+    Migration *m;
+
+    m = l::get(fi_);
+    if(m == NULL)
+      return fs::ftruncate(fi_->fd,size_);
+
+    pthread_mutex_lock(&m->lock);
+    l::wait_copy(m,0,UINT64_MAX);
+    rv = l::check(m);
+    if(rv == 0)
+      rv = fs::ftruncate(m->newfd,size_);
+    if(rv == 0)
+      m->keep_times = false;
+    if((rv == 0) && ((uint64_t)size_ < m->size))
+      m->size = size_;
+    pthread_mutex_unlock(&m->lock);
+
+    return rv;
+  }
+
+  /*
+    Through the handle mode, ownership and times are applied to both
+    files so other handles to the original see them as well. The
+    original's are best effort.
+  */
+  int
+  fchmod(FileInfo     *fi_,
+         const mode_t  mode_)
+  {
+    int rv;
+    Migration *m;
+
+    m = l::get(fi_);
+    if(m == NULL)
+      return fs::fchmod(fi_->fd,mode_);
+
+    rv = l::fchmod(m,mode_);
+    if(rv == 0)
+      fs::fchmod(m->oldfd,mode_);
+
+    return rv;
+  }
+
+  int
+  fchown(FileInfo    *fi_,
+         const uid_t  uid_,
+         const gid_t  gid_)
+  {
+    int rv;
+    Migration *m;
+
+    m = l::get(fi_);
+    if(m == NULL)
+      return fs::fchown(fi_->fd,uid_,gid_);
+
+    rv = l::fchown(m,uid_,gid_);
+    if(rv == 0)
+      fs::fchown(m->oldfd,uid_,gid_);
+
+    return rv;
+  }
+
+  int
+  futimens(FileInfo              *fi_,
+           const struct timespec  ts_[2])
+  {
+    int rv;
+    Migration *m;
+
+    m = l::get(fi_);
+    if(m == NULL)
+      return fs::futimens(fi_->fd,ts_);
+
+    rv = l::futimens(m,ts_);
+    if(rv == 0)
+      fs::futimens(m->oldfd,ts_);
+
+    return rv;
+  }
+
+  /*
+    The path based versions are called after the original was
+    changed by path and only need to update the new file.
+  */
+  void
+  chmod(const char   *fusepath_,
+        const mode_t  mode_)
+  {
+    Migration *m;
+
+    m = l::lookup(fusepath_);
+    if(m == NULL)
+      return;
+
+    l::fchmod(m,mode_);
+
+    l::unref(m);
+  }
+
+  void
+  chown(const char  *fusepath_,
+        const uid_t  uid_,
+        const gid_t  gid_)
+  {
+    Migration *m;
+
+    m = l::lookup(fusepath_);
+    if(m == NULL)
+      return;
+
+    l::fchown(m,uid_,gid_);
+
+    l::unref(m);
+  }
+
+  void
+  utimens(const char            *fusepath_,
+          const struct timespec  ts_[2])
+  {
+    Migration *m;
+
+    m = l::lookup(fusepath_);
+    if(m == NULL)
+      return;
+
+    l::futimens(m,ts_);
+
+    l::unref(m);
+  }
+}
@@ -0,0 +1,111 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "branch.hpp"
+#include "policy.hpp"
+
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+class FileInfo;
+
+/*
+  Background migration for moveonenospc.
+
+  On ENOSPC the file is not copied inside the write request. A
+  temporary file is created on the branch chosen by the policy and
+  writes are sent there right away while the existing data is copied
+  behind them. Ranges written during the copy are remembered so the
+  copy never overwrites them and reads are served from whichever file
+  holds the current data. Once the copy finishes the temporary file
+  is renamed over the destination and the original unlinked. Renames
+  of the file, or a directory above it, are refused with EBUSY until
+  then.
+
+  The accessors fall back to the handle's own descriptor when no
+  migration is active. If the copy fails they fail with EIO for the
+  rest of the handle's life. Writes, which includes truncation and
+  allocation, must hold an epoch::ReadGuard from the moment they
+  call write_fd() until the write completes. The switch over of the
+  handle waits on those guards so no write to the original can be
+  missed by the copy.
+*/
+namespace moveonenospc
+{
+  struct Stats
+  {
+    uint64_t queued;
+    uint64_t active;
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t bytes_copied;
+    uint64_t bytes_total;
+  };
+
+  int  start(const Policy   *policy,
+             const Branches &branches,
+             FileInfo       *fi);
+  bool active(const FileInfo *fi);
+  bool busy(const char *fusepath);
+  int  stat(const char  *fusepath,
+            struct stat *st);
+  void release(FileInfo *fi);
+  void drain(void);
+  void stats(Stats *stats);
+
+  int write_fd(FileInfo     *fi,
+               const off_t   offset,
+               const size_t  count);
+  int data_fd(FileInfo *fi);
+
+  int read(FileInfo     *fi,
+           char         *buf,
+           const size_t  count,
+           const off_t   offset);
+
+  int fstat(FileInfo    *fi,
+            struct stat *st);
+
+  int ftruncate(FileInfo    *fi,
+                const off_t  size);
+
+  int fchmod(FileInfo     *fi,
+             const mode_t  mode);
+
+  int fchown(FileInfo    *fi,
+             const uid_t  uid,
+             const gid_t  gid);
+
+  int futimens(FileInfo              *fi,
+               const struct timespec  ts[2]);
+
+  void chmod(const char   *fusepath,
+             const mode_t  mode);
+  void chown(const char  *fusepath,
+             const uid_t  uid,
+             const gid_t  gid);
+  void utimens(const char            *fusepath,
+               const struct timespec  ts[2]);
+}
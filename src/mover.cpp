@@ -0,0 +1,467 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "mover.hpp"
+
+#include "config.hpp"
+#include "errno.hpp"
+#include "fs_attr.hpp"
+#include "fs_clonepath.hpp"
+#include "fs_close.hpp"
+#include "fs_copydata_copy_file_range.hpp"
+#include "fs_copydata_readwrite.hpp"
+#include "fs_exists.hpp"
+#include "fs_fchmod.hpp"
+#include "fs_fchown.hpp"
+#include "fs_ficlone.hpp"
+#include "fs_fstat.hpp"
+#include "fs_ftruncate.hpp"
+#include "fs_futimens.hpp"
+#include "fs_lseek.hpp"
+#include "fs_lstat.hpp"
+#include "fs_mktemp.hpp"
+#include "fs_open.hpp"
+#include "fs_path.hpp"
+#include "fs_rename.hpp"
+#include "fs_statvfs.hpp"
+#include "fs_unlink.hpp"
+#include "fs_xattr.hpp"
+#include "statvfs_util.hpp"
+
+#include <string>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef O_NOATIME
+#define O_NOATIME 0
+#endif
+
+using std::string;
+using mover::Result;
+
+namespace l
+{
+  static
+  uint64_t
+  now(void)
+  {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+
+    return ((ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000ULL));
+  }
+
+  /*
+    A write lease can only be taken when no one else has the file
+    open and any later open blocks until the lease is released or
+    broken. The break notification is redirected to SIGURG, which is
+    ignored by default, and polled for with F_GETLEASE.
+  */
+  static
+  int
+  lease(const int fd_)
+  {
+#if defined F_SETLEASE && defined F_SETSIG
+    int rv;
+
+    rv = ::fcntl(fd_,F_SETSIG,SIGURG);
+    if(rv == -1)
+      return -1;
+
+    return ::fcntl(fd_,F_SETLEASE,F_WRLCK);
+#else
+    return (errno=ENOTSUP,-1);
+#endif
+  }
+
+  static
+  bool
+  lease_held(const int fd_)
+  {
+#if defined F_GETLEASE
+    return (::fcntl(fd_,F_GETLEASE) == F_WRLCK);
+#else
+    return false;
+#endif
+  }
+
+  static
+  void
+  unlease(const int fd_)
+  {
+#if defined F_SETLEASE
+    ::fcntl(fd_,F_SETLEASE,F_UNLCK);
+#endif
+  }
+
+  /*
+    Sleeps in short slices so the job being interrupted, or someone
+    opening the file and breaking the lease, is noticed promptly.
+    Returns MOVED if the move may carry on.
+  */
+  static
+  Result
+  sleep(uint64_t    usecs_,
+        const int   fd_,
+        mover::Job *job_)
+  {
+    uint64_t slice;
+
+    for(;;)
+      {
+        if(!job_->proceed())
+          return Result::INTERRUPTED;
+        if(!l::lease_held(fd_))
+          return Result::SKIPPED;
+        if(usecs_ == 0)
+          return Result::MOVED;
+
+        slice = ((usecs_ > 100000) ? 100000 : usecs_);
+        ::usleep(slice);
+        usecs_ -= slice;
+      }
+  }
+
+  static
+  Result
+  copy(const int            fdin_,
+       const int            fdout_,
+       const uint64_t       size_,
+       char                *buf_,
+       mover::Throttle     *throttle_,
+       const mover::Limits &limits_,
+       mover::Job          *job_)
+  {
+    int rv;
+    bool cfr;
+    off_t data;
+    off_t hole;
+    uint64_t end;
+    uint64_t start;
+    uint64_t offset;
+    Result res;
+
+    rv = fs::ficlone(fdin_,fdout_);
+    if(rv == 0)
+      return l::sleep(throttle_->delay(0,limits_),fdin_,job_);
+
+    cfr = true;
+    offset = 0;
+    while(offset < size_)
+      {
+        end = size_;
+#if defined SEEK_DATA && defined SEEK_HOLE
+        data = fs::lseek(fdin_,offset,SEEK_DATA);
+        if((data == -1) && (errno == ENXIO))
+          break;
+        if((data != -1) && ((uint64_t)data > offset))
+          offset = data;
+        if(offset >= size_)
+          break;
+
+        hole = fs::lseek(fdin_,offset,SEEK_HOLE);
+        if((hole != -1) && ((uint64_t)hole < end))
+          end = hole;
+#endif
+        if((end - offset) > mover::BUF_SIZE)
+          end = offset + mover::BUF_SIZE;
+
+        res = l::sleep(throttle_->delay(end - offset,limits_),fdin_,job_);
+        if(res != Result::MOVED)
+          return res;
+
+        start = offset;
+        rv = -1;
+        if(cfr)
+          {
+            rv = fs::copydata_copy_file_range(fdin_,fdout_,&offset,end);
+            if(rv == -1)
+              cfr = false;
+          }
+        if(rv == -1)
+          rv = fs::copydata_readwrite(fdin_,
+                                      fdout_,
+                                      &offset,
+                                      end,
+                                      buf_,
+                                      mover::BUF_SIZE);
+        if(rv == -1)
+          return Result::FAILED;
+
+        job_->copied(end - start);
+      }
+
+    return Result::MOVED;
+  }
+
+  // opens mustn't be sent to the old location
+  static
+  void
+  forget(const string &relpath_)
+  {
+    Config::Read cfg;
+
+    cfg->open_cache.erase(relpath_.c_str());
+  }
+
+  static
+  bool
+  ignorable_error(const int err_)
+  {
+    return ((err_ == ENOTTY) ||
+            (err_ == ENOTSUP) ||
+            (err_ == EOPNOTSUPP));
+  }
+}
+
+namespace mover
+{
+  void
+  snapshot(const Branches &branches_,
+           BranchInfoVec  *infos_)
+  {
+    BranchInfo bi;
+    Branches::Snapshot branches(branches_);
+
+    infos_->clear();
+    for(size_t i = 0; i < branches.vec.size(); i++)
+      {
+        const Branch &b = branches.vec[i];
+
+        bi.path         = b.path;
+        bi.tier         = b.tier;
+        bi.src          = !b.ro();
+        bi.dst          = !b.ro_or_nc();
+        bi.minfreespace = b.minfreespace();
+        bi.used         = 0;
+        bi.avail        = 0;
+
+        infos_->push_back(bi);
+      }
+  }
+
+  int
+  update(BranchInfo *bi_)
+  {
+    int rv;
+    struct statvfs st;
+
+    rv = fs::statvfs(bi_->path,&st);
+    if(rv == -1)
+      return -1;
+
+    bi_->used  = StatVFS::spaceused(st);
+    bi_->avail = StatVFS::spaceavail(st);
+    if(StatVFS::readonly(st))
+      bi_->src = bi_->dst = false;
+
+    return 0;
+  }
+
+  uint64_t
+  percent_used(const uint64_t used_,
+               const uint64_t avail_)
+  {
+    if((used_ + avail_) == 0)
+      return 0;
+
+    return ((used_ * 10000ULL) / (used_ + avail_));
+  }
+
+  uint64_t
+  percent_used(const BranchInfo &bi_)
+  {
+    return mover::percent_used(bi_.used,bi_.avail);
+  }
+
+  Throttle::Throttle()
+  {
+    reset();
+  }
+
+  void
+  Throttle::reset(void)
+  {
+    _start = l::now();
+    _bytes = 0;
+    _ops   = 0;
+  }
+
+  uint64_t
+  Throttle::delay(const uint64_t  bytes_,
+                  const Limits   &limits_)
+  {
+    uint64_t target;
+    uint64_t elapsed;
+
+    _bytes += bytes_;
+    _ops   += 1;
+
+    target = 0;
+    if(limits_.rate)
+      target = ((_bytes * 1000000ULL) / limits_.rate);
+    if(limits_.iops && (((_ops * 1000000ULL) / limits_.iops) > target))
+      target = ((_ops * 1000000ULL) / limits_.iops);
+
+    elapsed = (l::now() - _start);
+    if(elapsed > (target + 1000000ULL))
+      {
+        reset();
+        return 0;
+      }
+
+    return ((target > elapsed) ? (target - elapsed) : 0);
+  }
+
+  /*
+    Only regular, non-empty files with a single link which don't
+    already exist on the destination are considered. Just before
+    replacing it the source is checked to still be the same,
+    unchanged file.
+  */
+  Result
+  move(const string &srcbase_,
+       const string &dstbase_,
+       const string &relpath_,
+       char         *buf_,
+       Throttle     *throttle_,
+       const Limits &limits_,
+       Job          *job_,
+       struct stat  *st_)
+  {
+    int rv;
+    int fdin;
+    int fdout;
+    Result res;
+    string srcpath;
+    string dstpath;
+    string tmppath;
+    struct stat now;
+    struct stat &st = *st_;
+
+    srcpath = fs::path::make(srcbase_,relpath_);
+    dstpath = fs::path::make(dstbase_,relpath_);
+
+    if(fs::exists(dstpath))
+      return Result::SKIPPED;
+
+    fdin = fs::open(srcpath,O_RDONLY|O_NOFOLLOW|O_NONBLOCK|O_NOATIME);
+    if(fdin == -1)
+      return Result::SKIPPED;
+
+    res = Result::SKIPPED;
+    fdout = -1;
+    rv = fs::fstat(fdin,&st);
+    if((rv == -1) ||
+       !S_ISREG(st.st_mode) ||
+       (st.st_nlink != 1) ||
+       (st.st_size == 0) ||
+       !job_->accept(st))
+      goto out;
+
+    rv = l::lease(fdin);
+    if(rv == -1)
+      goto out;
+
+    res = Result::FAILED;
+    rv = fs::clonepath(srcbase_,dstbase_,fs::path::dirname(relpath_));
+    if(rv == -1)
+      goto out;
+
+    tmppath = dstpath;
+    fdout = fs::mktemp(&tmppath,O_WRONLY);
+    if(fdout == -1)
+      goto out;
+
+    rv = fs::ftruncate(fdout,st.st_size);
+    if(rv == -1)
+      goto out_unlink;
+
+    res = l::copy(fdin,fdout,st.st_size,buf_,throttle_,limits_,job_);
+    if(res != Result::MOVED)
+      goto out_unlink;
+
+    res = Result::FAILED;
+    rv = fs::attr::copy(fdin,fdout);
+    if((rv == -1) && !l::ignorable_error(errno))
+      goto out_unlink;
+    rv = fs::xattr::copy(fdin,fdout);
+    if((rv == -1) && !l::ignorable_error(errno))
+      goto out_unlink;
+    rv = fs::fchown_check_on_error(fdout,st);
+    if(rv == -1)
+      goto out_unlink;
+    rv = fs::fchmod_check_on_error(fdout,st);
+    if(rv == -1)
+      goto out_unlink;
+    rv = fs::futimens(fdout,st);
+    if(rv == -1)
+      goto out_unlink;
+
+    res = Result::SKIPPED;
+    rv = fs::lstat(srcpath,&now);
+    if((rv == -1) ||
+       (now.st_ino != st.st_ino) ||
+       (now.st_dev != st.st_dev) ||
+       (now.st_size != st.st_size) ||
+       (now.st_ctim.tv_sec != st.st_ctim.tv_sec) ||
+       (now.st_ctim.tv_nsec != st.st_ctim.tv_nsec) ||
+       !l::lease_held(fdin))
+      goto out_unlink;
+
+    res = Result::FAILED;
+    rv = fs::rename(tmppath,dstpath);
+    if(rv == -1)
+      goto out_unlink;
+
+    /*
+      An open of the source during the rename breaks the lease. The
+      copy is taken back and the source kept. Only an open between
+      this check and the unlink can still end up on the unlinked
+      original.
+    */
+    res = Result::SKIPPED;
+    if(!l::lease_held(fdin))
+      {
+        fs::unlink(dstpath);
+        goto out;
+      }
+
+    fs::unlink(srcpath);
+    l::forget(relpath_);
+
+    res = Result::MOVED;
+    goto out;
+
+  out_unlink:
+    fs::unlink(tmppath);
+  out:
+    if(fdout != -1)
+      fs::close(fdout);
+    l::unlease(fdin);
+    fs::close(fdin);
+
+    return res;
+  }
+}
@@ -0,0 +1,122 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "branch.hpp"
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/stat.h>
+
+/*
+  Moves single files between branches in the background: the
+  balancer and the tiering demoter. Works like fs::movefile but to a
+  given branch, with the data copied in paced chunks and under a
+  write lease so files open by anyone are left alone.
+*/
+namespace mover
+{
+  enum class Result
+    {
+      MOVED,
+      SKIPPED,
+      FAILED,
+      INTERRUPTED
+    };
+
+  struct Limits
+  {
+    uint64_t rate;
+    uint64_t iops;
+  };
+
+  /*
+    A branch as seen by a background pass. used and avail are only
+    filled in by update().
+  */
+  struct BranchInfo
+  {
+    std::string path;
+    uint64_t    tier;
+    bool        src;
+    bool        dst;
+    uint64_t    minfreespace;
+    uint64_t    used;
+    uint64_t    avail;
+  };
+
+  typedef std::vector<BranchInfo> BranchInfoVec;
+
+  void     snapshot(const Branches &branches,
+                    BranchInfoVec  *infos);
+  int      update(BranchInfo *bi);
+  // in hundredths of a percent
+  uint64_t percent_used(const uint64_t used,
+                        const uint64_t avail);
+  uint64_t percent_used(const BranchInfo &bi);
+
+  /*
+    Both budgets are tracked from the start of a window. Falling
+    behind by more than a second, because of an idle period or slow
+    storage, restarts the window so no large burst follows.
+  */
+  class Throttle
+  {
+  public:
+    Throttle();
+
+  public:
+    void     reset(void);
+    uint64_t delay(const uint64_t  bytes,
+                   const Limits   &limits);
+
+  private:
+    uint64_t _start;
+    uint64_t _bytes;
+    uint64_t _ops;
+  };
+
+  class Job
+  {
+  public:
+    virtual ~Job() {}
+
+  public:
+    // the source is open, return false to skip it
+    virtual bool accept(const struct stat &st) = 0;
+    // polled between chunks, return false to abandon the move
+    virtual bool proceed(void) = 0;
+    virtual void copied(const uint64_t bytes) = 0;
+  };
+
+  const uint64_t BUF_SIZE  = (1024ULL * 1024ULL);
+  const uint64_t BUF_ALIGN = 4096;
+
+  Result move(const std::string &srcbase,
+              const std::string &dstbase,
+              const std::string &relpath,
+              char              *buf,
+              Throttle          *throttle,
+              const Limits      &limits,
+              Job               *job,
+              struct stat       *st);
+}
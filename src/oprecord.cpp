@@ -0,0 +1,356 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "oprecord.hpp"
+
+#include "fh.hpp"
+#include "fs_close.hpp"
+#include "fs_open.hpp"
+#include "fs_write.hpp"
+#include "opstats.hpp"
+#include "thread_slots.hpp"
+#include "ugid.hpp"
+
+#include "fuse.h"
+
+#include <atomic>
+#include <string>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+
+using std::string;
+
+namespace l
+{
+  const char   MAGIC[]   = "MFSREC01";
+  const size_t FLUSH_AT  = (1024 * 1024);
+  const size_t MAX_QUEUE = (16 * 1024 * 1024);
+
+  /*
+    Each thread appends to its own buffer so recording doesn't
+    serialize every request on one lock. The writer thread drains
+    them all. One left by a thread which exited is drained as usual
+    and handed to the next thread to register. gen is the recording
+    the contents belong to.
+  */
+  struct Buffer
+  {
+    Buffer()
+    {
+      pthread_mutex_init(&lock,NULL);
+    }
+
+    pthread_mutex_t  lock;
+    string           buf;
+    uint64_t         gen;
+    uint64_t         dropped;
+    bool             used;
+    Buffer          *next;
+  };
+
+  static pthread_mutex_t g_lock    = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_mutex_t g_ctl     = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t  g_cond    = PTHREAD_COND_INITIALIZER;
+  static pthread_t       g_thread;
+  static string          g_path;
+  static int             g_fd      = -1;
+  static bool            g_stop    = false;
+  static uint64_t        g_base    = 0;
+  static uint64_t        g_dropped = 0;
+  static uint64_t        g_gens    = 0;
+  static __thread pid_t  t_tid     = 0;
+
+  // the recording in progress, 0 when stopped
+  static std::atomic<uint64_t> g_gen(0);
+
+  typedef ThreadSlots<Buffer> Buffers;
+
+  static
+  void
+  write_all(const int     fd_,
+            const string &buf_)
+  {
+    ssize_t rv;
+    size_t off;
+
+    off = 0;
+    while(off < buf_.size())
+      {
+        rv = fs::write(fd_,&buf_[off],buf_.size() - off);
+        if((rv == -1) && (errno == EINTR))
+          continue;
+        if(rv <= 0)
+          break;
+        off += rv;
+      }
+  }
+
+  /*
+    Writes out everything queued for recording gen_. Anything left
+    over from an earlier recording is discarded.
+  */
+  static
+  void
+  drain(const uint64_t  gen_,
+        string         *tmp_)
+  {
+    for(Buffer *b = Buffers::head(); b != NULL; b = b->next)
+      {
+        pthread_mutex_lock(&b->lock);
+        if(b->gen == gen_)
+          tmp_->swap(b->buf);
+        else
+          b->buf.clear();
+        g_dropped += b->dropped;
+        b->dropped = 0;
+        pthread_mutex_unlock(&b->lock);
+
+        l::write_all(g_fd,*tmp_);
+        tmp_->clear();
+      }
+  }
+
+  static
+  void*
+  writer(void *arg_)
+  {
+    bool stop;
+    string buf;
+    uint64_t gen;
+    struct timespec ts;
+
+    gen = (uintptr_t)arg_;
+    do
+      {
+        pthread_mutex_lock(&g_lock);
+        if(!g_stop)
+          {
+            clock_gettime(CLOCK_REALTIME,&ts);
+            ts.tv_sec += 1;
+            pthread_cond_timedwait(&g_cond,&g_lock,&ts);
+          }
+        stop = g_stop;
+        pthread_mutex_unlock(&g_lock);
+
+        l::drain(gen,&buf);
+      }
+    while(!stop);
+
+    return NULL;
+  }
+
+  static
+  void
+  stop(void)
+  {
+    if(g_fd == -1)
+      return;
+
+    oprecord::g_enabled.store(false,std::memory_order_relaxed);
+
+    /*
+      Requests already past the enabled check may still call write().
+      Any which take their buffer's lock before the writer's last
+      drain are written. Later ones see gen 0 and are dropped.
+    */
+    g_gen.store(0);
+
+    pthread_mutex_lock(&g_lock);
+    g_stop = true;
+    pthread_cond_signal(&g_cond);
+    pthread_mutex_unlock(&g_lock);
+
+    pthread_join(g_thread,NULL);
+
+    fs::close(g_fd);
+    g_fd = -1;
+
+    if(g_dropped)
+      syslog(LOG_WARNING,
+             "trace.record: %llu operations dropped, writing fell behind",
+             (unsigned long long)g_dropped);
+  }
+
+  static
+  int
+  start(const string &filepath_)
+  {
+    int rv;
+    uint16_t count;
+    string header;
+
+    {
+      const ugid::Set ugid(0,0);
+
+      g_fd = fs::open(filepath_,O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,0600);
+      if(g_fd == -1)
+        return -errno;
+
+      header.assign(MAGIC,sizeof(MAGIC) - 1);
+      count = opstats::OPS;
+      header.append((const char*)&count,sizeof(count));
+      for(int i = 0; i < opstats::OPS; i++)
+        header.append(opstats::name((opstats::Op)i),
+                      strlen(opstats::name((opstats::Op)i)) + 1);
+      l::write_all(g_fd,header);
+
+      pthread_mutex_lock(&g_lock);
+      g_stop    = false;
+      g_dropped = 0;
+      g_base    = opstats::now();
+      g_gens++;
+      pthread_mutex_unlock(&g_lock);
+
+      rv = pthread_create(&g_thread,NULL,l::writer,(void*)(uintptr_t)g_gens);
+      if(rv != 0)
+        {
+          fs::close(g_fd);
+          g_fd = -1;
+          return -rv;
+        }
+    }
+
+    g_gen.store(g_gens);
+
+    oprecord::g_enabled.store(true,std::memory_order_relaxed);
+
+    return 0;
+  }
+}
+
+namespace oprecord
+{
+  std::atomic<bool> g_enabled(false);
+
+  /*
+    Only acts when the path changes. An empty path stops recording,
+    flushing what's queued.
+  */
+  int
+  path(const string &filepath_)
+  {
+    int rv;
+
+    rv = 0;
+    pthread_mutex_lock(&l::g_ctl);
+    if(filepath_ != l::g_path)
+      {
+        l::stop();
+        l::g_path = filepath_;
+        if(!filepath_.empty())
+          rv = l::start(filepath_);
+      }
+    pthread_mutex_unlock(&l::g_ctl);
+
+    return rv;
+  }
+
+  void
+  take(Capture                *c_,
+       const fuse_file_info_t *ffi_)
+  {
+    if(c_->handle)
+      return;
+
+    c_->handle    = true;
+    c_->rec.fh    = ffi_->fh;
+    c_->rec.flags = ffi_->flags;
+  }
+
+  void
+  take(Capture          *c_,
+       fuse_file_info_t *ffi_)
+  {
+    oprecord::take(c_,(const fuse_file_info_t*)ffi_);
+  }
+
+  void
+  take(Capture           *c_,
+       const fuse_bufvec *buf_)
+  {
+    c_->rec.size = fuse_buf_size(buf_);
+  }
+
+  void
+  take(Capture     *c_,
+       fuse_bufvec *buf_)
+  {
+    oprecord::take(c_,(const fuse_bufvec*)buf_);
+  }
+
+  void
+  write(const Capture &c_)
+  {
+    Record rec;
+    size_t len1;
+    size_t len2;
+    uint64_t gen;
+    l::Buffer *b;
+
+    if(l::t_tid == 0)
+      l::t_tid = ::syscall(SYS_gettid);
+
+    len1 = ((c_.paths > 0) ? strnlen(c_.path[0],UINT16_MAX) : 0);
+    len2 = ((c_.paths > 1) ? strnlen(c_.path[1],UINT16_MAX) : 0);
+
+    rec      = c_.rec;
+    rec.tid  = l::t_tid;
+    rec.len1 = len1;
+    rec.len2 = len2;
+
+    b = l::Buffers::get();
+
+    pthread_mutex_lock(&b->lock);
+    gen = l::g_gen.load();
+    if(gen == 0)
+      goto out;
+
+    if(b->gen != gen)
+      {
+        b->buf.clear();
+        b->gen = gen;
+      }
+
+    if(b->buf.size() >= l::MAX_QUEUE)
+      {
+        b->dropped++;
+        goto out;
+      }
+
+    rec.time = ((rec.time > l::g_base) ? (rec.time - l::g_base) : 0);
+    b->buf.append((const char*)&rec,sizeof(rec));
+    if(len1)
+      b->buf.append(c_.path[0],len1);
+    if(len2)
+      b->buf.append(c_.path[1],len2);
+    if(b->buf.size() >= l::FLUSH_AT)
+      pthread_cond_signal(&l::g_cond);
+
+  out:
+    pthread_mutex_unlock(&b->lock);
+  }
+}
@@ -0,0 +1,195 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+struct fuse_bufvec;
+struct fuse_file_info_t;
+
+/*
+  Writes every operation, with its arguments and how long it took, to
+  a file so a workload can be replayed later by
+  tools/mergerfs-replay. Data and xattr values aren't kept, only
+  sizes.
+
+  The file starts with the magic "MFSREC01", a uint16 count of
+  function names and the names themselves, each nul terminated. Then
+  for each operation a Record followed by `len1` and `len2` bytes of
+  paths. All in host byte order.
+*/
+namespace oprecord
+{
+  struct Record
+  {
+    uint64_t time;
+    uint64_t nsecs;
+    uint64_t fh;
+    int64_t  offset;
+    uint64_t size;
+    uint32_t arg0;
+    uint32_t arg1;
+    int32_t  flags;
+    uint32_t tid;
+    int32_t  error;
+    uint16_t op;
+    uint16_t len1;
+    uint16_t len2;
+    uint16_t pad;
+  } __attribute__((packed));
+
+  struct Capture
+  {
+    Record      rec;
+    const char *path[2];
+    int         paths;
+    int         args;
+    int         offsets;
+    bool        handle;
+  };
+
+  extern std::atomic<bool> g_enabled;
+
+  static
+  inline
+  bool
+  enabled(void)
+  {
+    return g_enabled.load(std::memory_order_relaxed);
+  }
+
+  int  path(const std::string &filepath);
+  void write(const Capture &capture);
+
+  void take(Capture *c, const fuse_file_info_t *ffi);
+  void take(Capture *c, fuse_file_info_t *ffi);
+  void take(Capture *c, const fuse_bufvec *buf);
+  void take(Capture *c, fuse_bufvec *buf);
+
+  /*
+    Arguments are recognized by type. Strings after a file handle are
+    data, not paths.
+  */
+  static
+  inline
+  void
+  take(Capture    *c_,
+       const char *s_)
+  {
+    if(c_->handle || (c_->paths >= 2))
+      return;
+    c_->path[c_->paths++] = s_;
+  }
+
+  static
+  inline
+  void
+  take(Capture   *c_,
+       const int  v_)
+  {
+    if(c_->args == 0)
+      c_->rec.arg0 = v_;
+    else if(c_->args == 1)
+      c_->rec.arg1 = v_;
+    c_->args++;
+  }
+
+  static
+  inline
+  void
+  take(Capture            *c_,
+       const unsigned int  v_)
+  {
+    oprecord::take(c_,(int)v_);
+  }
+
+  static
+  inline
+  void
+  take(Capture      *c_,
+       const size_t  v_)
+  {
+    c_->rec.size = v_;
+  }
+
+  static
+  inline
+  void
+  take(Capture     *c_,
+       const off_t  v_)
+  {
+    if(c_->offsets++ == 0)
+      c_->rec.offset = v_;
+    else
+      c_->rec.size = v_;
+  }
+
+  template<typename T>
+  static
+  inline
+  void
+  take(Capture *,
+       const T &)
+  {
+  }
+
+  static
+  inline
+  void
+  take_all(Capture *)
+  {
+  }
+
+  template<typename A, typename... Rest>
+  static
+  inline
+  void
+  take_all(Capture     *c_,
+           const A     &arg_,
+           const Rest&... rest_)
+  {
+    oprecord::take(c_,arg_);
+    oprecord::take_all(c_,rest_...);
+  }
+
+  template<typename... Args>
+  static
+  void
+  capture(const int      op_,
+          const uint64_t start_,
+          const uint64_t nsecs_,
+          const int      rv_,
+          const Args&... args_)
+  {
+    Capture c = Capture();
+
+    c.rec.time  = start_;
+    c.rec.nsecs = nsecs_;
+    c.rec.op    = op_;
+    c.rec.error = ((rv_ < 0) ? -rv_ : 0);
+
+    oprecord::take_all(&c,args_...);
+    oprecord::write(c);
+  }
+}
@@ -0,0 +1,256 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "opstats.hpp"
+
+#include "thread_slots.hpp"
+
+#include <atomic>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHELINE_SIZE 64
+
+namespace l
+{
+  /*
+    Values below 8ns get a bucket each. Beyond that each power of two
+    up to 2^36ns (about 68s) is split into 8. Anything longer lands
+    in the last bucket.
+  */
+  const uint64_t SUB_BITS = 3;
+  const uint64_t SUB      = (1ULL << SUB_BITS);
+  const uint64_t MAX_MSB  = 36;
+  const uint64_t BUCKETS  = (((MAX_MSB - SUB_BITS + 1) * SUB) + SUB);
+
+  typedef std::atomic<uint64_t> Counter;
+
+  struct OpSlot
+  {
+    Counter  buckets[opstats::OPS][BUCKETS];
+    Counter  errors[opstats::OPS];
+    bool     used;
+    OpSlot  *next;
+  } __attribute__((aligned(CACHELINE_SIZE)));
+
+  typedef ThreadSlots<OpSlot> Slots;
+
+  struct Totals
+  {
+    uint64_t buckets[BUCKETS];
+    uint64_t errors;
+  };
+
+  static pthread_mutex_t g_lock  = PTHREAD_MUTEX_INITIALIZER;
+  static Totals          g_base[opstats::OPS];
+
+  static const char *g_names[opstats::OPS] =
+    {
+      "access",
+      "chmod",
+      "chown",
+      "copy_file_range",
+      "create",
+      "fallocate",
+      "fchmod",
+      "fchown",
+      "fgetattr",
+      "flush",
+      "free_hide",
+      "fsync",
+      "fsyncdir",
+      "ftruncate",
+      "futimens",
+      "getattr",
+      "getxattr",
+      "ioctl",
+      "link",
+      "listxattr",
+      "mkdir",
+      "mknod",
+      "open",
+      "opendir",
+      "prepare_hide",
+      "read",
+      "readdir",
+      "readdir_plus",
+      "readlink",
+      "release",
+      "releasedir",
+      "removexattr",
+      "rename",
+      "rmdir",
+      "setxattr",
+      "statfs",
+      "symlink",
+      "truncate",
+      "unlink",
+      "utimens",
+      "write"
+    };
+
+  static
+  inline
+  uint64_t
+  bucket(const uint64_t nsecs_)
+  {
+    uint64_t msb;
+
+    if(nsecs_ < SUB)
+      return nsecs_;
+
+    msb = (63 - __builtin_clzll(nsecs_));
+    if(msb > MAX_MSB)
+      return (BUCKETS - 1);
+
+    return (((msb - SUB_BITS + 1) * SUB) +
+            ((nsecs_ >> (msb - SUB_BITS)) & (SUB - 1)));
+  }
+
+  static
+  uint64_t
+  midpoint(const uint64_t bucket_)
+  {
+    uint64_t msb;
+    uint64_t sub;
+
+    if(bucket_ < SUB)
+      return bucket_;
+
+    msb = ((bucket_ / SUB) + SUB_BITS - 1);
+    sub = (bucket_ % SUB);
+
+    return (((SUB + sub) << (msb - SUB_BITS)) +
+            ((1ULL << (msb - SUB_BITS)) / 2));
+  }
+
+  // only the owning thread writes so no atomic read-modify-write
+  static
+  inline
+  void
+  inc(Counter &c_)
+  {
+    c_.store(c_.load(std::memory_order_relaxed) + 1,
+             std::memory_order_relaxed);
+  }
+
+  static
+  void
+  totals(const opstats::Op  op_,
+         Totals            *totals_)
+  {
+    memset(totals_,0,sizeof(Totals));
+    for(OpSlot *slot = Slots::head(); slot != NULL; slot = slot->next)
+      {
+        for(uint64_t i = 0; i < BUCKETS; i++)
+          totals_->buckets[i] += slot->buckets[op_][i].load(std::memory_order_relaxed);
+        totals_->errors += slot->errors[op_].load(std::memory_order_relaxed);
+      }
+  }
+
+  static
+  uint64_t
+  percentile(const Totals   &totals_,
+             const uint64_t  count_,
+             const uint64_t  permille_)
+  {
+    uint64_t rank;
+    uint64_t seen;
+
+    if(count_ == 0)
+      return 0;
+
+    rank = (((count_ * permille_) + 999) / 1000);
+    seen = 0;
+    for(uint64_t i = 0; i < BUCKETS; i++)
+      {
+        seen += totals_.buckets[i];
+        if(seen >= rank)
+          return l::midpoint(i);
+      }
+
+    return l::midpoint(BUCKETS - 1);
+  }
+}
+
+namespace opstats
+{
+  const char*
+  name(const Op op_)
+  {
+    return l::g_names[op_];
+  }
+
+  void
+  record(const Op       op_,
+         const uint64_t nsecs_,
+         const bool     error_)
+  {
+    l::OpSlot *slot;
+
+    slot = l::Slots::get();
+
+    l::inc(slot->buckets[op_][l::bucket(nsecs_)]);
+    if(error_)
+      l::inc(slot->errors[op_]);
+  }
+
+  void
+  summary(const Op  op_,
+          Summary  *summary_)
+  {
+    uint64_t count;
+    l::Totals totals;
+
+    // counts since the last reset
+    count = 0;
+    pthread_mutex_lock(&l::g_lock);
+    l::totals(op_,&totals);
+    for(uint64_t i = 0; i < l::BUCKETS; i++)
+      {
+        totals.buckets[i] -= l::g_base[op_].buckets[i];
+        count += totals.buckets[i];
+      }
+    totals.errors -= l::g_base[op_].errors;
+    pthread_mutex_unlock(&l::g_lock);
+
+    summary_->count  = count;
+    summary_->errors = totals.errors;
+    summary_->p50    = l::percentile(totals,count,500);
+    summary_->p90    = l::percentile(totals,count,900);
+    summary_->p99    = l::percentile(totals,count,990);
+    summary_->p999   = l::percentile(totals,count,999);
+  }
+
+  /*
+    The counters belong to their threads so rather than being zeroed
+    the current totals become the new baseline.
+  */
+  void
+  reset(void)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    for(int op = 0; op < OPS; op++)
+      l::totals((Op)op,&l::g_base[op]);
+    pthread_mutex_unlock(&l::g_lock);
+  }
+}
@@ -0,0 +1,179 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "oprecord.hpp"
+#include "optrace.hpp"
+#include "slowlog.hpp"
+
+#include <stdint.h>
+#include <time.h>
+
+/*
+  Defined by build/mergerfs-alloc-count.so when LD_PRELOAD'ed so
+  allocations made while serving an operation can be told apart from
+  those made by libfuse. NULL otherwise.
+*/
+extern "C" void mergerfs_alloc_count_op(const int inside) __attribute__((weak));
+
+/*
+  Latency histograms of every FUSE operation. Each thread records
+  into its own set of histograms, only ever written by that thread,
+  so timing an operation costs two clock reads and two uncontended
+  stores. They're summed when read.
+
+  Buckets are log-linear like HDR histograms: 8 per power of two so
+  any value is within 12.5% of the bucket's midpoint.
+*/
+namespace opstats
+{
+  enum Op
+    {
+      ACCESS,
+      CHMOD,
+      CHOWN,
+      COPY_FILE_RANGE,
+      CREATE,
+      FALLOCATE,
+      FCHMOD,
+      FCHOWN,
+      FGETATTR,
+      FLUSH,
+      FREE_HIDE,
+      FSYNC,
+      FSYNCDIR,
+      FTRUNCATE,
+      FUTIMENS,
+      GETATTR,
+      GETXATTR,
+      IOCTL,
+      LINK,
+      LISTXATTR,
+      MKDIR,
+      MKNOD,
+      OPEN,
+      OPENDIR,
+      PREPARE_HIDE,
+      READ,
+      READDIR,
+      READDIR_PLUS,
+      READLINK,
+      RELEASE,
+      RELEASEDIR,
+      REMOVEXATTR,
+      RENAME,
+      RMDIR,
+      SETXATTR,
+      STATFS,
+      SYMLINK,
+      TRUNCATE,
+      UNLINK,
+      UTIMENS,
+      WRITE,
+      OPS
+    };
+
+  // nanoseconds
+  struct Summary
+  {
+    uint64_t count;
+    uint64_t errors;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+  };
+
+  const char *name(const Op op);
+
+  void record(const Op       op,
+              const uint64_t nsecs,
+              const bool     error);
+  void summary(const Op  op,
+               Summary  *summary);
+  void reset(void);
+
+  static
+  inline
+  uint64_t
+  now(void)
+  {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+
+    return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+  }
+
+  template<typename F, F FUNC, Op OP>
+  struct Timed;
+
+  template<typename R, typename... Args, R (*FUNC)(Args...), Op OP>
+  struct Timed<R (*)(Args...),FUNC,OP>
+  {
+    static
+    R
+    call(Args... args_)
+    {
+      R rv;
+      bool tracing;
+      uint64_t slow;
+      uint64_t hash;
+      uint64_t start;
+      uint64_t nsecs;
+
+      if(mergerfs_alloc_count_op)
+        mergerfs_alloc_count_op(1);
+
+      // hashed first as release frees the handle
+      hash    = 0;
+      tracing = optrace::enabled();
+      if(tracing)
+        {
+          hash = optrace::first(args_...);
+          optrace::branch(-1);
+        }
+
+      slow = slowlog::threshold();
+      if(slow)
+        slowlog::first(args_...);
+
+      start = opstats::now();
+      rv    = FUNC(args_...);
+      nsecs = (opstats::now() - start);
+      opstats::record(OP,nsecs,(rv < 0));
+
+      if(tracing)
+        optrace::record(OP,hash,start,nsecs,rv);
+      if(oprecord::enabled())
+        oprecord::capture(OP,start,nsecs,rv,args_...);
+      if(slow)
+        slowlog::end(OP,nsecs,rv,slow);
+
+      if(mergerfs_alloc_count_op)
+        mergerfs_alloc_count_op(0);
+
+      return rv;
+    }
+  };
+}
+
+#define OPSTATS_TIMED(OP,FUNC) \
+  (&opstats::Timed<decltype(&FUNC),&FUNC,opstats::OP>::call)
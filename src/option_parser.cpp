@@ -173,6 +173,34 @@ set_threads(fuse_args *args_,
   set_kv_option(args_,"threads",config_->threads.to_string());
 }
 
+static
+void
+set_hugepages(fuse_args *args_,
+              Config    *config_)
+{
+  set_kv_option(args_,"hugepages",config_->hugepages.to_string());
+}
+
+static
+void
+set_async_io(fuse_args *args_,
+             Config    *config_)
+{
+  set_kv_option(args_,"async_io",config_->async_io.to_string());
+}
+
+/*
+  Without credential switching requests are made as root and ACLs on
+  the branches are never consulted so the kernel has to enforce them.
+*/
+static
+void
+set_credentials(Config *config_)
+{
+  if(config_->credentials == Credentials::ENUM::FIXUP)
+    config_->posix_acl = true;
+}
+
 static
 void
 set_fsname(fuse_args *args_,
@@ -322,6 +350,9 @@ usage(void)
     "                           default = 0 (disabled)\n"
     "    -o cache.statfs=INT    'statfs' cache timeout in seconds. Used by\n"
     "                           policies. default = 0 (disabled)\n"
+    "    -o cache.gid=INT       supplementary group cache timeout in seconds.\n"
+    "                           Refreshed in the background. 0 disables.\n"
+    "                           default = 3600\n"
     "    -o cache.files=libfuse|off|partial|full|auto-full\n"
     "                           * libfuse: Use direct_io, kernel_cache, auto_cache\n"
     "                             values directly\n"
@@ -356,6 +387,10 @@ usage(void)
     "                           default = 4G\n"
     "    -o moveonenospc=BOOL   Try to move file to another drive when ENOSPC\n"
     "                           on write. default = false\n"
+    "    -o moveonenospc.async=BOOL\n"
+    "                           Redirect writes to the new location at once\n"
+    "                           and copy the data in the background.\n"
+    "                           default = false\n"
     "    -o dropcacheonclose=BOOL\n"
     "                           When a file is closed suggest to OS it drop\n"
     "                           the file's cache. This is useful when using\n"
@@ -368,6 +403,9 @@ usage(void)
     "                           default = 3600\n"
     "    -o nullrw=BOOL         Disables reads and writes. For benchmarking.\n"
     "                           default = false\n"
+    "    -o passthrough=BOOL    Have the kernel read and write opened files\n"
+    "                           directly. Requires Linux 6.9+ and root.\n"
+    "                           default = false\n"
     "    -o ignorepponrename=BOOL\n"
     "                           Ignore path preserving when performing renames\n"
     "                           and links. default = false\n"
@@ -402,6 +440,61 @@ usage(void)
     "                           ensure there is at most one pending read \n"
     "                           request per file and will attempt to order\n"
     "                           requests by offset. default = true\n"
+    "    -o hugepages=off|transparent|explicit\n"
+    "                           Back FUSE message buffers with hugepages.\n"
+    "                           default = off\n"
+    "    -o mempool_max=SIZE    Max bytes each memory pool keeps for reuse.\n"
+    "                           default = 32M\n"
+    "    -o locks.profile=BOOL  Count acquisitions, contention and wait time\n"
+    "                           of internal locks. default = false\n"
+    "    -o memory.nodes.max=INT\n"
+    "                           Max nodes kept before asking the kernel to\n"
+    "                           forget unused file entries. 0 = no limit.\n"
+    "                           default = 0\n"
+    "    -o async_io=INT        Queue depth for asynchronous reads and writes\n"
+    "                           via io_uring. 0 disables. default = 0\n"
+    "    -o credentials=switch|fixup\n"
+    "                           'switch' runs each request with the caller's\n"
+    "                           credentials. 'fixup' runs as root, relies on\n"
+    "                           the kernel's permission checks and chowns\n"
+    "                           new files to the caller. Implies\n"
+    "                           posix_acl=true. default = switch\n"
+    "    -o balance=start|pause|resume|stop\n"
+    "                           Control the background branch balancer.\n"
+    "    -o balance.rate=SIZE   Bytes per second the balancer may copy.\n"
+    "                           default = 64M\n"
+    "    -o balance.iops=INT    Copy operations per second the balancer may\n"
+    "                           issue. default = 200\n"
+    "    -o balance.range=INT   Percent spread in space used at which the\n"
+    "                           balancer stops. default = 2\n"
+    "    -o tiering=BOOL        Create on the fastest tier and move files to\n"
+    "                           slower tiers as it fills. default = false\n"
+    "    -o tiering.high=INT    Percent used at which files are moved to the\n"
+    "                           next tier. default = 80\n"
+    "    -o tiering.low=INT     Percent used at which moving stops.\n"
+    "                           default = 60\n"
+    "    -o tiering.order=atime|mtime\n"
+    "                           Which files to move first. default = atime\n"
+    "    -o tiering.interval=INT\n"
+    "                           Seconds between checks. default = 60\n"
+    "    -o tiering.rate=SIZE   Bytes per second moved. default = 64M\n"
+    "    -o tiering.iops=INT    Copy operations per second. default = 200\n"
+    "    -o tiering.promote=INT Opens after which a file is moved to the\n"
+    "                           fastest tier. 0 disables. default = 0\n"
+    "    -o tiering.window=INT  Seconds after which open counts are halved.\n"
+    "                           default = 3600\n"
+    "    -o branches.stats.log=INT\n"
+    "                           Seconds between syslog lines of per branch\n"
+    "                           I/O counts. 0 disables. default = 0\n"
+    "    -o trace=INT           Operations kept per thread for\n"
+    "                           user.mergerfs.trace.dump. 0 disables.\n"
+    "                           default = 0\n"
+    "    -o trace.record=PATH   Write every operation to PATH for replay by\n"
+    "                           tools/mergerfs-replay.\n"
+    "    -o trace.slow=INT      Log operations taking longer than INT\n"
+    "                           milliseconds. 0 disables. default = 0\n"
+    "    -o trace.slow.rate=INT Most slow operations logged per second.\n"
+    "                           default = 10\n"
             << std::endl;
 }
 
@@ -420,7 +513,7 @@ option_processor(void       *data_,
       return process_opt(data,arg_);
 
     case FUSE_OPT_KEY_NONOPT:
-      if(data->config->branches.vec.empty())
+      if(data->config->branches.empty())
         return process_branches(data,arg_);
       else
         return process_mount(data,arg_);
@@ -467,14 +560,17 @@ namespace options
                    opts,
                    ::option_processor);
 
-    if(config_->branches.vec.empty())
+    if(config_->branches.empty())
       errs_->push_back("branches not set");
     if(config_->mount->empty())
       errs_->push_back("mountpoint not set");
 
+    set_credentials(config_);
     set_default_options(args_);
     set_fsname(args_,config_);
     set_subtype(args_);
     set_threads(args_,config_);
+    set_hugepages(args_,config_);
+    set_async_io(args_,config_);
   }
 }
@@ -0,0 +1,315 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "optrace.hpp"
+
+#include "fh.hpp"
+#include "opstats.hpp"
+#include "thread_slots.hpp"
+#include "wyhash.h"
+
+#include "fuse.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+
+#define CACHELINE_SIZE 64
+
+namespace l
+{
+  const uint64_t MAX_ENTRIES = (1ULL << 20);
+
+  struct Entry
+  {
+    uint64_t time;
+    uint64_t hash;
+    uint64_t nsecs;
+    uint16_t op;
+    int16_t  branch;
+    int32_t  error;
+  };
+
+  struct Ring
+  {
+    std::atomic<uint64_t>  head;
+    uint64_t               size;
+    Entry                 *entries;
+    uint32_t               tid;
+    bool                   used;
+    Ring                  *next;
+  } __attribute__((aligned(CACHELINE_SIZE)));
+
+  typedef ThreadSlots<Ring> Rings;
+
+  static pthread_mutex_t        g_lock  = PTHREAD_MUTEX_INITIALIZER;
+  static std::atomic<uint64_t>  g_size(0);
+
+  /*
+    Rings outlive their threads and are reused, keeping their entries
+    until overwritten. The owner resizes its ring under the lock so a
+    dump never reads freed entries.
+  */
+  static
+  Ring*
+  ring_get(const uint64_t size_)
+  {
+    bool attach;
+    Ring *ring;
+
+    attach = (Rings::local() == NULL);
+    ring   = Rings::get();
+
+    pthread_mutex_lock(&g_lock);
+    if(attach)
+      ring->tid = ::syscall(SYS_gettid);
+    if(ring->size != size_)
+      {
+        free(ring->entries);
+        ring->entries = (Entry*)calloc(size_,sizeof(Entry));
+        if(ring->entries == NULL)
+          abort();
+        ring->size = size_;
+        ring->head.store(0,std::memory_order_relaxed);
+      }
+    pthread_mutex_unlock(&g_lock);
+
+    return ring;
+  }
+
+  static
+  uint64_t
+  realtime_offset(void)
+  {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME,&ts);
+
+    return (((ts.tv_sec * 1000000000ULL) + ts.tv_nsec) - opstats::now());
+  }
+
+  static
+  bool
+  newer(const optrace::Record &a_,
+        const optrace::Record &b_)
+  {
+    return (a_.time > b_.time);
+  }
+
+  /*
+    The owner keeps writing while its ring is copied. Entries it may
+    have overwritten during the copy are dropped.
+  */
+  static
+  void
+  collect(vector<optrace::Record> *records_)
+  {
+    uint64_t h0;
+    uint64_t h1;
+    uint64_t first;
+    optrace::Record r;
+
+    for(Ring *ring = Rings::head(); ring != NULL; ring = ring->next)
+      {
+        if(ring->size == 0)
+          continue;
+
+        h0    = ring->head.load(std::memory_order_acquire);
+        first = ((h0 > ring->size) ? (h0 - ring->size) : 0);
+
+        size_t base = records_->size();
+        for(uint64_t i = first; i < h0; i++)
+          {
+            const Entry &e = ring->entries[i & (ring->size - 1)];
+
+            r.time   = e.time;
+            r.hash   = e.hash;
+            r.nsecs  = e.nsecs;
+            r.tid    = ring->tid;
+            r.op     = e.op;
+            r.branch = e.branch;
+            r.error  = e.error;
+            r.pad    = 0;
+
+            records_->push_back(r);
+          }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        h1 = ring->head.load(std::memory_order_relaxed);
+        if((h1 - first) >= ring->size)
+          {
+            uint64_t torn = std::min(h1 - first - ring->size + 1,h0 - first);
+            records_->erase(records_->begin() + base,
+                            records_->begin() + base + torn);
+          }
+      }
+  }
+}
+
+namespace optrace
+{
+  std::atomic<bool> g_enabled(false);
+  __thread int      t_branch = -1;
+
+  /*
+    Rounded up to a power of 2. 0 stops recording but keeps what was
+    recorded.
+  */
+  void
+  size(const uint64_t entries_)
+  {
+    uint64_t size;
+
+    size = 0;
+    if(entries_ > 0)
+      {
+        size = 1;
+        while((size < entries_) && (size < l::MAX_ENTRIES))
+          size <<= 1;
+      }
+
+    l::g_size.store(size,std::memory_order_relaxed);
+    g_enabled.store((size > 0),std::memory_order_relaxed);
+  }
+
+  uint64_t
+  hash(const char *fusepath_)
+  {
+    return wyhash(fusepath_,strlen(fusepath_),0,_wyp);
+  }
+
+  uint64_t
+  hash(const fuse_file_info_t *ffi_)
+  {
+    const FH *fh = reinterpret_cast<const FH*>(ffi_->fh);
+
+    if(fh == NULL)
+      return 0;
+
+    return wyhash(fh->fusepath.data(),fh->fusepath.size(),0,_wyp);
+  }
+
+  void
+  record(const int      op_,
+         const uint64_t hash_,
+         const uint64_t start_,
+         const uint64_t nsecs_,
+         const int      rv_)
+  {
+    uint64_t h;
+    uint64_t size;
+    l::Ring *ring;
+    l::Entry *e;
+
+    size = l::g_size.load(std::memory_order_relaxed);
+    ring = l::Rings::local();
+    if((ring == NULL) || (ring->size != size))
+      {
+        if(size == 0)
+          return;
+        ring = l::ring_get(size);
+      }
+
+    h = ring->head.load(std::memory_order_relaxed);
+    e = &ring->entries[h & (ring->size - 1)];
+
+    e->time   = start_;
+    e->hash   = hash_;
+    e->nsecs  = nsecs_;
+    e->op     = op_;
+    e->branch = t_branch;
+    e->error  = ((rv_ < 0) ? -rv_ : 0);
+
+    ring->head.store(h + 1,std::memory_order_release);
+  }
+
+  /*
+    The most recent records from all threads, oldest first, which fit
+    in `max_` bytes.
+  */
+  string
+  dump(const bool   binary_,
+       const size_t max_)
+  {
+    char line[128];
+    uint64_t offset;
+    string s;
+    vector<string> lines;
+    vector<Record> records;
+
+    pthread_mutex_lock(&l::g_lock);
+    l::collect(&records);
+    pthread_mutex_unlock(&l::g_lock);
+
+    std::sort(records.begin(),records.end(),l::newer);
+
+    if(binary_)
+      {
+        size_t count = std::min(records.size(),(max_ / sizeof(Record)));
+
+        std::reverse(records.begin(),records.begin() + count);
+        s.assign((const char*)records.data(),(count * sizeof(Record)));
+
+        return s;
+      }
+
+    offset = l::realtime_offset();
+
+    size_t len = 0;
+    for(size_t i = 0; i < records.size(); i++)
+      {
+        const Record &r = records[i];
+        uint64_t t = (r.time + offset);
+
+        snprintf(line,sizeof(line),
+                 "%llu.%06llu %u %s %016llx %d %llu %d\n",
+                 (unsigned long long)(t / 1000000000ULL),
+                 (unsigned long long)((t % 1000000000ULL) / 1000),
+                 r.tid,
+                 opstats::name((opstats::Op)r.op),
+                 (unsigned long long)r.hash,
+                 (int)r.branch,
+                 (unsigned long long)r.nsecs,
+                 (int)r.error);
+
+        len += strlen(line);
+        if(len > max_)
+          break;
+        lines.push_back(line);
+      }
+
+    s.reserve(len);
+    for(size_t i = lines.size(); i > 0; i--)
+      s += lines[i - 1];
+
+    return s;
+  }
+}
@@ -0,0 +1,107 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include <stdint.h>
+
+struct fuse_file_info_t;
+
+/*
+  A ring per thread of the most recent operations so what mergerfs
+  was doing around a latency spike can be seen after the fact. Off
+  unless `trace` is set.
+*/
+namespace optrace
+{
+  struct Record
+  {
+    uint64_t time;
+    uint64_t hash;
+    uint64_t nsecs;
+    uint32_t tid;
+    uint16_t op;
+    int16_t  branch;
+    int32_t  error;
+    uint32_t pad;
+  };
+
+  extern std::atomic<bool> g_enabled;
+  extern __thread int      t_branch;
+
+  static
+  inline
+  bool
+  enabled(void)
+  {
+    return g_enabled.load(std::memory_order_relaxed);
+  }
+
+  static
+  inline
+  void
+  branch(const int branch_)
+  {
+    t_branch = branch_;
+  }
+
+  void size(const uint64_t entries);
+
+  uint64_t hash(const char *fusepath);
+  uint64_t hash(const struct fuse_file_info_t *ffi);
+
+  void record(const int      op,
+              const uint64_t hash,
+              const uint64_t start,
+              const uint64_t nsecs,
+              const int      rv);
+
+  std::string dump(const bool   binary,
+                   const size_t max);
+
+  template<typename T>
+  static
+  inline
+  uint64_t
+  hash(const T &)
+  {
+    return 0;
+  }
+
+  static
+  inline
+  uint64_t
+  first(void)
+  {
+    return 0;
+  }
+
+  template<typename A, typename... Rest>
+  static
+  inline
+  uint64_t
+  first(const A &arg_,
+        const Rest&...)
+  {
+    return optrace::hash(arg_);
+  }
+}
@@ -0,0 +1,166 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "passthrough.hpp"
+
+#include "errno.hpp"
+#include "fs_fstat.hpp"
+#include "ugid.hpp"
+
+#include "fuse.h"
+
+#include <atomic>
+#include <map>
+#include <utility>
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+/*
+  The kernel requires every passthrough open of an inode to use the
+  same backing file so registrations are shared and reference counted
+  by the underlying file's device and inode.
+*/
+
+namespace l
+{
+  typedef std::pair<dev_t,ino_t> Key;
+
+  struct Backing
+  {
+    int      id;
+    unsigned refs;
+  };
+
+  typedef std::map<Key,Backing> BackingMap;
+
+  static pthread_mutex_t   g_lock = PTHREAD_MUTEX_INITIALIZER;
+  static BackingMap        g_backing;
+  static std::atomic<bool> g_disabled(false);
+
+  /*
+    Errors which mean passthrough will never work for this mount
+    (no kernel support or lacking CAP_SYS_ADMIN) rather than just
+    for this file (stacked or unsupported branch filesystem).
+  */
+  static
+  bool
+  unavailable(const int err_)
+  {
+    return ((err_ == EPERM)      ||
+            (err_ == ENOTTY)     ||
+            (err_ == ENOSYS)     ||
+            (err_ == EOPNOTSUPP));
+  }
+
+  static
+  int
+  backing_open(const int  fd_,
+               const Key &key_)
+  {
+    int id;
+    BackingMap::iterator i;
+
+    i = g_backing.find(key_);
+    if(i != g_backing.end())
+      {
+        i->second.refs++;
+        return i->second.id;
+      }
+
+    {
+      const ugid::SetRootGuard ugidGuard;
+
+      id = fuse_backing_open(fd_);
+    }
+
+    if(id < 0)
+      {
+        if(l::unavailable(-id))
+          g_disabled.store(true,std::memory_order_relaxed);
+        return id;
+      }
+
+    g_backing[key_].id   = id;
+    g_backing[key_].refs = 1;
+
+    return id;
+  }
+}
+
+namespace passthrough
+{
+  int
+  open(FileInfo         *fi_,
+       fuse_file_info_t *ffi_)
+  {
+    int rv;
+    struct stat st;
+
+    if(l::g_disabled.load(std::memory_order_relaxed))
+      return -ENOTSUP;
+
+    rv = fs::fstat(fi_->fd,&st);
+    if(rv == -1)
+      return -errno;
+
+    pthread_mutex_lock(&l::g_lock);
+    rv = l::backing_open(fi_->fd,l::Key(st.st_dev,st.st_ino));
+    pthread_mutex_unlock(&l::g_lock);
+    if(rv < 0)
+      return rv;
+
+    fi_->backing_id   = rv;
+    ffi_->passthrough = 1;
+    ffi_->backing_id  = rv;
+
+    return 0;
+  }
+
+  /*
+    Reads and writes never reach mergerfs for passthrough files so
+    the fd can't have been swapped by moveonenospc and still points
+    at the registered file.
+  */
+  void
+  release(FileInfo *fi_)
+  {
+    int rv;
+    struct stat st;
+    l::BackingMap::iterator i;
+
+    if(fi_->backing_id <= 0)
+      return;
+
+    rv = fs::fstat(fi_->fd,&st);
+    if(rv == -1)
+      return;
+
+    pthread_mutex_lock(&l::g_lock);
+    i = l::g_backing.find(l::Key(st.st_dev,st.st_ino));
+    if((i != l::g_backing.end()) && (i->second.id == fi_->backing_id))
+      {
+        if(--i->second.refs == 0)
+          {
+            fuse_backing_close(fi_->backing_id);
+            l::g_backing.erase(i);
+          }
+      }
+    pthread_mutex_unlock(&l::g_lock);
+  }
+}
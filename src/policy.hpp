@@ -18,6 +18,7 @@
 
 #include "branch.hpp"
 #include "category.hpp"
+#include "slowlog.hpp"
 
 #include <string>
 #include <vector>
@@ -73,22 +74,26 @@ public:
     {
     public:
       Base(const Policy &p_)
-        : func(p_._func)
+        : func(p_._func),
+          type(p_._enum)
       {}
 
       Base(const Policy *p_)
-        : func(p_->_func)
+        : func(p_->_func),
+          type(p_->_enum)
       {}
 
       int
       operator()(const Branches &a,const char *b,strvec *c)
       {
+        slowlog::policy((int)T,type);
         return func(T,a,b,c);
       }
 
       int
       operator()(const Branches &a,const string &b,strvec *c)
       {
+        slowlog::policy((int)T,type);
         return func(T,a,b.c_str(),c);
       }
 
@@ -98,6 +103,7 @@ public:
         int rv;
         strvec v;
 
+        slowlog::policy((int)T,type);
         rv = func(T,a,b,&v);
         if(!v.empty())
           *c = v[0];
@@ -106,7 +112,8 @@ public:
       }
 
     private:
-      const Ptr func;
+      const Ptr        func;
+      const Enum::Type type;
     };
 
     typedef Base<Category::ACTION> Action;
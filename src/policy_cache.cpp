@@ -1,5 +1,7 @@
 #include "policy_cache.hpp"
 
+#include "fuse_lockstat.h"
+
 #include <cstdlib>
 #include <map>
 #include <string>
@@ -13,6 +15,8 @@ static const uint64_t DEFAULT_TIMEOUT = 0;
 
 namespace l
 {
+  static fuse_lockstat_t g_lockstat = FUSE_LOCKSTAT_INIT("policy_cache");
+
   static
   uint64_t
   get_time(void)
@@ -45,7 +49,7 @@ PolicyCache::erase(const char *fusepath_)
   if(timeout == 0)
     return;
 
-  pthread_mutex_lock(&_lock);
+  fuse_lockstat_mutex_lock(&_lock,&l::g_lockstat);
 
   _cache.erase(fusepath_);
 
@@ -66,7 +70,7 @@ PolicyCache::cleanup(const int prob_)
 
   now = l::get_time();
 
-  pthread_mutex_lock(&_lock);
+  fuse_lockstat_mutex_lock(&_lock,&l::g_lockstat);
 
   i = _cache.begin();
   while(i != _cache.end())
@@ -83,13 +87,30 @@ PolicyCache::cleanup(const int prob_)
 void
 PolicyCache::clear(void)
 {
-  pthread_mutex_lock(&_lock);
+  fuse_lockstat_mutex_lock(&_lock,&l::g_lockstat);
 
   _cache.clear();
 
   pthread_mutex_unlock(&_lock);
 }
 
+void
+PolicyCache::usage(uint64_t *entries_,
+                   uint64_t *bytes_)
+{
+  map<string,Value>::const_iterator i;
+
+  fuse_lockstat_mutex_lock(&_lock,&l::g_lockstat);
+  *entries_ = _cache.size();
+  *bytes_   = 0;
+  for(i = _cache.begin(); i != _cache.end(); ++i)
+    *bytes_ += ((4 * sizeof(void*)) +
+                sizeof(map<string,Value>::value_type) +
+                i->first.capacity() +
+                i->second.path.capacity());
+  pthread_mutex_unlock(&_lock);
+}
+
 int
 PolicyCache::operator()(Policy::Func::Search &func_,
                         const Branches       &branches_,
@@ -106,7 +127,7 @@ PolicyCache::operator()(Policy::Func::Search &func_,
 
   now = l::get_time();
 
-  pthread_mutex_lock(&_lock);
+  fuse_lockstat_mutex_lock(&_lock,&l::g_lockstat);
   v = &_cache[fusepath_];
 
   if((now - v->time) >= timeout)
@@ -116,7 +137,7 @@ PolicyCache::operator()(Policy::Func::Search &func_,
       if(rv == -1)
         return -1;
 
-      pthread_mutex_lock(&_lock);
+      fuse_lockstat_mutex_lock(&_lock,&l::g_lockstat);
       v->time = now;
       v->path = branch;
     }
@@ -44,6 +44,8 @@ public:
   void erase(const char *fusepath);
   void cleanup(const int prob = 1);
   void clear(void);
+  void usage(uint64_t *entries,
+             uint64_t *bytes);
 
 public:
   int operator()(Policy::Func::Search &func,
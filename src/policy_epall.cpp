@@ -21,7 +21,6 @@
 #include "fs_statvfs_cache.hpp"
 #include "policy.hpp"
 #include "policy_error.hpp"
-#include "rwlock.hpp"
 
 #include <string>
 #include <vector>
@@ -74,9 +73,9 @@ namespace epall
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return epall::create(branches_.vec,fusepath_,paths_);
+    return epall::create(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -120,9 +119,9 @@ namespace epall
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return epall::action(branches_.vec,fusepath_,paths_);
+    return epall::action(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -155,9 +154,9 @@ namespace epall
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return epall::search(branches_.vec,fusepath_,paths_);
+    return epall::search(branches.vec,fusepath_,paths_);
   }
 }
 
@@ -21,7 +21,6 @@
 #include "fs_statvfs_cache.hpp"
 #include "policy.hpp"
 #include "policy_error.hpp"
-#include "rwlock.hpp"
 
 #include <string>
 #include <vector>
@@ -73,9 +72,9 @@ namespace epff
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return epff::create(branches_.vec,fusepath_,paths_);
+    return epff::create(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -118,9 +117,9 @@ namespace epff
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return epff::action(branches_.vec,fusepath_,paths_);
+    return epff::action(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -152,9 +151,9 @@ namespace epff
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return epff::search(branches_.vec,fusepath_,paths_);
+    return epff::search(branches.vec,fusepath_,paths_);
   }
 }
 
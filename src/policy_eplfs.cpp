@@ -21,7 +21,6 @@
 #include "fs_statvfs_cache.hpp"
 #include "policy.hpp"
 #include "policy_error.hpp"
-#include "rwlock.hpp"
 
 #include <limits>
 #include <string>
@@ -84,9 +83,9 @@ namespace eplfs
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return eplfs::create(branches_.vec,fusepath_,paths_);
+    return eplfs::create(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -139,9 +138,9 @@ namespace eplfs
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return eplfs::action(branches_.vec,fusepath_,paths_);
+    return eplfs::action(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -188,9 +187,9 @@ namespace eplfs
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return eplfs::search(branches_.vec,fusepath_,paths_);
+    return eplfs::search(branches.vec,fusepath_,paths_);
   }
 }
 
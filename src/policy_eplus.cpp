@@ -21,7 +21,6 @@
 #include "fs_statvfs_cache.hpp"
 #include "policy.hpp"
 #include "policy_error.hpp"
-#include "rwlock.hpp"
 
 #include <limits>
 #include <string>
@@ -84,9 +83,9 @@ namespace eplus
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return eplus::create(branches_.vec,fusepath_,paths_);
+    return eplus::create(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -139,9 +138,9 @@ namespace eplus
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return eplus::action(branches_.vec,fusepath_,paths_);
+    return eplus::action(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -188,9 +187,9 @@ namespace eplus
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return eplus::search(branches_.vec,fusepath_,paths_);
+    return eplus::search(branches.vec,fusepath_,paths_);
   }
 }
 
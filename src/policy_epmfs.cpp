@@ -21,7 +21,6 @@
 #include "fs_statvfs_cache.hpp"
 #include "policy.hpp"
 #include "policy_error.hpp"
-#include "rwlock.hpp"
 
 #include <limits>
 #include <string>
@@ -84,9 +83,9 @@ namespace epmfs
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return epmfs::create(branches_.vec,fusepath_,paths_);
+    return epmfs::create(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -139,9 +138,9 @@ namespace epmfs
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return epmfs::action(branches_.vec,fusepath_,paths_);
+    return epmfs::action(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -188,9 +187,9 @@ namespace epmfs
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return epmfs::search(branches_.vec,fusepath_,paths_);
+    return epmfs::search(branches.vec,fusepath_,paths_);
   }
 }
 
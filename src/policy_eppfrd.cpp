@@ -22,7 +22,6 @@
 #include "policy.hpp"
 #include "policy_error.hpp"
 #include "rnd.hpp"
-#include "rwlock.hpp"
 
 #include <string>
 #include <vector>
@@ -88,11 +87,11 @@ namespace eppfrd
                         BranchInfoVec  *branchinfo_,
                         uint64_t       *sum_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    branchinfo_->reserve(branches_.vec.size());
+    branchinfo_->reserve(branches.vec.size());
 
-    return eppfrd::get_branchinfo_create(branches_.vec,fusepath_,branchinfo_,sum_);
+    return eppfrd::get_branchinfo_create(branches.vec,fusepath_,branchinfo_,sum_);
   }
 
   static
@@ -141,11 +140,11 @@ namespace eppfrd
                         BranchInfoVec  *branchinfo_,
                         uint64_t       *sum_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    branchinfo_->reserve(branches_.vec.size());
+    branchinfo_->reserve(branches.vec.size());
 
-    return eppfrd::get_branchinfo_action(branches_.vec,fusepath_,branchinfo_,sum_);
+    return eppfrd::get_branchinfo_action(branches.vec,fusepath_,branchinfo_,sum_);
   }
 
   static
@@ -188,11 +187,11 @@ namespace eppfrd
                         BranchInfoVec  *branchinfo_,
                         uint64_t       *sum_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    branchinfo_->reserve(branches_.vec.size());
+    branchinfo_->reserve(branches.vec.size());
 
-    return eppfrd::get_branchinfo_search(branches_.vec,fusepath_,branchinfo_,sum_);
+    return eppfrd::get_branchinfo_search(branches.vec,fusepath_,branchinfo_,sum_);
   }
 
   static
@@ -225,6 +224,9 @@ namespace eppfrd
          const char     *fusepath_,
          vector<string> *paths_)
   {
+    // basepath points into the branch snapshot so keep it pinned
+    epoch::ReadGuard guard;
+
     int error;
     uint64_t sum;
     const string *basepath;
@@ -246,6 +248,9 @@ namespace eppfrd
          const char     *fusepath_,
          vector<string> *paths_)
   {
+    // basepath points into the branch snapshot so keep it pinned
+    epoch::ReadGuard guard;
+
     int error;
     uint64_t sum;
     const string *basepath;
@@ -267,6 +272,9 @@ namespace eppfrd
          const char     *fusepath_,
          vector<string> *paths_)
   {
+    // basepath points into the branch snapshot so keep it pinned
+    epoch::ReadGuard guard;
+
     int error;
     uint64_t sum;
     const string *basepath;
@@ -20,7 +20,6 @@
 #include "fs_path.hpp"
 #include "policy.hpp"
 #include "policy_error.hpp"
-#include "rwlock.hpp"
 
 #include <string>
 #include <vector>
@@ -68,9 +67,9 @@ namespace ff
   create(const Branches &branches_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return ff::create(branches_.vec,paths_);
+    return ff::create(branches.vec,paths_);
   }
 }
 
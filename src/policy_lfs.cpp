@@ -20,7 +20,6 @@
 #include "fs_path.hpp"
 #include "policy.hpp"
 #include "policy_error.hpp"
-#include "rwlock.hpp"
 
 #include <limits>
 #include <string>
@@ -79,9 +78,9 @@ namespace lfs
   create(const Branches &branches_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return lfs::create(branches_.vec,paths_);
+    return lfs::create(branches.vec,paths_);
   }
 }
 
@@ -21,7 +21,6 @@
 #include "fs_statvfs_cache.hpp"
 #include "policy.hpp"
 #include "policy_error.hpp"
-#include "rwlock.hpp"
 
 #include <limits>
 #include <string>
@@ -109,9 +108,9 @@ namespace msplfs
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return msplfs::create(branches_.vec,fusepath_,paths_);
+    return msplfs::create(branches.vec,fusepath_,paths_);
   }
 }
 
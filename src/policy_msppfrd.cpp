@@ -24,7 +24,6 @@
 #include "policy.hpp"
 #include "policy_error.hpp"
 #include "rnd.hpp"
-#include "rwlock.hpp"
 
 #include <string>
 #include <vector>
@@ -90,11 +89,11 @@ namespace msppfrd
            BranchInfoVec  *branchinfo_,
            uint64_t       *sum_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    branchinfo_->reserve(branches_.vec.size());
+    branchinfo_->reserve(branches.vec.size());
 
-    return msppfrd::create_1(branches_.vec,fusepath_,branchinfo_,sum_);
+    return msppfrd::create_1(branches.vec,fusepath_,branchinfo_,sum_);
   }
 
   static
@@ -151,6 +150,9 @@ namespace msppfrd
          const char     *fusepath_,
          vector<string> *paths_)
   {
+    // basepath points into the branch snapshot so keep it pinned
+    epoch::ReadGuard guard;
+
     int error;
     uint64_t sum;
     const string *basepath;
@@ -21,7 +21,6 @@
 #include "fs_statvfs_cache.hpp"
 #include "policy.hpp"
 #include "policy_error.hpp"
-#include "rwlock.hpp"
 
 #include <string>
 #include <vector>
@@ -87,9 +86,9 @@ namespace newest
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return newest::create(branches_.vec,fusepath_,paths_);
+    return newest::create(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -143,9 +142,9 @@ namespace newest
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return newest::action(branches_.vec,fusepath_,paths_);
+    return newest::action(branches.vec,fusepath_,paths_);
   }
 
   static
@@ -188,9 +187,9 @@ namespace newest
          const char     *fusepath_,
          vector<string> *paths_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    return newest::search(branches_.vec,fusepath_,paths_);
+    return newest::search(branches.vec,fusepath_,paths_);
   }
 }
 
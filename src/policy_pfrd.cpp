@@ -20,7 +20,6 @@
 #include "policy.hpp"
 #include "policy_error.hpp"
 #include "rnd.hpp"
-#include "rwlock.hpp"
 
 #include <string>
 #include <vector>
@@ -82,11 +81,11 @@ namespace pfrd
                  BranchInfoVec  *branchinfo_,
                  uint64_t       *sum_)
   {
-    rwlock::ReadGuard guard(branches_.lock);
+    const Branches::Snapshot branches(branches_);
 
-    branchinfo_->reserve(branches_.vec.size());
+    branchinfo_->reserve(branches.vec.size());
 
-    return pfrd::get_branchinfo(branches_.vec,branchinfo_,sum_);
+    return pfrd::get_branchinfo(branches.vec,branchinfo_,sum_);
   }
 
   static
@@ -119,6 +118,9 @@ namespace pfrd
          const char     *fusepath_,
          vector<string> *paths_)
   {
+    // basepath points into the branch snapshot so keep it pinned
+    epoch::ReadGuard guard;
+
     int error;
     uint64_t sum;
     const string *basepath;
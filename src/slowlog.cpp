@@ -0,0 +1,346 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "slowlog.hpp"
+
+#include "branchstats.hpp"
+#include "category.hpp"
+#include "fh.hpp"
+#include "opstats.hpp"
+#include "policy.hpp"
+#include "ugid.hpp"
+
+#include "fuse.h"
+
+#include <deque>
+#include <string>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <syslog.h>
+#include <time.h>
+
+using std::string;
+
+namespace l
+{
+  const size_t MAX_QUEUED = 1024;
+
+  struct SlowOp
+  {
+    int              op;
+    uint64_t         nsecs;
+    int              error;
+    uid_t            uid;
+    pid_t            pid;
+    string           fusepath;
+    int              policies[3];
+    int              count;
+    slowlog::Branch  branches[slowlog::MAX_BRANCHES];
+  };
+
+  static pthread_mutex_t    g_lock       = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t     g_cond       = PTHREAD_COND_INITIALIZER;
+  static std::deque<SlowOp> g_queue;
+  static bool               g_logging    = false;
+  static uint64_t           g_rate       = 10;
+  static uint64_t           g_second     = 0;
+  static uint64_t           g_logged     = 0;
+  static uint64_t           g_suppressed = 0;
+
+  // fusepath of a handle, copied as release frees it
+  static __thread string   *t_path = NULL;
+
+  static
+  const char*
+  category(const int category_)
+  {
+    switch((Category)category_)
+      {
+      case Category::ACTION:
+        return "action";
+      case Category::CREATE:
+        return "create";
+      case Category::SEARCH:
+        return "search";
+      }
+
+    return "?";
+  }
+
+  static
+  void
+  log(const SlowOp &op_)
+  {
+    string branches;
+    string policies;
+    char buf[64];
+
+    for(int i = 0; i < 3; i++)
+      {
+        if(op_.policies[i] < 0)
+          continue;
+
+        policies += (policies.empty() ? "" : ",");
+        policies += l::category(i);
+        policies += ':';
+        policies += Policy::find((Policy::Enum::Type)op_.policies[i]).to_string();
+      }
+
+    for(int i = 0; i < op_.count; i++)
+      {
+        snprintf(buf,sizeof(buf),":%llu",
+                 (unsigned long long)(op_.branches[i].nsecs / 1000));
+
+        branches += (branches.empty() ? "" : ",");
+        branches += branchstats::path(op_.branches[i].branch);
+        branches += buf;
+      }
+
+    syslog(LOG_WARNING,
+           "slow op: op=%s usecs=%llu error=%d uid=%u pid=%d"
+           " policies=%s branches_usecs=%s path=\"%s\"",
+           opstats::name((opstats::Op)op_.op),
+           (unsigned long long)(op_.nsecs / 1000),
+           op_.error,
+           (unsigned)op_.uid,
+           (int)op_.pid,
+           (policies.empty() ? "-" : policies.c_str()),
+           (branches.empty() ? "-" : branches.c_str()),
+           op_.fusepath.c_str());
+  }
+
+  /*
+    Suppressed ops are reported at most once a second, after a wait
+    for the queue to fill again.
+  */
+  static
+  void*
+  logger(void *arg_)
+  {
+    SlowOp op;
+    uint64_t suppressed;
+    struct timespec ts;
+
+    pthread_mutex_lock(&g_lock);
+    while(true)
+      {
+        while(g_queue.empty() && (g_suppressed == 0))
+          pthread_cond_wait(&g_cond,&g_lock);
+
+        suppressed = 0;
+        if(g_queue.empty())
+          {
+            clock_gettime(CLOCK_REALTIME,&ts);
+            ts.tv_sec += 1;
+            pthread_cond_timedwait(&g_cond,&g_lock,&ts);
+            if(!g_queue.empty())
+              continue;
+            suppressed   = g_suppressed;
+            g_suppressed = 0;
+          }
+        else
+          {
+            op = g_queue.front();
+            g_queue.pop_front();
+          }
+        pthread_mutex_unlock(&g_lock);
+
+        if(suppressed)
+          syslog(LOG_WARNING,
+                 "slow op: %llu more not logged due to trace.slow.rate",
+                 (unsigned long long)suppressed);
+        else
+          l::log(op);
+
+        pthread_mutex_lock(&g_lock);
+      }
+
+    return NULL;
+  }
+
+  static
+  void
+  logger_start(void)
+  {
+    int rv;
+    pthread_t thread;
+    pthread_attr_t attr;
+    const ugid::Set ugid(0,0);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+    rv = pthread_create(&thread,&attr,l::logger,NULL);
+    pthread_attr_destroy(&attr);
+    g_logging = (rv == 0);
+  }
+
+  /*
+    At most g_rate a second are queued. The rest are counted and the
+    count logged once the queue drains.
+  */
+  static
+  void
+  enqueue(const SlowOp &op_)
+  {
+    uint64_t second;
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE,&ts);
+    second = ts.tv_sec;
+
+    pthread_mutex_lock(&g_lock);
+    if(second != g_second)
+      {
+        g_second = second;
+        g_logged = 0;
+      }
+
+    if((g_logged >= g_rate) || (g_queue.size() >= MAX_QUEUED))
+      {
+        g_suppressed++;
+      }
+    else
+      {
+        g_logged++;
+        g_queue.push_back(op_);
+        if(!g_logging)
+          l::logger_start();
+        pthread_cond_signal(&g_cond);
+      }
+    pthread_mutex_unlock(&g_lock);
+  }
+}
+
+namespace slowlog
+{
+  std::atomic<uint64_t> g_threshold(0);
+  __thread State        t_state = {NULL,{-1,-1,-1},0,{}};
+
+  void
+  threshold(const uint64_t msecs_)
+  {
+    g_threshold.store(msecs_ * 1000000ULL,std::memory_order_relaxed);
+  }
+
+  void
+  rate(const uint64_t per_sec_)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    l::g_rate = per_sec_;
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  void
+  begin(const char *fusepath_)
+  {
+    t_state.fusepath    = fusepath_;
+    t_state.policies[0] = -1;
+    t_state.policies[1] = -1;
+    t_state.policies[2] = -1;
+    t_state.count       = 0;
+  }
+
+  void
+  begin(const fuse_file_info_t *ffi_)
+  {
+    const FH *fh = reinterpret_cast<const FH*>(ffi_->fh);
+
+    if(fh == NULL)
+      return slowlog::begin((const char*)NULL);
+
+    if(l::t_path == NULL)
+      l::t_path = new string();
+    *l::t_path = fh->fusepath;
+
+    slowlog::begin(l::t_path->c_str());
+  }
+
+  /*
+    Time on the same branch within an operation is summed. Branches
+    past MAX_BRANCHES are dropped.
+  */
+  void
+  branch(const int      branch_,
+         const uint64_t nsecs_)
+  {
+    State &s = t_state;
+
+    for(int i = 0; i < s.count; i++)
+      {
+        if(s.branches[i].branch != branch_)
+          continue;
+        s.branches[i].nsecs += nsecs_;
+        return;
+      }
+
+    if(s.count >= MAX_BRANCHES)
+      return;
+
+    s.branches[s.count].branch = branch_;
+    s.branches[s.count].nsecs  = nsecs_;
+    s.count++;
+  }
+
+  void
+  branch(const string   &basepath_,
+         const uint64_t  nsecs_)
+  {
+    int branch;
+
+    branch = branchstats::index(basepath_);
+    if(branch < 0)
+      return;
+
+    slowlog::branch(branch,nsecs_);
+  }
+
+  /*
+    threshold is the one in effect when the operation began so
+    setting trace.slow to 0 doesn't log everything still in flight.
+  */
+  void
+  end(const int      op_,
+      const uint64_t nsecs_,
+      const int      rv_,
+      const uint64_t threshold_)
+  {
+    l::SlowOp op;
+    const State        &s  = t_state;
+    const fuse_context *fc = fuse_get_context();
+
+    if(nsecs_ < threshold_)
+      return;
+
+    op.op       = op_;
+    op.nsecs    = nsecs_;
+    op.error    = ((rv_ < 0) ? -rv_ : 0);
+    op.uid      = fc->uid;
+    op.pid      = fc->pid;
+    op.fusepath = (s.fusepath ? s.fusepath : "");
+    op.count    = s.count;
+    for(int i = 0; i < 3; i++)
+      op.policies[i] = s.policies[i];
+    for(int i = 0; i < s.count; i++)
+      op.branches[i] = s.branches[i];
+
+    l::enqueue(op);
+  }
+}
@@ -0,0 +1,161 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+struct fuse_file_info_t;
+
+/*
+  Logs operations which take longer than `trace.slow` with who made
+  them, the policies used and the time spent on each branch so a
+  stalling drive can be named. The request thread only notes what it
+  touches, which costs a few thread local stores. Formatting and
+  syslog happen in a separate thread and are rate limited.
+*/
+namespace slowlog
+{
+  const int MAX_BRANCHES = 8;
+
+  struct Branch
+  {
+    int      branch;
+    uint64_t nsecs;
+  };
+
+  struct State
+  {
+    const char *fusepath;
+    int         policies[3];
+    int         count;
+    Branch      branches[MAX_BRANCHES];
+  };
+
+  extern std::atomic<uint64_t> g_threshold;
+  extern __thread State        t_state;
+
+  // in nanoseconds, 0 when disabled
+  static
+  inline
+  uint64_t
+  threshold(void)
+  {
+    return g_threshold.load(std::memory_order_relaxed);
+  }
+
+  static
+  inline
+  bool
+  enabled(void)
+  {
+    return (slowlog::threshold() > 0);
+  }
+
+  static
+  inline
+  void
+  policy(const int category_,
+         const int policy_)
+  {
+    t_state.policies[category_] = policy_;
+  }
+
+  void threshold(const uint64_t msecs);
+  void rate(const uint64_t per_sec);
+
+  void begin(const char *fusepath);
+  void begin(const struct fuse_file_info_t *ffi);
+  void branch(const int      branch,
+              const uint64_t nsecs);
+  void branch(const std::string &basepath,
+              const uint64_t     nsecs);
+  void end(const int      op,
+           const uint64_t nsecs,
+           const int      rv,
+           const uint64_t threshold);
+
+  /*
+    Times what is done on a branch outside of the per branch I/O
+    accounting, such as the stat and statfs calls policies make.
+  */
+  class Timer
+  {
+  public:
+    Timer(const std::string &basepath_)
+      : _basepath(slowlog::enabled() ? &basepath_ : NULL),
+        _start(_basepath ? Timer::now() : 0)
+    {
+    }
+
+    ~Timer()
+    {
+      if(_basepath)
+        slowlog::branch(*_basepath,(Timer::now() - _start));
+    }
+
+  private:
+    static
+    uint64_t
+    now(void)
+    {
+      struct timespec ts;
+
+      clock_gettime(CLOCK_MONOTONIC,&ts);
+
+      return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+    }
+
+  private:
+    const std::string *_basepath;
+    const uint64_t     _start;
+  };
+
+  template<typename T>
+  static
+  inline
+  void
+  begin(const T &)
+  {
+    slowlog::begin((const char*)NULL);
+  }
+
+  static
+  inline
+  void
+  first(void)
+  {
+    slowlog::begin((const char*)NULL);
+  }
+
+  template<typename A, typename... Rest>
+  static
+  inline
+  void
+  first(const A &arg_,
+        const Rest&...)
+  {
+    slowlog::begin(arg_);
+  }
+}
@@ -0,0 +1,146 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <new>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREAD_SLOTS_ALIGN 64
+
+/*
+  One T per thread, kept on a list so others can walk them all. T
+  needs `bool used` and `T *next` members and each T may only be used
+  with one registry.
+
+  Slots are zeroed, value initialized, cacheline aligned and never
+  freed. When a thread exits its slot is marked unused and handed, as
+  it is, to the next thread to register. Counts summed over the list
+  therefore stay correct and a walker never sees a slot disappear.
+  The list is only ever prepended to so it can be walked from head()
+  without the lock.
+*/
+template<typename T>
+class ThreadSlots
+{
+public:
+  // this thread's slot, registering if needed
+  static
+  inline
+  T*
+  get(void)
+  {
+    if(_local != NULL)
+      return _local;
+
+    return ThreadSlots<T>::attach();
+  }
+
+  // this thread's slot or NULL if not yet registered
+  static
+  inline
+  T*
+  local(void)
+  {
+    return _local;
+  }
+
+  static
+  T*
+  head(void)
+  {
+    T *h;
+
+    pthread_mutex_lock(&_lock);
+    h = _head;
+    pthread_mutex_unlock(&_lock);
+
+    return h;
+  }
+
+private:
+  static
+  void
+  release(void *slot_)
+  {
+    pthread_mutex_lock(&_lock);
+    ((T*)slot_)->used = false;
+    pthread_mutex_unlock(&_lock);
+  }
+
+  static
+  void
+  key_create(void)
+  {
+    pthread_key_create(&_key,ThreadSlots<T>::release);
+  }
+
+  static
+  T*
+  attach(void)
+  {
+    T *slot;
+
+    pthread_once(&_once,ThreadSlots<T>::key_create);
+
+    pthread_mutex_lock(&_lock);
+    for(slot = _head; slot != NULL; slot = slot->next)
+      {
+        if(slot->used == false)
+          break;
+      }
+
+    if(slot == NULL)
+      {
+        void *mem;
+
+        if(posix_memalign(&mem,THREAD_SLOTS_ALIGN,sizeof(T)) != 0)
+          abort();
+        memset(mem,0,sizeof(T));
+
+        slot = new(mem) T();
+        slot->next = _head;
+        _head      = slot;
+      }
+
+    slot->used = true;
+    pthread_mutex_unlock(&_lock);
+
+    pthread_setspecific(_key,slot);
+    _local = slot;
+
+    return slot;
+  }
+
+private:
+  static pthread_mutex_t _lock;
+  static T              *_head;
+  static pthread_key_t   _key;
+  static pthread_once_t  _once;
+  static __thread T     *_local;
+};
+
+template<typename T> pthread_mutex_t ThreadSlots<T>::_lock  = PTHREAD_MUTEX_INITIALIZER;
+template<typename T> T*              ThreadSlots<T>::_head  = NULL;
+template<typename T> pthread_key_t   ThreadSlots<T>::_key;
+template<typename T> pthread_once_t  ThreadSlots<T>::_once  = PTHREAD_ONCE_INIT;
+template<typename T> __thread T*     ThreadSlots<T>::_local = NULL;
@@ -0,0 +1,826 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#include "tiering.hpp"
+
+#include "config.hpp"
+#include "fs_closedir.hpp"
+#include "fs_lstat.hpp"
+#include "fs_opendir.hpp"
+#include "fs_path.hpp"
+#include "fs_readdir.hpp"
+#include "fs_statvfs.hpp"
+#include "mover.hpp"
+#include "statvfs_util.hpp"
+#include "ugid.hpp"
+#include "wyhash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using std::string;
+using std::vector;
+using mover::BranchInfo;
+using mover::BranchInfoVec;
+using mover::Result;
+
+namespace l
+{
+  struct Settings
+  {
+    mover::Limits io;
+    uint64_t      high;
+    uint64_t      low;
+    uint64_t      interval;
+    uint64_t      promote;
+    uint64_t      window;
+    TieringOrder  order;
+  };
+
+  struct Candidate
+  {
+    uint64_t time;
+    uint64_t size;
+    string   relpath;
+
+    bool
+    operator<(const Candidate &c_) const
+    {
+      return (time < c_.time);
+    }
+  };
+
+  typedef std::priority_queue<Candidate> CandidateHeap;
+
+  static pthread_mutex_t       g_lock    = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t        g_cond    = PTHREAD_COND_INITIALIZER;
+  static bool                  g_ready   = false;
+  static bool                  g_running = false;
+  static bool                  g_moving  = false;
+  static std::atomic<bool>     g_enabled(false);
+
+  static std::atomic<uint64_t> g_promote(0);
+  static std::set<string>      g_hot;
+
+  static std::atomic<uint64_t> g_demoted(0);
+  static std::atomic<uint64_t> g_promoted(0);
+  static std::atomic<uint64_t> g_bytes(0);
+  static std::atomic<uint64_t> g_skipped(0);
+  static std::atomic<uint64_t> g_errors(0);
+
+  /*
+    Opens are counted in a count-min sketch: each path maps to one
+    counter per row and its count is the smallest of them. Only the
+    smallest are incremented which keeps collisions from inflating
+    counts much. Every window all counters are halved so old
+    popularity fades.
+  */
+  const uint64_t SKETCH_ROWS  = 4;
+  const uint64_t SKETCH_WIDTH = 4096;
+  const uint64_t HOT_MAX      = 1024;
+
+  static std::atomic<uint32_t> g_sketch[SKETCH_ROWS][SKETCH_WIDTH];
+
+  static
+  void
+  sketch_index(const string &fusepath_,
+               uint64_t      idx_[SKETCH_ROWS])
+  {
+    uint64_t h;
+    uint64_t h1;
+    uint64_t h2;
+
+    h  = wyhash(fusepath_.data(),fusepath_.size(),0x7472617065786974,_wyp);
+    h1 = (h & 0xFFFFFFFF);
+    h2 = ((h >> 32) | 1);
+    for(uint64_t i = 0; i < SKETCH_ROWS; i++)
+      idx_[i] = ((h1 + (i * h2)) % SKETCH_WIDTH);
+  }
+
+  static
+  uint32_t
+  sketch_estimate(const uint64_t idx_[SKETCH_ROWS])
+  {
+    uint32_t v;
+    uint32_t min;
+
+    min = UINT32_MAX;
+    for(uint64_t i = 0; i < SKETCH_ROWS; i++)
+      {
+        v = g_sketch[i][idx_[i]].load(std::memory_order_relaxed);
+        if(v < min)
+          min = v;
+      }
+
+    return min;
+  }
+
+  static
+  uint32_t
+  sketch_add(const string &fusepath_)
+  {
+    uint32_t min;
+    uint64_t idx[SKETCH_ROWS];
+
+    l::sketch_index(fusepath_,idx);
+
+    min = l::sketch_estimate(idx);
+    if(min == UINT32_MAX)
+      return min;
+
+    for(uint64_t i = 0; i < SKETCH_ROWS; i++)
+      {
+        uint32_t v = min;
+
+        g_sketch[i][idx[i]].compare_exchange_strong(v,min + 1,
+                                                    std::memory_order_relaxed);
+      }
+
+    return (min + 1);
+  }
+
+  static
+  uint32_t
+  sketch_get(const string &fusepath_)
+  {
+    uint64_t idx[SKETCH_ROWS];
+
+    l::sketch_index(fusepath_,idx);
+
+    return l::sketch_estimate(idx);
+  }
+
+  static
+  void
+  sketch_decay(void)
+  {
+    for(uint64_t i = 0; i < SKETCH_ROWS; i++)
+      for(uint64_t j = 0; j < SKETCH_WIDTH; j++)
+        g_sketch[i][j].store(g_sketch[i][j].load(std::memory_order_relaxed) >> 1,
+                             std::memory_order_relaxed);
+  }
+
+  static
+  void
+  snapshot(BranchInfoVec *branches_,
+           Settings      *settings_)
+  {
+    Config::Read cfg;
+
+    settings_->io.rate  = cfg->tiering_rate;
+    settings_->io.iops  = cfg->tiering_iops;
+    settings_->high     = std::min((uint64_t)cfg->tiering_high,(uint64_t)100);
+    settings_->low      = std::min((uint64_t)cfg->tiering_low,settings_->high);
+    settings_->interval = std::max((uint64_t)cfg->tiering_interval,(uint64_t)1);
+    settings_->promote  = cfg->tiering_promote;
+    settings_->window   = std::max((uint64_t)cfg->tiering_window,(uint64_t)1);
+    settings_->order    = cfg->tiering_order;
+
+    mover::snapshot(cfg->branches,branches_);
+  }
+
+  /*
+    The roomiest branch of the nearest slower tier with space for the
+    file. Further tiers are only used once nearer ones are full.
+  */
+  static
+  BranchInfo*
+  destination(BranchInfoVec    &branches_,
+              const BranchInfo &src_,
+              const uint64_t    size_)
+  {
+    BranchInfo *dst;
+
+    dst = NULL;
+    for(size_t i = 0; i < branches_.size(); i++)
+      {
+        BranchInfo &bi = branches_[i];
+
+        if(!bi.dst || (bi.tier <= src_.tier))
+          continue;
+        if(bi.avail < (size_ + bi.minfreespace))
+          continue;
+        if((dst != NULL) && (bi.tier > dst->tier))
+          continue;
+        if((dst != NULL) && (bi.tier == dst->tier) && (bi.avail <= dst->avail))
+          continue;
+
+        dst = &bi;
+      }
+
+    return dst;
+  }
+
+  static
+  uint64_t
+  timestamp(const struct stat  &st_,
+            const TieringOrder  order_)
+  {
+    const struct timespec &ts = ((order_ == TieringOrder::ENUM::ATIME) ?
+                                 st_.st_atim :
+                                 st_.st_mtim);
+
+    return ((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+  }
+
+  /*
+    Only the oldest files are kept: those whose sizes add up to
+    target. The newest is dropped whenever the rest still cover it.
+  */
+  static
+  void
+  collect(const string       &basepath_,
+          const string       &reldir_,
+          const TieringOrder  order_,
+          const uint64_t      target_,
+          CandidateHeap      *heap_,
+          uint64_t           *total_)
+  {
+    int rv;
+    DIR *dh;
+    Candidate c;
+    string relpath;
+    struct stat st;
+    struct dirent *de;
+    vector<string> dirs;
+
+    dh = fs::opendir(fs::path::make(basepath_,reldir_));
+    if(dh == NULL)
+      return;
+
+    for(de = fs::readdir(dh); de != NULL; de = fs::readdir(dh))
+      {
+        if((strcmp(de->d_name,".") == 0) || (strcmp(de->d_name,"..") == 0))
+          continue;
+
+        relpath = reldir_ + "/" + de->d_name;
+        if(de->d_type == DT_DIR)
+          {
+            dirs.push_back(relpath);
+            continue;
+          }
+        if((de->d_type != DT_REG) && (de->d_type != DT_UNKNOWN))
+          continue;
+
+        rv = fs::lstat(fs::path::make(basepath_,relpath),&st);
+        if((rv == -1) ||
+           !S_ISREG(st.st_mode) ||
+           (st.st_nlink != 1) ||
+           (st.st_size == 0))
+          continue;
+
+        c.time    = l::timestamp(st,order_);
+        c.size    = st.st_size;
+        c.relpath = relpath;
+
+        heap_->push(c);
+        *total_ += c.size;
+        while((*total_ - heap_->top().size) >= target_)
+          {
+            *total_ -= heap_->top().size;
+            heap_->pop();
+          }
+      }
+
+    fs::closedir(dh);
+
+    for(size_t i = 0; i < dirs.size(); i++)
+      l::collect(basepath_,dirs[i],order_,target_,heap_,total_);
+  }
+
+  class DemoteJob : public mover::Job
+  {
+  public:
+    DemoteJob(const BranchInfo &dst_)
+      : _dst(dst_)
+    {
+    }
+
+  public:
+    bool
+    accept(const struct stat &st_)
+    {
+      return (_dst.avail >= (st_.st_size + _dst.minfreespace));
+    }
+
+    bool
+    proceed(void)
+    {
+      return g_enabled;
+    }
+
+    void
+    copied(const uint64_t bytes_)
+    {
+      g_bytes += bytes_;
+    }
+
+  private:
+    const BranchInfo &_dst;
+  };
+
+  /*
+    Demotes from a branch over the high watermark until it's under
+    the low one. Twice the excess is collected as the oldest files
+    may be open and so skipped.
+  */
+  static
+  void
+  demote(BranchInfoVec   &branches_,
+         BranchInfo      *src_,
+         const Settings  &settings_,
+         char            *buf_,
+         mover::Throttle *throttle_)
+  {
+    Result res;
+    uint64_t low;
+    uint64_t total;
+    uint64_t excess;
+    BranchInfo *dst;
+    struct stat st;
+    CandidateHeap heap;
+    vector<Candidate> candidates;
+
+    low = (((src_->used + src_->avail) / 100) * settings_.low);
+    if(src_->used <= low)
+      return;
+
+    excess = (src_->used - low);
+    total  = 0;
+    l::collect(src_->path,string(),settings_.order,excess * 2,&heap,&total);
+
+    candidates.reserve(heap.size());
+    while(!heap.empty())
+      {
+        candidates.push_back(heap.top());
+        heap.pop();
+      }
+    std::reverse(candidates.begin(),candidates.end());
+
+    throttle_->reset();
+    for(size_t i = 0; i < candidates.size(); i++)
+      {
+        if(!g_enabled)
+          break;
+        if(mover::percent_used(*src_) <= (settings_.low * 100))
+          break;
+
+        dst = l::destination(branches_,*src_,candidates[i].size);
+        if(dst == NULL)
+          break;
+
+        l::DemoteJob job(*dst);
+
+        res = mover::move(src_->path,
+                          dst->path,
+                          candidates[i].relpath,
+                          buf_,
+                          throttle_,
+                          settings_.io,
+                          &job,
+                          &st);
+        switch(res)
+          {
+          case Result::MOVED:
+            g_demoted++;
+            src_->used  -= st.st_size;
+            src_->avail += st.st_size;
+            dst->used   += st.st_size;
+            dst->avail  -= st.st_size;
+            break;
+          case Result::SKIPPED:
+            g_skipped++;
+            break;
+          case Result::FAILED:
+            g_errors++;
+            break;
+          case Result::INTERRUPTED:
+            break;
+          }
+      }
+  }
+
+  class PromoteJob : public mover::Job
+  {
+  public:
+    PromoteJob(const BranchInfo &dst_,
+               const uint64_t    high_)
+      : _dst(dst_),
+        _high(high_)
+    {
+    }
+
+  public:
+    /*
+      The file must fit without pushing the branch to the high
+      watermark or it would just be demoted again.
+    */
+    bool
+    accept(const struct stat &st_)
+    {
+      uint64_t used;
+      uint64_t total;
+
+      if(_dst.avail < (st_.st_size + _dst.minfreespace))
+        return false;
+
+      used  = (_dst.used + st_.st_size);
+      total = (_dst.used + _dst.avail);
+
+      return ((used * 100ULL) < (total * _high));
+    }
+
+    bool
+    proceed(void)
+    {
+      return g_enabled;
+    }
+
+    void
+    copied(const uint64_t bytes_)
+    {
+      g_bytes += bytes_;
+    }
+
+  private:
+    const BranchInfo &_dst;
+    const uint64_t    _high;
+  };
+
+  static
+  uint64_t
+  fastest(const BranchInfoVec &branches_)
+  {
+    uint64_t tier;
+
+    tier = UINT64_MAX;
+    for(size_t i = 0; i < branches_.size(); i++)
+      {
+        if(branches_[i].tier < tier)
+          tier = branches_[i].tier;
+      }
+
+    return tier;
+  }
+
+  /*
+    The first branch, in order, with the file. As with opens.
+  */
+  static
+  BranchInfo*
+  location(BranchInfoVec &branches_,
+           const string  &fusepath_)
+  {
+    int rv;
+    struct stat st;
+
+    for(size_t i = 0; i < branches_.size(); i++)
+      {
+        rv = fs::lstat(fs::path::make(branches_[i].path,fusepath_),&st);
+        if(rv == 0)
+          return &branches_[i];
+      }
+
+    return NULL;
+  }
+
+  static
+  BranchInfo*
+  roomiest(BranchInfoVec  &branches_,
+           const uint64_t  tier_)
+  {
+    BranchInfo *dst;
+
+    dst = NULL;
+    for(size_t i = 0; i < branches_.size(); i++)
+      {
+        BranchInfo &bi = branches_[i];
+
+        if(!bi.dst || (bi.tier != tier_))
+          continue;
+        if((dst != NULL) && (bi.avail <= dst->avail))
+          continue;
+
+        dst = &bi;
+      }
+
+    return dst;
+  }
+
+  /*
+    Files which were open, and so skipped, are kept for the next pass
+    as long as they stay popular.
+  */
+  static
+  void
+  promote(BranchInfoVec   &branches_,
+          const Settings  &settings_,
+          char            *buf_,
+          mover::Throttle *throttle_)
+  {
+    Result res;
+    uint64_t tier;
+    BranchInfo *src;
+    BranchInfo *dst;
+    struct stat st;
+    std::set<string> hot;
+    std::set<string> retry;
+
+    pthread_mutex_lock(&g_lock);
+    hot.swap(g_hot);
+    pthread_mutex_unlock(&g_lock);
+
+    tier = l::fastest(branches_);
+    throttle_->reset();
+    for(std::set<string>::const_iterator
+          i = hot.begin(), ei = hot.end(); i != ei; ++i)
+      {
+        if(!g_enabled)
+          break;
+        if(l::sketch_get(*i) < settings_.promote)
+          continue;
+
+        src = l::location(branches_,*i);
+        if((src == NULL) || !src->src || (src->tier == tier))
+          continue;
+        dst = l::roomiest(branches_,tier);
+        if(dst == NULL)
+          break;
+
+        l::PromoteJob job(*dst,settings_.high);
+
+        res = mover::move(src->path,
+                          dst->path,
+                          *i,
+                          buf_,
+                          throttle_,
+                          settings_.io,
+                          &job,
+                          &st);
+        switch(res)
+          {
+          case Result::MOVED:
+            g_promoted++;
+            src->used  -= st.st_size;
+            src->avail += st.st_size;
+            dst->used  += st.st_size;
+            dst->avail -= st.st_size;
+            break;
+          case Result::SKIPPED:
+            g_skipped++;
+            retry.insert(*i);
+            break;
+          case Result::FAILED:
+            g_errors++;
+            break;
+          case Result::INTERRUPTED:
+            retry.insert(*i);
+            break;
+          }
+      }
+
+    pthread_mutex_lock(&g_lock);
+    for(std::set<string>::const_iterator
+          i = retry.begin(), ei = retry.end(); i != ei; ++i)
+      {
+        if(g_hot.size() >= HOT_MAX)
+          break;
+        g_hot.insert(*i);
+      }
+    pthread_mutex_unlock(&g_lock);
+  }
+
+  static
+  void
+  pass(const Settings  &settings_,
+       BranchInfoVec   &branches_,
+       char            *buf_,
+       mover::Throttle *throttle_)
+  {
+    for(size_t i = 0; i < branches_.size(); i++)
+      {
+        if(mover::update(&branches_[i]) == -1)
+          branches_[i].src = branches_[i].dst = false;
+      }
+
+    for(size_t i = 0; i < branches_.size(); i++)
+      {
+        BranchInfo &bi = branches_[i];
+
+        if(!g_enabled)
+          break;
+        if(!bi.src)
+          continue;
+        if(mover::percent_used(bi) < (settings_.high * 100))
+          continue;
+
+        l::demote(branches_,&bi,settings_,buf_,throttle_);
+      }
+
+    if(settings_.promote && g_enabled)
+      l::promote(branches_,settings_,buf_,throttle_);
+  }
+
+  /*
+    Checks every interval. Enabling or any change to the
+    configuration wakes it early.
+  */
+  static
+  void*
+  worker(void *arg_)
+  {
+    void *buf;
+    time_t decayed;
+    Settings settings;
+    struct timespec ts;
+    mover::Throttle throttle;
+    BranchInfoVec branches;
+
+    if(posix_memalign(&buf,mover::BUF_ALIGN,mover::BUF_SIZE) != 0)
+      buf = NULL;
+
+    decayed = ::time(NULL);
+    pthread_mutex_lock(&g_lock);
+    while((buf != NULL) && g_enabled)
+      {
+        g_moving = true;
+        pthread_mutex_unlock(&g_lock);
+
+        l::snapshot(&branches,&settings);
+        if((uint64_t)(::time(NULL) - decayed) >= settings.window)
+          {
+            l::sketch_decay();
+            decayed = ::time(NULL);
+          }
+        l::pass(settings,branches,(char*)buf,&throttle);
+
+        pthread_mutex_lock(&g_lock);
+        g_moving = false;
+        if(!g_enabled)
+          break;
+
+        clock_gettime(CLOCK_REALTIME,&ts);
+        ts.tv_sec += settings.interval;
+        pthread_cond_timedwait(&g_cond,&g_lock,&ts);
+      }
+
+    g_running = false;
+    pthread_cond_broadcast(&g_cond);
+    pthread_mutex_unlock(&g_lock);
+
+    free(buf);
+
+    return NULL;
+  }
+
+  // called with g_lock held
+  static
+  void
+  spawn(void)
+  {
+    int rv;
+    pthread_t thread;
+    pthread_attr_t attr;
+    const ugid::Set ugid(0,0);
+
+    if(!g_ready || g_running || !g_enabled)
+      return;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+    rv = pthread_create(&thread,&attr,l::worker,NULL);
+    pthread_attr_destroy(&attr);
+    if(rv != 0)
+      return;
+
+    g_running = true;
+  }
+}
+
+namespace tiering
+{
+  /*
+    Held until the filesystem is up so no thread is lost to
+    daemonizing.
+  */
+  void
+  init(void)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    l::g_ready = true;
+    l::spawn();
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  void
+  promote(const uint64_t threshold_)
+  {
+    l::g_promote = threshold_;
+  }
+
+  /*
+    Called on every open so kept to a few relaxed atomic operations
+    unless the file just became popular.
+  */
+  void
+  access(const std::string &fusepath_)
+  {
+    uint64_t threshold;
+
+    threshold = l::g_promote.load(std::memory_order_relaxed);
+    if((threshold == 0) || !l::g_enabled.load(std::memory_order_relaxed))
+      return;
+    if(l::sketch_add(fusepath_) != threshold)
+      return;
+
+    pthread_mutex_lock(&l::g_lock);
+    if(l::g_hot.size() < l::HOT_MAX)
+      l::g_hot.insert(fusepath_);
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  void
+  enable(const bool enable_)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    l::g_enabled = enable_;
+    l::spawn();
+    pthread_cond_broadcast(&l::g_cond);
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  /*
+    Waits for the current file to be abandoned so no temporary file
+    is left behind.
+  */
+  void
+  shutdown(void)
+  {
+    pthread_mutex_lock(&l::g_lock);
+    l::g_enabled = false;
+    pthread_cond_broadcast(&l::g_cond);
+    while(l::g_running)
+      pthread_cond_wait(&l::g_cond,&l::g_lock);
+    pthread_mutex_unlock(&l::g_lock);
+  }
+
+  void
+  stats(Stats *stats_)
+  {
+    int rv;
+    struct statvfs st;
+    Config::Read cfg;
+    Branches::Snapshot branches(cfg->branches);
+
+    pthread_mutex_lock(&l::g_lock);
+    stats_->state = (!l::g_enabled ? "disabled" :
+                     l::g_moving ? "moving" :
+                     "idle");
+    pthread_mutex_unlock(&l::g_lock);
+
+    stats_->demoted  = l::g_demoted;
+    stats_->promoted = l::g_promoted;
+    stats_->bytes   = l::g_bytes;
+    stats_->skipped = l::g_skipped;
+    stats_->errors  = l::g_errors;
+
+    stats_->tiers.clear();
+    for(size_t i = 0; i < branches.vec.size(); i++)
+      {
+        Usage &usage = stats_->tiers[branches.vec[i].tier];
+
+        rv = fs::statvfs(branches.vec[i].path,&st);
+        if(rv == -1)
+          continue;
+
+        usage.used  += StatVFS::spaceused(st);
+        usage.total += (StatVFS::spaceused(st) + StatVFS::spaceavail(st));
+      }
+  }
+}
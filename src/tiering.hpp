@@ -0,0 +1,61 @@
+/*
+  ISC License
+
+  Copyright (c) 2020, Antonio SJ Musumeci <trapexit@spawn.link>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <stdint.h>
+
+/*
+  Keeps the fastest tiers from filling up. Once the space used on a
+  branch passes the high watermark its least recently used, or
+  oldest, files are moved to the next tier until it's back under the
+  low watermark. Files opened often enough are moved the other way,
+  to the fastest tier. Files open by anyone are left where they are.
+*/
+namespace tiering
+{
+  struct Usage
+  {
+    uint64_t used;
+    uint64_t total;
+  };
+
+  struct Stats
+  {
+    const char                *state;
+    uint64_t                   demoted;
+    uint64_t                   promoted;
+    uint64_t                   bytes;
+    uint64_t                   skipped;
+    uint64_t                   errors;
+    std::map<uint64_t,Usage>   tiers;
+  };
+
+  void init(void);
+  void enable(const bool enable);
+  void promote(const uint64_t threshold);
+  void shutdown(void);
+
+  void access(const std::string &fusepath);
+
+  void stats(Stats *stats);
+}
@@ -14,7 +14,20 @@
   OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 
+#include "fs_fchmod.hpp"
+#include "fs_fchown.hpp"
+#include "fs_lchmod.hpp"
+#include "fs_lchown.hpp"
+#include "fs_lstat.hpp"
+#include "fs_path.hpp"
 #include "gidcache.hpp"
+#include "ugid.hpp"
+
+#include <fuse.h>
+
+#include <string>
+
+#include <sys/stat.h>
 
 #if defined __linux__ and UGID_USE_RWLOCK == 0
 #include "ugid_linux.icpp"
@@ -22,14 +35,83 @@
 #include "ugid_rwlock.icpp"
 #endif
 
+namespace l
+{
+  /*
+    An entry created in a setgid directory inherits the directory's
+    group just as it would had the requester created it.
+  */
+  static
+  gid_t
+  created_gid(const std::string &fullpath_,
+              const gid_t        gid_)
+  {
+    int rv;
+    struct stat st;
+
+    rv = fs::lstat(fs::path::dirname(fullpath_),&st);
+    if((rv == 0) && (st.st_mode & S_ISGID))
+      return (gid_t)-1;
+
+    return gid_;
+  }
+
+  /*
+    chown clears setuid and setgid from non-directories.
+  */
+  static
+  bool
+  has_setid(const mode_t mode_)
+  {
+    return !!(mode_ & (S_ISUID|S_ISGID));
+  }
+}
+
 namespace ugid
 {
+  bool switching = true;
+
+  void
+  chown_created(const std::string &fullpath_,
+                const mode_t       mode_)
+  {
+    const fuse_context *fc;
+
+    if(switching)
+      return;
+
+    fc = fuse_get_context();
+    if((fc->uid == 0) && (fc->gid == 0))
+      return;
+
+    fs::lchown(fullpath_,fc->uid,l::created_gid(fullpath_,fc->gid));
+    if(l::has_setid(mode_))
+      fs::lchmod(fullpath_,mode_);
+  }
+
+  void
+  fchown_created(const int          fd_,
+                 const std::string &fullpath_,
+                 const mode_t       mode_)
+  {
+    const fuse_context *fc;
+
+    if(switching)
+      return;
+
+    fc = fuse_get_context();
+    if((fc->uid == 0) && (fc->gid == 0))
+      return;
+
+    fs::fchown(fd_,fc->uid,l::created_gid(fullpath_,fc->gid));
+    if(l::has_setid(mode_))
+      fs::fchmod(fd_,mode_);
+  }
+
   void
   initgroups(const uid_t uid_,
              const gid_t gid_)
   {
-    static __thread gid_t_cache cache = {0};
-
-    cache.initgroups(uid_,gid_);
+    gidcache::initgroups(uid_,gid_);
   }
 }
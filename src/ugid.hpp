@@ -19,12 +19,23 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <string>
 #include <vector>
 
 namespace ugid
 {
-  void init();
+  extern bool switching;
+
+  void init(const bool switching);
   void initgroups(const uid_t uid, const gid_t gid);
+
+  /*
+    When not switching credentials per request entries are created as
+    root and handed to the requester afterwards. Both are no-ops when
+    switching.
+  */
+  void chown_created(const std::string &fullpath, const mode_t mode);
+  void fchown_created(const int fd, const std::string &fullpath, const mode_t mode);
 }
 
 #if defined __linux__ and UGID_USE_RWLOCK == 0
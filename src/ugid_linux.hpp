@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "gidcache.hpp"
+
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
@@ -53,15 +55,21 @@
 
 namespace ugid
 {
-  extern __thread uid_t currentuid;
-  extern __thread gid_t currentgid;
-  extern __thread bool  initialized;
+  extern __thread uid_t    currentuid;
+  extern __thread gid_t    currentgid;
+  extern __thread uint64_t currentgen;
+  extern __thread bool     initialized;
 
   struct Set
   {
     Set(const uid_t newuid_,
         const gid_t newgid_)
     {
+      uint64_t gen;
+
+      if(!switching)
+        return;
+
       if(!initialized)
         {
           currentuid  = GETEUID();
@@ -69,7 +77,8 @@ namespace ugid
           initialized = true;
         }
 
-      if((newuid_ == currentuid) && (newgid_ == currentgid))
+      gen = gidcache::generation.load(std::memory_order_relaxed);
+      if((newuid_ == currentuid) && (newgid_ == currentgid) && (gen == currentgen))
         return;
 
       if(currentuid != 0)
@@ -89,6 +98,7 @@ namespace ugid
 
       currentuid = newuid_;
       currentgid = newgid_;
+      currentgen = gen;
     }
   };
 
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "gidcache.hpp"
+
 #include <pthread.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -25,6 +27,7 @@ namespace ugid
 {
   extern uid_t currentuid;
   extern gid_t currentgid;
+  extern uint64_t currentgen;
   extern pthread_rwlock_t rwlock;
 
   static
@@ -32,15 +35,21 @@ namespace ugid
   ugid_set(const uid_t newuid_,
            const gid_t newgid_)
   {
+    uint64_t gen;
+
     pthread_rwlock_rdlock(&rwlock);
 
-    if((newuid_ == currentuid) && (newgid_ == currentgid))
+    if(!switching)
+      return;
+
+    gen = gidcache::generation.load(std::memory_order_relaxed);
+    if((newuid_ == currentuid) && (newgid_ == currentgid) && (gen == currentgen))
       return;
 
     pthread_rwlock_unlock(&rwlock);
     pthread_rwlock_wrlock(&rwlock);
 
-    if((newuid_ == currentuid) && (newgid_ == currentgid))
+    if((newuid_ == currentuid) && (newgid_ == currentgid) && (gen == currentgen))
       return;
 
     if(currentuid != 0)
@@ -60,6 +69,7 @@ namespace ugid
 
     currentuid = newuid_;
     currentgid = newgid_;
+    currentgen = gen;
   }
 
   struct Set